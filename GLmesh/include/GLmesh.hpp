@@ -3,31 +3,72 @@
 
 #include <GLplus.hpp>
 
-namespace tinyobj
-{
-    struct shape_t;
-} // end namespace tinyobj
+#include "MeshData.hpp"
 
 namespace GLmesh
 {
 
 class StaticMesh
 {
-    std::shared_ptr<GLplus::Buffer> mpPositions;
-    std::shared_ptr<GLplus::Buffer> mpTexcoords;
-    std::shared_ptr<GLplus::Buffer> mpNormals;
+    // every attribute, interleaved as mDescription.Layout says
+    std::shared_ptr<GLplus::Buffer> mpVertices;
+    // every level, one after the other. they all index mpVertices.
     std::shared_ptr<GLplus::Buffer> mpIndices;
 
-    size_t mVertexCount = 0;
+    MeshDescription mDescription;
+    size_t mVertexBytes = 0;
 
     std::shared_ptr<GLplus::Texture2D> mpDiffuseTexture;
 
+    // rebuilt by Load, filled in by Render
+    mutable GLplus::VertexArrayCache mVertexArrays;
+
+    mutable GLplus::UniformHandle mDiffuseTextureUniform{"diffuseTexture"};
+    // undo position quantization, in programs that have them
+    mutable GLplus::UniformHandle mPositionScaleUniform{"positionScale"};
+    mutable GLplus::UniformHandle mPositionOffsetUniform{"positionOffset"};
+
 public:
-    void LoadShape(const tinyobj::shape_t& shape);
+    // Builds simplified levels of detail, reorders the triangles and vertices for the GPU's caches
+    // on the way, and uses 16 bit indices if there are few enough vertices.
+    // materials is what the shape's material_id indexes.
+    void LoadShape(const tinyobj::shape_t& shape, const std::vector<tinyobj::material_t>& materials,
+                   const VertexFormat& format = VertexFormat());
+
+    // Loads the first mesh of a .glmesh file, as written by obj_to_glmesh. Its data is
+    // uploaded straight from the mapped file, with none of LoadShape's work to redo.
+    void LoadFile(const char* filename);
+
+    // Uploads a mesh built by BuildMeshData, or read from a MeshFile.
+    void Load(const MeshDataView& data);
+
+    size_t GetLevelCount() const { return mDescription.Levels.size(); }
+    const StaticMeshLevel& GetLevel(size_t level) const { return mDescription.Levels.at(level); }
 
-    void Render(GLplus::Program& program) const;
+    // Distance from point to the mesh's bounding box, 0 inside it. Both in model space.
+    float GetDistanceTo(const float point[3]) const;
+
+    // The least detailed level whose error stays within maxPixelError pixels, when the mesh is seen
+    // from distance away. projectionScale is pixels per model unit at a distance of 1:
+    // the projection matrix's [1][1] times half the viewport height.
+    size_t SelectLevel(float distance, float projectionScale, float maxPixelError = 1.0f) const;
+
+    // what the vertices take up on the GPU, not counting indices
+    size_t GetVertexBytes() const { return mVertexBytes; }
+
+    // GL_UNSIGNED_SHORT for meshes that have few enough vertices
+    GLenum GetIndexType() const { return mDescription.IndexType; }
+
+    void Render(GLplus::Program& program, size_t level = 0) const;
 };
 
+// Loads every shape of an OBJ file as a StaticMesh, in file order. Each shape is uploaded as soon as
+// tinyobj has built it, and freed after, so the model is never on the CPU all at once.
+// numThreads is how many threads parse it, 0 for one per core.
+std::vector<std::shared_ptr<StaticMesh>> LoadObjMeshes(const char* filename, const char* mtlBasePath = nullptr,
+                                                       const VertexFormat& format = VertexFormat(),
+                                                       unsigned int numThreads = 0);
+
 } // end namespace GLmesh
 
 #endif // GLMESH_H
@@ -0,0 +1,69 @@
+#ifndef GLMESH_MESHDATA_HPP
+#define GLMESH_MESHDATA_HPP
+
+#include "VertexFormat.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace tinyobj
+{
+    struct shape_t;
+    struct material_t;
+} // end namespace tinyobj
+
+namespace GLmesh
+{
+
+// A range of the index buffer, drawing the whole mesh in less detail the higher the level
+struct StaticMeshLevel
+{
+    size_t FirstIndex;
+    size_t IndexCount;
+    float Error; // how far from the full detail surface it may be, in model units
+};
+
+// Everything about a mesh but its vertex and index data
+struct MeshDescription
+{
+    VertexLayout Layout;
+    GLenum IndexType = GL_UNSIGNED_INT;
+    // every level's indices are in one index buffer, one after the other
+    std::vector<StaticMeshLevel> Levels;
+
+    float BoundsMin[3] = { 0.0f, 0.0f, 0.0f };
+    float BoundsMax[3] = { 0.0f, 0.0f, 0.0f };
+
+    // image file of the material's diffuse texture, empty if there is none
+    std::string DiffuseTexture;
+};
+
+// A mesh ready to upload. The data belongs to a MeshData or a MeshFile, and must outlive the view.
+struct MeshDataView
+{
+    const MeshDescription* pDescription = nullptr;
+    const void* pVertices = nullptr;
+    size_t VertexBytes = 0;
+    const void* pIndices = nullptr;
+    size_t IndexBytes = 0;
+};
+
+struct MeshData
+{
+    MeshDescription Description;
+    std::vector<unsigned char> Vertices;
+    std::vector<unsigned char> Indices;
+
+    MeshDataView GetView() const;
+};
+
+// Does everything StaticMesh needs done before uploading a shape: interleaves the vertices,
+// builds the levels of detail, orders them for the GPU's caches and packs the indices.
+// Needs no GL context. materials is what the shape's material_id indexes.
+MeshData BuildMeshData(const tinyobj::shape_t& shape, const std::vector<tinyobj::material_t>& materials,
+                       const VertexFormat& format = VertexFormat());
+
+} // end namespace GLmesh
+
+#endif // GLMESH_MESHDATA_HPP
@@ -0,0 +1,49 @@
+#ifndef GLMESH_MESHFILE_HPP
+#define GLMESH_MESHFILE_HPP
+
+#include "MeshData.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace GLmesh
+{
+
+// .glmesh files hold meshes the way StaticMesh uploads them, so loading one is
+// mapping the file and pointing GL at it. They're written in the writer's byte order,
+// and a file from a different byte order or format version is refused, not converted.
+//
+// Layout: a header, a record per mesh, then each mesh's level table and texture name,
+// and its vertex and index data, each starting on a 64 byte boundary.
+
+// Writes the meshes to filename. Throws if it can't.
+void WriteMeshFile(const char* filename, const std::vector<MeshDataView>& meshes);
+
+// A .glmesh file, mapped into memory for as long as the MeshFile lives.
+class MeshFile
+{
+    struct Mapping;
+    std::unique_ptr<Mapping> mpMapping;
+
+    std::vector<MeshDescription> mDescriptions;
+    std::vector<MeshDataView> mMeshes;
+
+public:
+    // Throws if the file can't be mapped, or isn't a .glmesh file of this version.
+    explicit MeshFile(const char* filename);
+    ~MeshFile();
+
+    MeshFile(const MeshFile&) = delete;
+    MeshFile& operator=(const MeshFile&) = delete;
+
+    size_t GetMeshCount() const { return mMeshes.size(); }
+
+    // The data points into the mapping, so it's only valid while the MeshFile is.
+    const MeshDataView& GetMesh(size_t mesh) const { return mMeshes.at(mesh); }
+
+    size_t GetFileSize() const;
+};
+
+} // end namespace GLmesh
+
+#endif // GLMESH_MESHFILE_HPP
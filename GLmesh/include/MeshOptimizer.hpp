@@ -0,0 +1,38 @@
+#ifndef GLMESH_MESHOPTIMIZER_HPP
+#define GLMESH_MESHOPTIMIZER_HPP
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace GLmesh
+{
+
+// Average cache miss ratio: vertices transformed per triangle, through a FIFO post-transform
+// cache of cacheSize vertices. 3 is the worst, around 0.5 to 0.7 is good for meshes like grids.
+double ComputeACMR(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize = 16);
+
+// Reorders triangles so that vertices get reused while they're still in the post-transform cache,
+// using Tom Forsyth's "Linear-Speed Vertex Cache Optimisation". Returns the reordered indices.
+// Throws if an index is out of range.
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount);
+
+// Renumbers vertices in the order the indices first use them, so fetching them walks the vertex buffer
+// forwards. Rewrites the indices, and returns the old number of each new vertex. Unused vertices are dropped.
+std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// Moves vertices of stride bytes as OptimizeVertexFetch ordered them.
+std::vector<unsigned char> RemapVertices(const std::vector<unsigned char>& vertices, size_t stride,
+                                         const std::vector<uint32_t>& order);
+
+// GL_UNSIGNED_SHORT if every vertex can be numbered in 16 bits, GL_UNSIGNED_INT otherwise
+GLenum ChooseIndexType(size_t vertexCount);
+
+// The indices as GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, ready to upload.
+std::vector<unsigned char> PackIndices(const std::vector<uint32_t>& indices, GLenum indexType);
+
+} // end namespace GLmesh
+
+#endif // GLMESH_MESHOPTIMIZER_HPP
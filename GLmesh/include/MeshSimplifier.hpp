@@ -0,0 +1,44 @@
+#ifndef GLMESH_MESHSIMPLIFIER_HPP
+#define GLMESH_MESHSIMPLIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace GLmesh
+{
+
+// Removes triangles by collapsing edges onto one of their vertices, cheapest first by quadric error
+// (Garland and Heckbert). Vertices never move and none are added, so every result indexes the
+// same vertex buffer as the input. Vertices on open edges are kept in place, which also keeps
+// texture and normal seams together, since tinyobj splits the vertices along them.
+//
+// positions are 3 floats per vertex. Stops at targetIndexCount indices, when no collapse is left
+// that keeps the surface within maxError of where it was, or when no more collapses are possible.
+// The error of the result, in the units of the positions, is written to resultError if given. It's the
+// furthest any vertex was collapsed from the plane of a triangle it replaced, the worst case rather
+// than the quadrics' average, so a level never looks better than it is.
+std::vector<uint32_t> SimplifyMesh(
+        const std::vector<uint32_t>& indices,
+        const std::vector<float>& positions,
+        size_t targetIndexCount,
+        float maxError,
+        float* resultError = nullptr);
+
+struct MeshLevel
+{
+    std::vector<uint32_t> Indices;
+    // how far the level's surface may be from level 0's, in the units of the positions
+    float Error;
+};
+
+// Level 0 is the mesh as given. Each next level is simplified from the one before it to about half its
+// triangles, until maxLevels, or until a level gets too small or simplification stops making progress.
+std::vector<MeshLevel> BuildLevelsOfDetail(
+        const std::vector<uint32_t>& indices,
+        const std::vector<float>& positions,
+        size_t maxLevels = 8);
+
+} // end namespace GLmesh
+
+#endif // GLMESH_MESHSIMPLIFIER_HPP
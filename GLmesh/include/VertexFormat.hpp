@@ -0,0 +1,87 @@
+#ifndef GLMESH_VERTEXFORMAT_HPP
+#define GLMESH_VERTEXFORMAT_HPP
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace GLmesh
+{
+
+enum class PositionEncoding
+{
+    // 3 floats, 12 bytes
+    Float,
+    // 3 unsigned shorts spanning the mesh's bounding box, padded to 8 bytes.
+    // The shader gets the position back as stored * PositionScale + PositionOffset.
+    Unorm16
+};
+
+enum class NormalEncoding
+{
+    // 3 floats, 12 bytes
+    Float,
+    // GL_INT_2_10_10_10_REV, 4 bytes
+    Int2101010
+};
+
+enum class TexcoordEncoding
+{
+    // 2 floats, 8 bytes
+    Float,
+    // 2 half floats, 4 bytes. Keeps texcoords outside of [0,1], for tiling.
+    Half,
+    // 2 unsigned shorts, 4 bytes. Texcoords must be within [0,1].
+    Unorm16
+};
+
+// How each attribute is stored in an interleaved vertex
+struct VertexFormat
+{
+    PositionEncoding Position = PositionEncoding::Unorm16;
+    NormalEncoding Normal = NormalEncoding::Int2101010;
+    TexcoordEncoding Texcoord = TexcoordEncoding::Half;
+};
+
+// One attribute of an interleaved vertex, as glVertexAttribPointer wants it
+struct VertexAttributeLayout
+{
+    std::string Name; // "position", "normal" or "texcoord0"
+    GLint Size;
+    GLenum Type;
+    GLboolean Normalized;
+    GLsizei Offset;
+};
+
+struct VertexLayout
+{
+    std::vector<VertexAttributeLayout> Attributes;
+    GLsizei Stride = 0;
+
+    // undoes Unorm16 positions. 1 and 0 for float positions.
+    float PositionScale[3] = { 1.0f, 1.0f, 1.0f };
+    float PositionOffset[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+// Vertices with all of their attributes side by side in one buffer
+struct InterleavedVertices
+{
+    VertexLayout Layout;
+    std::vector<unsigned char> Data;
+    size_t VertexCount = 0;
+};
+
+// Takes the attribute arrays the way tinyobj loads them: 3 floats per position and normal,
+// 2 per texcoord. Normals and texcoords may be empty, and are then left out of the layout.
+// Throws if the arrays don't agree on the number of vertices, or if a texcoord doesn't fit Unorm16.
+InterleavedVertices InterleaveVertices(
+        const std::vector<float>& positions,
+        const std::vector<float>& normals,
+        const std::vector<float>& texcoords,
+        const VertexFormat& format);
+
+} // end namespace GLmesh
+
+#endif // GLMESH_VERTEXFORMAT_HPP
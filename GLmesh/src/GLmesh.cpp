@@ -1,115 +1,144 @@
 #include "GLmesh.hpp"
-
+#include "MeshFile.hpp"
 #include <tiny_obj_loader.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
 namespace GLmesh
 {
 
-void StaticMesh::LoadShape(const tinyobj::shape_t& shape)
+void StaticMesh::LoadShape(const tinyobj::shape_t& shape, const std::vector<tinyobj::material_t>& materials,
+                           const VertexFormat& format)
+{
+    MeshData data = BuildMeshData(shape, materials, format);
+    Load(data.GetView());
+}
+
+namespace
+{
+
+class StaticMeshLoader : public tinyobj::shape_visitor
 {
-    if (shape.mesh.indices.size() % 3 != 0)
+    std::vector<tinyobj::material_t> mMaterials;
+    const VertexFormat& mFormat;
+
+public:
+    std::vector<std::shared_ptr<StaticMesh>> Meshes;
+
+    explicit StaticMeshLoader(const VertexFormat& format)
+        : mFormat(format)
+    { }
+
+    void visit_materials(std::vector<tinyobj::material_t>& materials) override
     {
-        throw std::runtime_error("Expected 3d vertices.");
+        mMaterials.swap(materials);
     }
 
-    std::shared_ptr<GLplus::Buffer> newIndices;
-    std::shared_ptr<GLplus::Buffer> newPositions;
-    std::shared_ptr<GLplus::Buffer> newNormals;
-    std::shared_ptr<GLplus::Buffer> newTexcoords;
-    std::shared_ptr<GLplus::Texture2D> newDiffuseTexture;
-
-    newIndices.reset(new GLplus::Buffer());
+    void visit_shape(tinyobj::shape_t& shape) override
     {
-        GLplus::ScopedBufferBinding bufferBinding(*newIndices, GL_ELEMENT_ARRAY_BUFFER);
-        bufferBinding.GetBinding().Upload(
-                  shape.mesh.indices.size() * sizeof(shape.mesh.indices[0]),
-                  shape.mesh.indices.data(), GL_STATIC_DRAW);
+        std::shared_ptr<StaticMesh> mesh(new StaticMesh());
+        mesh->LoadShape(shape, mMaterials, mFormat);
+        Meshes.push_back(mesh);
     }
+};
+
+} // end anonymous namespace
 
-    if (!shape.mesh.positions.empty())
+std::vector<std::shared_ptr<StaticMesh>> LoadObjMeshes(const char* filename, const char* mtlBasePath,
+                                                       const VertexFormat& format, unsigned int numThreads)
+{
+    StaticMeshLoader loader(format);
+    tinyobj::LoadObj(loader, filename, mtlBasePath, numThreads);
+    return loader.Meshes;
+}
+
+void StaticMesh::LoadFile(const char* filename)
+{
+    MeshFile file(filename);
+    if (file.GetMeshCount() == 0)
     {
-        newPositions.reset(new GLplus::Buffer());
-        GLplus::ScopedBufferBinding bufferBinding(*newPositions, GL_ARRAY_BUFFER);
-        bufferBinding.GetBinding().Upload(
-                    shape.mesh.positions.size() * sizeof(shape.mesh.positions[0]),
-                    shape.mesh.positions.data(), GL_STATIC_DRAW);
+        throw std::runtime_error(std::string(filename) + " has no meshes.");
     }
+    Load(file.GetMesh(0));
+}
 
-    if (!shape.mesh.normals.empty())
+void StaticMesh::Load(const MeshDataView& data)
+{
+    const MeshDescription& description = *data.pDescription;
+
+    std::shared_ptr<GLplus::Buffer> newIndices;
+    std::shared_ptr<GLplus::Buffer> newVertices;
+    std::shared_ptr<GLplus::Texture2D> newDiffuseTexture;
+
+    newIndices.reset(new GLplus::Buffer());
     {
-        newNormals.reset(new GLplus::Buffer());
-        GLplus::ScopedBufferBinding bufferBinding(*newNormals, GL_ARRAY_BUFFER);
-        bufferBinding.GetBinding().Upload(
-                    shape.mesh.normals.size() * sizeof(shape.mesh.normals[0]),
-                    shape.mesh.normals.data(), GL_STATIC_DRAW);
+        GLplus::ScopedBufferBinding bufferBinding(*newIndices, GL_ELEMENT_ARRAY_BUFFER);
+        bufferBinding.GetBinding().Upload(data.IndexBytes, data.pIndices, GL_STATIC_DRAW);
     }
 
-    if (!shape.mesh.texcoords.empty())
+    newVertices.reset(new GLplus::Buffer());
     {
-        newTexcoords.reset(new GLplus::Buffer());
-        GLplus::ScopedBufferBinding bufferBinding(*newTexcoords, GL_ARRAY_BUFFER);
-        bufferBinding.GetBinding().Upload(
-                    shape.mesh.texcoords.size() * sizeof(shape.mesh.texcoords[0]),
-                    shape.mesh.texcoords.data(), GL_STATIC_DRAW);
+        GLplus::ScopedBufferBinding bufferBinding(*newVertices, GL_ARRAY_BUFFER);
+        bufferBinding.GetBinding().Upload(data.VertexBytes, data.pVertices, GL_STATIC_DRAW);
     }
 
-    if (!shape.material.diffuse_texname.empty())
+    if (!description.DiffuseTexture.empty())
     {
         newDiffuseTexture.reset(new GLplus::Texture2D());
         GLplus::ScopedTexture2DBinding textureBinding(*newDiffuseTexture);
-        textureBinding.GetBinding().LoadImage(shape.material.diffuse_texname.c_str(), GLplus::Texture2D::InvertY);
+        textureBinding.GetBinding().LoadImage(description.DiffuseTexture.c_str(), GLplus::Texture2D::InvertY);
     }
 
-    mVertexCount = shape.mesh.indices.size();
-
     mpIndices = std::move(newIndices);
-    mpPositions = std::move(newPositions);
-    mpTexcoords = std::move(newTexcoords);
-    mpNormals = std::move(newNormals);
+    mpVertices = std::move(newVertices);
     mpDiffuseTexture = std::move(newDiffuseTexture);
+    mDescription = description;
+    mVertexBytes = data.VertexBytes;
+
+    const VertexLayout& layout = mDescription.Layout;
+    mVertexArrays.Clear();
+    mVertexArrays.SetIndexBuffer(mpIndices, mDescription.IndexType);
+    for (const VertexAttributeLayout& attribute : layout.Attributes)
+    {
+        mVertexArrays.AddAttribute({ attribute.Name, mpVertices, attribute.Size, attribute.Type,
+                                     attribute.Normalized, layout.Stride, attribute.Offset, 0 });
+    }
 }
 
-void StaticMesh::Render(GLplus::Program& program) const
+float StaticMesh::GetDistanceTo(const float point[3]) const
 {
-    GLplus::VertexArray vertexArray;
-    GLplus::ScopedVertexArrayBinding scopedVAO(vertexArray);
-    GLplus::VertexArrayBinding& vaoBinding = scopedVAO.GetBinding();
-
-    vaoBinding.SetIndexBuffer(mpIndices, GL_UNSIGNED_INT);
-
-    if (mpPositions)
+    float squaredDistance = 0.0f;
+    for (int axis = 0; axis < 3; axis++)
     {
-        GLint positionLoc;
-        if (program.TryGetAttributeLocation("position", positionLoc))
-        {
-            vaoBinding.SetAttribute(
-                        positionLoc, mpPositions,
-                        3, GL_FLOAT, GL_FALSE, 0, 0);
-        }
+        float outside = std::max(std::max(mDescription.BoundsMin[axis] - point[axis], point[axis] - mDescription.BoundsMax[axis]), 0.0f);
+        squaredDistance += outside * outside;
     }
+    return std::sqrt(squaredDistance);
+}
 
-    if (mpNormals)
+size_t StaticMesh::SelectLevel(float distance, float projectionScale, float maxPixelError) const
+{
+    // an error of e model units, seen from distance d, covers about e * projectionScale / d pixels
+    const std::vector<StaticMeshLevel>& levels = mDescription.Levels;
+    size_t level = 0;
+    while (level + 1 < levels.size()
+        && levels[level + 1].Error * projectionScale <= maxPixelError * distance)
     {
-        GLint normalLoc;
-        if (program.TryGetAttributeLocation("normal", normalLoc))
-        {
-            vaoBinding.SetAttribute(
-                        normalLoc, mpNormals,
-                        3, GL_FLOAT, GL_FALSE, 0, 0);
-        }
+        level++;
     }
+    return level;
+}
 
-    if (mpTexcoords)
+void StaticMesh::Render(GLplus::Program& program, size_t level) const
+{
+    if (level >= mDescription.Levels.size())
     {
-        GLint texcoord0Loc;
-        if (program.TryGetAttributeLocation("texcoord0", texcoord0Loc))
-        {
-            vaoBinding.SetAttribute(
-                        texcoord0Loc, mpTexcoords,
-                        2, GL_FLOAT, GL_FALSE, 0, 0);
-        }
+        throw std::out_of_range("StaticMesh has no level " + std::to_string(level));
     }
 
+    GLplus::ScopedVertexArrayBinding scopedVAO(mVertexArrays.Get(program));
+
     GLplus::ScopedProgramBinding programBinding(program);
     std::unique_ptr<GLplus::ScopedActiveTextureBinding> activeTextureBind;
     std::unique_ptr<GLplus::ScopedTexture2DBinding> diffuseBind;
@@ -117,10 +146,15 @@ void StaticMesh::Render(GLplus::Program& program) const
     {
         activeTextureBind.reset(new GLplus::ScopedActiveTextureBinding(GL_TEXTURE0));
         diffuseBind.reset(new GLplus::ScopedTexture2DBinding(*mpDiffuseTexture));
-        programBinding.GetBinding().UploadInt("diffuseTexture", 0);
+        programBinding.GetBinding().UploadInt(mDiffuseTextureUniform.GetLocation(program), 0);
     }
 
-    GLplus::DrawElements(GL_TRIANGLES, GL_UNSIGNED_INT, 0, mVertexCount);
+    // undoes position quantization
+    programBinding.GetBinding().UploadVec3(mPositionScaleUniform.GetLocation(program), mDescription.Layout.PositionScale);
+    programBinding.GetBinding().UploadVec3(mPositionOffsetUniform.GetLocation(program), mDescription.Layout.PositionOffset);
+
+    const StaticMeshLevel& drawnLevel = mDescription.Levels[level];
+    GLplus::DrawElements(GL_TRIANGLES, mDescription.IndexType, (GLint) drawnLevel.FirstIndex, (GLsizei) drawnLevel.IndexCount);
 }
 
 } // end namespace GLmesh
@@ -0,0 +1,75 @@
+#include "MeshData.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <tiny_obj_loader.h>
+
+namespace GLmesh
+{
+
+MeshDataView MeshData::GetView() const
+{
+    MeshDataView view;
+    view.pDescription = &Description;
+    view.pVertices = Vertices.data();
+    view.VertexBytes = Vertices.size();
+    view.pIndices = Indices.data();
+    view.IndexBytes = Indices.size();
+    return view;
+}
+
+MeshData BuildMeshData(const tinyobj::shape_t& shape, const std::vector<tinyobj::material_t>& materials,
+                       const VertexFormat& format)
+{
+    if (shape.mesh.indices.size() % 3 != 0)
+    {
+        throw std::runtime_error("Expected 3d vertices.");
+    }
+
+    MeshData data;
+    MeshDescription& description = data.Description;
+
+    InterleavedVertices vertices = InterleaveVertices(
+                shape.mesh.positions, shape.mesh.normals, shape.mesh.texcoords, format);
+
+    std::vector<MeshLevel> levels = BuildLevelsOfDetail(
+                std::vector<uint32_t>(shape.mesh.indices.begin(), shape.mesh.indices.end()), shape.mesh.positions);
+
+    // triangles in an order that reuses transformed vertices, then vertices in the order
+    // that order reads them. level 0 uses every vertex, so it decides the vertex order.
+    std::vector<uint32_t> indices;
+    for (const MeshLevel& level : levels)
+    {
+        std::vector<uint32_t> optimized = OptimizeVertexCache(level.Indices, vertices.VertexCount);
+        description.Levels.push_back({ indices.size(), optimized.size(), level.Error });
+        indices.insert(indices.end(), optimized.begin(), optimized.end());
+    }
+    std::vector<uint32_t> vertexOrder = OptimizeVertexFetch(indices, vertices.VertexCount);
+
+    description.Layout = vertices.Layout;
+    description.IndexType = ChooseIndexType(vertexOrder.size());
+    data.Vertices = RemapVertices(vertices.Data, vertices.Layout.Stride, vertexOrder);
+    data.Indices = PackIndices(indices, description.IndexType);
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        description.BoundsMin[axis] = description.BoundsMax[axis] = shape.mesh.positions.empty() ? 0.0f : shape.mesh.positions[axis];
+        for (size_t i = axis; i < shape.mesh.positions.size(); i += 3)
+        {
+            description.BoundsMin[axis] = std::min(description.BoundsMin[axis], shape.mesh.positions[i]);
+            description.BoundsMax[axis] = std::max(description.BoundsMax[axis], shape.mesh.positions[i]);
+        }
+    }
+
+    if (shape.material_id >= 0 && (size_t) shape.material_id < materials.size())
+    {
+        description.DiffuseTexture = materials[shape.material_id].diffuse_texname;
+    }
+
+    return data;
+}
+
+} // end namespace GLmesh
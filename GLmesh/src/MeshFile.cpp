@@ -0,0 +1,427 @@
+#include "MeshFile.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace GLmesh
+{
+
+static const char kMagic[8] = { 'G', 'L', 'M', 'E', 'S', 'H', '\0', '\0' };
+// bump whenever the records below change
+static const uint32_t kVersion = 1;
+// reads back as something else in the other byte order
+static const uint32_t kByteOrderMark = 0x01020304;
+static const uint64_t kBlobAlignment = 64;
+
+static const size_t kMaxFileAttributes = 8;
+static const size_t kMaxAttributeName = 24;
+
+namespace
+{
+
+// The records are read in place from the mapping, so they only use fixed size
+// types, and are laid out so that no compiler adds padding.
+
+struct FileHeader
+{
+    char Magic[8];
+    uint32_t Version;
+    uint32_t ByteOrderMark;
+    uint32_t MeshCount;
+    uint32_t Reserved;
+    uint64_t FileSize;
+};
+
+struct AttributeRecord
+{
+    char Name[kMaxAttributeName]; // NUL terminated
+    int32_t Size;
+    uint32_t Type;
+    uint32_t Normalized;
+    uint32_t Offset;
+};
+
+struct LevelRecord
+{
+    uint64_t FirstIndex;
+    uint64_t IndexCount;
+    float Error;
+    uint32_t Reserved;
+};
+
+struct MeshRecord
+{
+    AttributeRecord Attributes[kMaxFileAttributes];
+    uint32_t AttributeCount;
+    uint32_t Stride;
+    float PositionScale[3];
+    float PositionOffset[3];
+    float BoundsMin[3];
+    float BoundsMax[3];
+    uint32_t IndexType;
+    uint32_t LevelCount;
+
+    // from the start of the file
+    uint64_t LevelsOffset;
+    uint64_t DiffuseTextureOffset;
+    uint64_t DiffuseTextureLength;
+    uint64_t VerticesOffset;
+    uint64_t VertexBytes;
+    uint64_t IndicesOffset;
+    uint64_t IndexBytes;
+};
+
+static_assert(sizeof(FileHeader) == 32, "FileHeader must not be padded");
+static_assert(sizeof(AttributeRecord) == 40, "AttributeRecord must not be padded");
+static_assert(sizeof(LevelRecord) == 24, "LevelRecord must not be padded");
+static_assert(sizeof(MeshRecord) == 440, "MeshRecord must not be padded");
+
+} // end anonymous namespace
+
+static uint64_t AlignUp(uint64_t offset, uint64_t alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+void WriteMeshFile(const char* filename, const std::vector<MeshDataView>& meshes)
+{
+    FileHeader header = {};
+    std::memcpy(header.Magic, kMagic, sizeof(kMagic));
+    header.Version = kVersion;
+    header.ByteOrderMark = kByteOrderMark;
+    header.MeshCount = (uint32_t) meshes.size();
+
+    // work out where everything goes, then write it all in order
+    std::vector<MeshRecord> records(meshes.size());
+    uint64_t offset = sizeof(FileHeader) + meshes.size() * sizeof(MeshRecord);
+
+    for (size_t m = 0; m < meshes.size(); m++)
+    {
+        const MeshDescription& description = *meshes[m].pDescription;
+        const VertexLayout& layout = description.Layout;
+        MeshRecord& record = records[m];
+        std::memset(&record, 0, sizeof(record));
+
+        if (layout.Attributes.size() > kMaxFileAttributes)
+        {
+            throw std::runtime_error("Too many vertex attributes for a .glmesh file.");
+        }
+
+        record.AttributeCount = (uint32_t) layout.Attributes.size();
+        for (size_t a = 0; a < layout.Attributes.size(); a++)
+        {
+            const VertexAttributeLayout& attribute = layout.Attributes[a];
+            if (attribute.Name.size() >= kMaxAttributeName)
+            {
+                throw std::runtime_error("Vertex attribute name too long for a .glmesh file: " + attribute.Name);
+            }
+
+            AttributeRecord& attributeRecord = record.Attributes[a];
+            std::memcpy(attributeRecord.Name, attribute.Name.c_str(), attribute.Name.size() + 1);
+            attributeRecord.Size = attribute.Size;
+            attributeRecord.Type = attribute.Type;
+            attributeRecord.Normalized = attribute.Normalized;
+            attributeRecord.Offset = attribute.Offset;
+        }
+
+        record.Stride = (uint32_t) layout.Stride;
+        std::memcpy(record.PositionScale, layout.PositionScale, sizeof(record.PositionScale));
+        std::memcpy(record.PositionOffset, layout.PositionOffset, sizeof(record.PositionOffset));
+        std::memcpy(record.BoundsMin, description.BoundsMin, sizeof(record.BoundsMin));
+        std::memcpy(record.BoundsMax, description.BoundsMax, sizeof(record.BoundsMax));
+        record.IndexType = description.IndexType;
+        record.LevelCount = (uint32_t) description.Levels.size();
+
+        record.LevelsOffset = offset;
+        offset += description.Levels.size() * sizeof(LevelRecord);
+
+        record.DiffuseTextureOffset = offset;
+        record.DiffuseTextureLength = description.DiffuseTexture.size();
+        offset += description.DiffuseTexture.size();
+
+        record.VerticesOffset = AlignUp(offset, kBlobAlignment);
+        record.VertexBytes = meshes[m].VertexBytes;
+        offset = record.VerticesOffset + record.VertexBytes;
+
+        record.IndicesOffset = AlignUp(offset, kBlobAlignment);
+        record.IndexBytes = meshes[m].IndexBytes;
+        offset = record.IndicesOffset + record.IndexBytes;
+    }
+
+    header.FileSize = offset;
+
+    std::ofstream out(filename, std::ios::binary);
+    if (!out)
+    {
+        throw std::runtime_error(std::string("Failed to open ") + filename + " for writing");
+    }
+
+    uint64_t written = 0;
+    auto write = [&](const void* data, uint64_t size) {
+        out.write((const char*) data, (std::streamsize) size);
+        written += size;
+    };
+    auto padTo = [&](uint64_t target) {
+        static const char zeros[kBlobAlignment] = {};
+        write(zeros, target - written);
+    };
+
+    write(&header, sizeof(header));
+    write(records.data(), records.size() * sizeof(MeshRecord));
+
+    for (size_t m = 0; m < meshes.size(); m++)
+    {
+        const MeshDescription& description = *meshes[m].pDescription;
+        const MeshRecord& record = records[m];
+
+        for (const StaticMeshLevel& level : description.Levels)
+        {
+            LevelRecord levelRecord = {};
+            levelRecord.FirstIndex = level.FirstIndex;
+            levelRecord.IndexCount = level.IndexCount;
+            levelRecord.Error = level.Error;
+            write(&levelRecord, sizeof(levelRecord));
+        }
+
+        write(description.DiffuseTexture.data(), description.DiffuseTexture.size());
+
+        padTo(record.VerticesOffset);
+        write(meshes[m].pVertices, meshes[m].VertexBytes);
+
+        padTo(record.IndicesOffset);
+        write(meshes[m].pIndices, meshes[m].IndexBytes);
+    }
+
+    if (!out)
+    {
+        throw std::runtime_error(std::string("Failed to write ") + filename);
+    }
+}
+
+struct MeshFile::Mapping
+{
+    const unsigned char* pData = nullptr;
+    size_t Size = 0;
+
+#ifdef _WIN32
+    HANDLE File = INVALID_HANDLE_VALUE;
+    HANDLE FileMapping = NULL;
+
+    explicit Mapping(const char* filename)
+    {
+        File = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        LARGE_INTEGER fileSize;
+        if (File == INVALID_HANDLE_VALUE || !GetFileSizeEx(File, &fileSize))
+        {
+            Close();
+            throw std::runtime_error(std::string("Failed to open ") + filename);
+        }
+        Size = (size_t) fileSize.QuadPart;
+
+        if (Size != 0)
+        {
+            FileMapping = CreateFileMappingA(File, NULL, PAGE_READONLY, 0, 0, NULL);
+            pData = FileMapping ? (const unsigned char*) MapViewOfFile(FileMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (!pData)
+            {
+                Close();
+                throw std::runtime_error(std::string("Failed to map ") + filename);
+            }
+        }
+    }
+
+    void Close()
+    {
+        if (pData) UnmapViewOfFile(pData);
+        if (FileMapping) CloseHandle(FileMapping);
+        if (File != INVALID_HANDLE_VALUE) CloseHandle(File);
+        pData = nullptr;
+        FileMapping = NULL;
+        File = INVALID_HANDLE_VALUE;
+    }
+#else
+    explicit Mapping(const char* filename)
+    {
+        int fd = open(filename, O_RDONLY);
+        struct stat status;
+        if (fd < 0 || fstat(fd, &status) != 0)
+        {
+            if (fd >= 0) close(fd);
+            throw std::runtime_error(std::string("Failed to open ") + filename);
+        }
+        Size = (size_t) status.st_size;
+
+        if (Size != 0)
+        {
+            void* pMapped = mmap(NULL, Size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (pMapped == MAP_FAILED)
+            {
+                close(fd);
+                throw std::runtime_error(std::string("Failed to map ") + filename);
+            }
+            pData = (const unsigned char*) pMapped;
+
+            // it's all about to be uploaded, front to back
+            madvise(pMapped, Size, MADV_WILLNEED);
+        }
+
+        // the mapping keeps the file open
+        close(fd);
+    }
+
+    void Close()
+    {
+        if (pData) munmap((void*) pData, Size);
+        pData = nullptr;
+    }
+#endif
+
+    ~Mapping()
+    {
+        Close();
+    }
+};
+
+MeshFile::MeshFile(const char* filename)
+    : mpMapping(new Mapping(filename))
+{
+    const unsigned char* pData = mpMapping->pData;
+    uint64_t fileSize = mpMapping->Size;
+
+    auto fail = [&](const char* reason) {
+        throw std::runtime_error(std::string(filename) + ": " + reason);
+    };
+
+    // whether [offset, offset + size) is in the file, without overflowing
+    auto isInFile = [&](uint64_t offset, uint64_t size) {
+        return offset <= fileSize && size <= fileSize - offset;
+    };
+
+    if (!isInFile(0, sizeof(FileHeader)))
+    {
+        fail("too small for a .glmesh file");
+    }
+
+    FileHeader header;
+    std::memcpy(&header, pData, sizeof(header));
+    if (std::memcmp(header.Magic, kMagic, sizeof(kMagic)) != 0)
+    {
+        fail("not a .glmesh file");
+    }
+    if (header.ByteOrderMark != kByteOrderMark)
+    {
+        fail("written with a different byte order");
+    }
+    if (header.Version != kVersion)
+    {
+        fail(("version " + std::to_string(header.Version) + ", expected " + std::to_string(kVersion)).c_str());
+    }
+    if (header.FileSize != fileSize)
+    {
+        fail("truncated");
+    }
+    if (!isInFile(sizeof(FileHeader), (uint64_t) header.MeshCount * sizeof(MeshRecord)))
+    {
+        fail("mesh records past the end of the file");
+    }
+
+    mDescriptions.resize(header.MeshCount);
+    mMeshes.resize(header.MeshCount);
+
+    for (uint32_t m = 0; m < header.MeshCount; m++)
+    {
+        MeshRecord record;
+        std::memcpy(&record, pData + sizeof(FileHeader) + m * sizeof(MeshRecord), sizeof(record));
+
+        if (record.AttributeCount > kMaxFileAttributes)
+        {
+            fail("too many vertex attributes");
+        }
+        if (!isInFile(record.LevelsOffset, (uint64_t) record.LevelCount * sizeof(LevelRecord))
+         || !isInFile(record.DiffuseTextureOffset, record.DiffuseTextureLength)
+         || !isInFile(record.VerticesOffset, record.VertexBytes)
+         || !isInFile(record.IndicesOffset, record.IndexBytes))
+        {
+            fail("mesh data past the end of the file");
+        }
+        if (record.IndexType != GL_UNSIGNED_SHORT && record.IndexType != GL_UNSIGNED_INT)
+        {
+            fail("unknown index type");
+        }
+
+        MeshDescription& description = mDescriptions[m];
+        VertexLayout& layout = description.Layout;
+
+        for (uint32_t a = 0; a < record.AttributeCount; a++)
+        {
+            const AttributeRecord& attributeRecord = record.Attributes[a];
+            if (!std::memchr(attributeRecord.Name, '\0', kMaxAttributeName))
+            {
+                fail("vertex attribute name isn't terminated");
+            }
+
+            VertexAttributeLayout attribute;
+            attribute.Name = attributeRecord.Name;
+            attribute.Size = attributeRecord.Size;
+            attribute.Type = attributeRecord.Type;
+            attribute.Normalized = (GLboolean) attributeRecord.Normalized;
+            attribute.Offset = (GLsizei) attributeRecord.Offset;
+            layout.Attributes.push_back(attribute);
+        }
+
+        layout.Stride = (GLsizei) record.Stride;
+        std::memcpy(layout.PositionScale, record.PositionScale, sizeof(layout.PositionScale));
+        std::memcpy(layout.PositionOffset, record.PositionOffset, sizeof(layout.PositionOffset));
+        std::memcpy(description.BoundsMin, record.BoundsMin, sizeof(description.BoundsMin));
+        std::memcpy(description.BoundsMax, record.BoundsMax, sizeof(description.BoundsMax));
+        description.IndexType = record.IndexType;
+
+        uint64_t indexSize = record.IndexType == GL_UNSIGNED_SHORT ? 2 : 4;
+        uint64_t indexCount = record.IndexBytes / indexSize;
+        for (uint32_t l = 0; l < record.LevelCount; l++)
+        {
+            LevelRecord levelRecord;
+            std::memcpy(&levelRecord, pData + record.LevelsOffset + l * sizeof(LevelRecord), sizeof(levelRecord));
+            if (levelRecord.FirstIndex > indexCount || levelRecord.IndexCount > indexCount - levelRecord.FirstIndex)
+            {
+                fail("level past the end of the indices");
+            }
+            description.Levels.push_back({ (size_t) levelRecord.FirstIndex, (size_t) levelRecord.IndexCount, levelRecord.Error });
+        }
+
+        description.DiffuseTexture.assign((const char*) pData + record.DiffuseTextureOffset, (size_t) record.DiffuseTextureLength);
+
+        MeshDataView& view = mMeshes[m];
+        view.pDescription = &description;
+        view.pVertices = pData + record.VerticesOffset;
+        view.VertexBytes = (size_t) record.VertexBytes;
+        view.pIndices = pData + record.IndicesOffset;
+        view.IndexBytes = (size_t) record.IndexBytes;
+    }
+}
+
+MeshFile::~MeshFile()
+{
+}
+
+size_t MeshFile::GetFileSize() const
+{
+    return mpMapping->Size;
+}
+
+} // end namespace GLmesh
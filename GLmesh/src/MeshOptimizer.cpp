@@ -0,0 +1,308 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace GLmesh
+{
+
+double ComputeACMR(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize)
+{
+    if (indices.empty())
+    {
+        return 0.0;
+    }
+
+    // a vertex is in the FIFO if fewer than cacheSize misses happened since its own
+    std::vector<size_t> missedAt(vertexCount, 0);
+    size_t misses = 0;
+
+    for (uint32_t index : indices)
+    {
+        if (index >= vertexCount)
+        {
+            throw std::out_of_range("Index past the end of the vertices.");
+        }
+
+        if (missedAt[index] == 0 || misses - missedAt[index] >= cacheSize)
+        {
+            misses++;
+            missedAt[index] = misses;
+        }
+    }
+
+    return (double) misses / (indices.size() / 3);
+}
+
+// Forsyth's tuning. The simulated cache is LRU, bigger than most real FIFOs,
+// which makes the order good for a range of cache sizes.
+static const int kOptimizerCacheSize = 32;
+static const float kCacheDecayPower = 1.5f;
+static const float kLastTriangleScore = 0.75f;
+static const float kValenceBoostScale = 2.0f;
+static const float kValenceBoostPower = 0.5f;
+
+// past this many remaining triangles, the valence boost is too small to matter
+static const uint32_t kMaxScoredValence = 64;
+
+namespace
+{
+
+struct VertexScoreTable
+{
+    float CachePosition[kOptimizerCacheSize];
+    float Valence[kMaxScoredValence + 1];
+
+    VertexScoreTable()
+    {
+        for (int position = 0; position < kOptimizerCacheSize; position++)
+        {
+            if (position < 3)
+            {
+                // the triangle just added. equal scores, so it doesn't matter which way it's turned.
+                CachePosition[position] = kLastTriangleScore;
+            }
+            else
+            {
+                float scaler = 1.0f / (kOptimizerCacheSize - 3);
+                CachePosition[position] = std::pow(1.0f - (position - 3) * scaler, kCacheDecayPower);
+            }
+        }
+
+        Valence[0] = 0.0f;
+        for (uint32_t valence = 1; valence <= kMaxScoredValence; valence++)
+        {
+            // vertices with few triangles left get priority, so they're finished off and don't linger
+            Valence[valence] = kValenceBoostScale * std::pow((float) valence, -kValenceBoostPower);
+        }
+    }
+
+    float Score(int cachePosition, uint32_t remainingTriangles) const
+    {
+        if (remainingTriangles == 0)
+        {
+            return -1.0f;
+        }
+
+        float score = cachePosition >= 0 ? CachePosition[cachePosition] : 0.0f;
+        return score + Valence[std::min(remainingTriangles, kMaxScoredValence)];
+    }
+};
+
+} // end anonymous namespace
+
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    static const VertexScoreTable scoreTable;
+
+    if (indices.size() % 3 != 0)
+    {
+        throw std::runtime_error("Expected 3 indices per triangle.");
+    }
+
+    size_t triangleCount = indices.size() / 3;
+
+    // triangles of each vertex, not yet added. each vertex's list is
+    // adjacency[adjacencyStart[v]] to adjacency[adjacencyStart[v] + remaining[v]]
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t index : indices)
+    {
+        if (index >= vertexCount)
+        {
+            throw std::out_of_range("Index past the end of the vertices.");
+        }
+        remaining[index]++;
+    }
+
+    std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> filled(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            adjacency[filled[indices[i]]++] = (uint32_t) (i / 3);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        vertexScore[v] = scoreTable.Score(-1, remaining[v]);
+    }
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<bool> isAdded(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+    }
+
+    // most recently used first. has room for the triangle being added on top of a full cache.
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> newCache;
+    cache.reserve(kOptimizerCacheSize + 3);
+    newCache.reserve(kOptimizerCacheSize + 3);
+
+    std::vector<uint32_t> optimized;
+    optimized.reserve(indices.size());
+
+    // with nothing in the cache to go on, the next triangle is the next one not added yet, in the old order
+    size_t nextUnadded = 0;
+    int64_t best = triangleCount ? std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin() : -1;
+
+    for (size_t added = 0; added < triangleCount; added++)
+    {
+        if (best < 0)
+        {
+            while (isAdded[nextUnadded])
+            {
+                nextUnadded++;
+            }
+            best = (int64_t) nextUnadded;
+        }
+
+        const uint32_t* triangle = &indices[best * 3];
+        optimized.insert(optimized.end(), triangle, triangle + 3);
+        isAdded[best] = true;
+
+        newCache.assign(triangle, triangle + 3);
+        for (int corner = 0; corner < 3; corner++)
+        {
+            uint32_t v = triangle[corner];
+
+            uint32_t* first = &adjacency[adjacencyStart[v]];
+            uint32_t* last = first + remaining[v] - 1;
+            *std::find(first, last + 1, (uint32_t) best) = *last;
+            remaining[v]--;
+        }
+
+        for (uint32_t v : cache)
+        {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+            {
+                newCache.push_back(v);
+            }
+        }
+        cache.swap(newCache);
+
+        // rescore everything whose place in the cache changed, including what fell out of it
+        for (size_t position = 0; position < cache.size(); position++)
+        {
+            uint32_t v = cache[position];
+            cachePosition[v] = position < (size_t) kOptimizerCacheSize ? (int) position : -1;
+
+            float score = scoreTable.Score(cachePosition[v], remaining[v]);
+            float change = score - vertexScore[v];
+            vertexScore[v] = score;
+
+            for (uint32_t i = adjacencyStart[v]; i < adjacencyStart[v] + remaining[v]; i++)
+            {
+                triangleScore[adjacency[i]] += change;
+            }
+        }
+
+        if (cache.size() > (size_t) kOptimizerCacheSize)
+        {
+            cache.resize(kOptimizerCacheSize);
+        }
+
+        best = -1;
+        float bestScore = -1.0f;
+        for (uint32_t v : cache)
+        {
+            for (uint32_t i = adjacencyStart[v]; i < adjacencyStart[v] + remaining[v]; i++)
+            {
+                uint32_t t = adjacency[i];
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+    }
+
+    return optimized;
+}
+
+std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    static const uint32_t kUnused = UINT32_MAX;
+    std::vector<uint32_t> newNumber(vertexCount, kUnused);
+
+    std::vector<uint32_t> order;
+    order.reserve(vertexCount);
+
+    for (uint32_t& index : indices)
+    {
+        if (index >= vertexCount)
+        {
+            throw std::out_of_range("Index past the end of the vertices.");
+        }
+
+        if (newNumber[index] == kUnused)
+        {
+            newNumber[index] = (uint32_t) order.size();
+            order.push_back(index);
+        }
+        index = newNumber[index];
+    }
+
+    return order;
+}
+
+std::vector<unsigned char> RemapVertices(const std::vector<unsigned char>& vertices, size_t stride,
+                                         const std::vector<uint32_t>& order)
+{
+    std::vector<unsigned char> remapped(order.size() * stride);
+    for (size_t v = 0; v < order.size(); v++)
+    {
+        std::memcpy(&remapped[v * stride], &vertices[order[v] * stride], stride);
+    }
+    return remapped;
+}
+
+GLenum ChooseIndexType(size_t vertexCount)
+{
+    return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+std::vector<unsigned char> PackIndices(const std::vector<uint32_t>& indices, GLenum indexType)
+{
+    std::vector<unsigned char> packed;
+
+    if (indexType == GL_UNSIGNED_SHORT)
+    {
+        packed.resize(indices.size() * sizeof(uint16_t));
+        uint16_t* shorts = (uint16_t*) packed.data();
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            if (indices[i] > UINT16_MAX)
+            {
+                throw std::out_of_range("Index doesn't fit in 16 bits.");
+            }
+            shorts[i] = (uint16_t) indices[i];
+        }
+    }
+    else if (indexType == GL_UNSIGNED_INT)
+    {
+        packed.resize(indices.size() * sizeof(uint32_t));
+        std::memcpy(packed.data(), indices.data(), packed.size());
+    }
+    else
+    {
+        throw std::invalid_argument("Indices are packed as GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.");
+    }
+
+    return packed;
+}
+
+} // end namespace GLmesh
@@ -0,0 +1,374 @@
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace GLmesh
+{
+
+// levels smaller than this aren't worth a draw call of their own
+static const size_t kMinLevelTriangles = 32;
+
+// a level that couldn't lose a quarter of the triangles of the one before it isn't kept
+static const double kMinLevelReduction = 0.75;
+
+namespace
+{
+
+// Sum of squared distances to a set of planes, each weighted by the area of its triangle.
+// Divided by the total weight, it's the mean squared distance.
+struct Quadric
+{
+    double A2 = 0, AB = 0, AC = 0, AD = 0;
+    double B2 = 0, BC = 0, BD = 0;
+    double C2 = 0, CD = 0;
+    double D2 = 0;
+    double Weight = 0;
+
+    void AddPlane(double a, double b, double c, double d, double weight)
+    {
+        A2 += weight * a * a; AB += weight * a * b; AC += weight * a * c; AD += weight * a * d;
+        B2 += weight * b * b; BC += weight * b * c; BD += weight * b * d;
+        C2 += weight * c * c; CD += weight * c * d;
+        D2 += weight * d * d;
+        Weight += weight;
+    }
+
+    void Add(const Quadric& other)
+    {
+        A2 += other.A2; AB += other.AB; AC += other.AC; AD += other.AD;
+        B2 += other.B2; BC += other.BC; BD += other.BD;
+        C2 += other.C2; CD += other.CD;
+        D2 += other.D2;
+        Weight += other.Weight;
+    }
+
+    double Evaluate(const float* p) const
+    {
+        double x = p[0], y = p[1], z = p[2];
+        return A2 * x * x + B2 * y * y + C2 * z * z
+             + 2.0 * (AB * x * y + AC * x * z + BC * y * z)
+             + 2.0 * (AD * x + BD * y + CD * z)
+             + D2;
+    }
+};
+
+struct Collapse
+{
+    double Cost; // mean squared distance the collapse moves the surface by, which orders collapses
+    uint32_t From;
+    uint32_t To;
+
+    bool operator<(const Collapse& other) const { return Cost < other.Cost; }
+};
+
+} // end anonymous namespace
+
+static void Cross(const float* a, const float* b, const float* c, double* normal)
+{
+    double ab[3] = { (double) b[0] - a[0], (double) b[1] - a[1], (double) b[2] - a[2] };
+    double ac[3] = { (double) c[0] - a[0], (double) c[1] - a[1], (double) c[2] - a[2] };
+    normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+    normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+    normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+}
+
+static uint64_t EdgeKey(uint32_t from, uint32_t to)
+{
+    return ((uint64_t) from << 32) | to;
+}
+
+// Largest distance from point to the planes, 4 floats each in planes.
+static double MaxPlaneDistance(const float* point, const std::vector<uint32_t>& planeIndices, const std::vector<float>& planes)
+{
+    double distance = 0.0;
+    for (uint32_t plane : planeIndices)
+    {
+        const float* p = &planes[plane * 4];
+        distance = std::max(distance, std::abs((double) p[0] * point[0] + (double) p[1] * point[1] + (double) p[2] * point[2] + p[3]));
+    }
+    return distance;
+}
+
+std::vector<uint32_t> SimplifyMesh(
+        const std::vector<uint32_t>& indices,
+        const std::vector<float>& positions,
+        size_t targetIndexCount,
+        float maxError,
+        float* resultError)
+{
+    if (indices.size() % 3 != 0)
+    {
+        throw std::runtime_error("Expected 3 indices per triangle.");
+    }
+
+    size_t vertexCount = positions.size() / 3;
+    for (uint32_t index : indices)
+    {
+        if (index >= vertexCount)
+        {
+            throw std::out_of_range("Index past the end of the vertices.");
+        }
+    }
+
+    std::vector<uint32_t> result = indices;
+    double worstError = 0.0;
+
+    // The quadrics' mean distances pick which collapses go first, but they shrink as a vertex takes in more
+    // of the surface around it, so they don't bound the error. Each vertex also keeps the planes of the
+    // triangles that have collapsed into it, and the error of a collapse is its furthest distance to them.
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<float> planes;
+    std::vector<std::vector<uint32_t>> vertexPlanes(vertexCount);
+    for (size_t t = 0; t < result.size(); t += 3)
+    {
+        const float* p0 = &positions[result[t] * 3];
+        const float* p1 = &positions[result[t + 1] * 3];
+        const float* p2 = &positions[result[t + 2] * 3];
+
+        double normal[3];
+        Cross(p0, p1, p2, normal);
+        double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length == 0.0)
+        {
+            continue;
+        }
+
+        double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+        double d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+        double area = length * 0.5;
+        uint32_t plane = (uint32_t) (planes.size() / 4);
+        planes.insert(planes.end(), { (float) a, (float) b, (float) c, (float) d });
+        for (int corner = 0; corner < 3; corner++)
+        {
+            quadrics[result[t + corner]].AddPlane(a, b, c, d, area);
+            vertexPlanes[result[t + corner]].push_back(plane);
+        }
+    }
+
+    // an edge only one triangle uses is on a border, or a seam. its vertices stay put.
+    std::vector<bool> isLocked(vertexCount, false);
+    {
+        std::unordered_set<uint64_t> edges;
+        edges.reserve(result.size());
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            for (int corner = 0; corner < 3; corner++)
+            {
+                edges.insert(EdgeKey(result[t + corner], result[t + (corner + 1) % 3]));
+            }
+        }
+        for (uint64_t edge : edges)
+        {
+            uint32_t from = (uint32_t) (edge >> 32), to = (uint32_t) edge;
+            if (!edges.count(EdgeKey(to, from)))
+            {
+                isLocked[from] = true;
+                isLocked[to] = true;
+            }
+        }
+    }
+
+    std::vector<uint32_t> adjacencyStart(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<bool> isTouched(vertexCount);
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<Collapse> collapses;
+
+    // Each pass collapses the cheapest edges it can without two collapses touching the same triangles,
+    // so the adjacency built at the start of the pass stays right for every collapse it makes.
+    while (result.size() > targetIndexCount)
+    {
+        size_t triangleCount = result.size() / 3;
+
+        std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+        for (uint32_t index : result)
+        {
+            adjacencyStart[index + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            adjacencyStart[v + 1] += adjacencyStart[v];
+        }
+        adjacency.resize(result.size());
+        {
+            std::vector<uint32_t> filled(adjacencyStart.begin(), adjacencyStart.end() - 1);
+            for (size_t i = 0; i < result.size(); i++)
+            {
+                adjacency[filled[result[i]]++] = (uint32_t) (i / 3);
+            }
+        }
+
+        collapses.clear();
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            for (int corner = 0; corner < 3; corner++)
+            {
+                uint32_t a = result[t + corner];
+                uint32_t b = result[t + (corner + 1) % 3];
+
+                // the triangle on the other side has this edge the other way around, and skips it
+                if (a > b)
+                {
+                    continue;
+                }
+
+                Quadric merged = quadrics[a];
+                merged.Add(quadrics[b]);
+                double weight = std::max(merged.Weight, DBL_MIN);
+
+                if (!isLocked[a])
+                {
+                    collapses.push_back({ std::max(merged.Evaluate(&positions[b * 3]) / weight, 0.0), a, b });
+                }
+                if (!isLocked[b])
+                {
+                    collapses.push_back({ std::max(merged.Evaluate(&positions[a * 3]) / weight, 0.0), b, a });
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end());
+
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            remap[v] = (uint32_t) v;
+        }
+        std::fill(isTouched.begin(), isTouched.end(), false);
+
+        // most collapses remove two triangles
+        size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+        size_t collapsesLeft = (trianglesToRemove + 1) / 2;
+        size_t collapsed = 0;
+
+        for (const Collapse& collapse : collapses)
+        {
+            if (collapsed == collapsesLeft)
+            {
+                break;
+            }
+
+            if (isTouched[collapse.From] || isTouched[collapse.To])
+            {
+                continue;
+            }
+
+            const float* to = &positions[collapse.To * 3];
+            double error = std::max(MaxPlaneDistance(to, vertexPlanes[collapse.From], planes),
+                                    MaxPlaneDistance(to, vertexPlanes[collapse.To], planes));
+            if (error > maxError)
+            {
+                continue;
+            }
+
+            // the triangles that keep existing mustn't turn over
+            bool isFlipping = false;
+            for (uint32_t i = adjacencyStart[collapse.From]; i < adjacencyStart[collapse.From + 1] && !isFlipping; i++)
+            {
+                const uint32_t* triangle = &result[adjacency[i] * 3];
+                if (triangle[0] == collapse.To || triangle[1] == collapse.To || triangle[2] == collapse.To)
+                {
+                    continue;
+                }
+
+                const float* before[3];
+                const float* after[3];
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    before[corner] = &positions[triangle[corner] * 3];
+                    after[corner] = triangle[corner] == collapse.From ? &positions[collapse.To * 3] : before[corner];
+                }
+
+                double normalBefore[3], normalAfter[3];
+                Cross(before[0], before[1], before[2], normalBefore);
+                Cross(after[0], after[1], after[2], normalAfter);
+                double dot = normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2];
+                isFlipping = dot <= 0.0;
+            }
+
+            if (isFlipping)
+            {
+                continue;
+            }
+
+            remap[collapse.From] = collapse.To;
+            quadrics[collapse.To].Add(quadrics[collapse.From]);
+            worstError = std::max(worstError, error);
+            collapsed++;
+
+            std::vector<uint32_t>& toPlanes = vertexPlanes[collapse.To];
+            std::vector<uint32_t>& fromPlanes = vertexPlanes[collapse.From];
+            toPlanes.insert(toPlanes.end(), fromPlanes.begin(), fromPlanes.end());
+            std::sort(toPlanes.begin(), toPlanes.end());
+            toPlanes.erase(std::unique(toPlanes.begin(), toPlanes.end()), toPlanes.end());
+            std::vector<uint32_t>().swap(fromPlanes);
+
+            // the rest of this pass leaves everything around the collapse alone
+            for (uint32_t i = adjacencyStart[collapse.From]; i < adjacencyStart[collapse.From + 1]; i++)
+            {
+                const uint32_t* triangle = &result[adjacency[i] * 3];
+                isTouched[triangle[0]] = true;
+                isTouched[triangle[1]] = true;
+                isTouched[triangle[2]] = true;
+            }
+        }
+
+        if (collapsed == 0)
+        {
+            break;
+        }
+
+        size_t kept = 0;
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            uint32_t a = remap[result[t]], b = remap[result[t + 1]], c = remap[result[t + 2]];
+            if (a != b && b != c && c != a)
+            {
+                result[kept++] = a;
+                result[kept++] = b;
+                result[kept++] = c;
+            }
+        }
+        result.resize(kept);
+    }
+
+    if (resultError)
+    {
+        *resultError = (float) worstError;
+    }
+
+    return result;
+}
+
+std::vector<MeshLevel> BuildLevelsOfDetail(
+        const std::vector<uint32_t>& indices,
+        const std::vector<float>& positions,
+        size_t maxLevels)
+{
+    std::vector<MeshLevel> levels;
+    levels.push_back({ indices, 0.0f });
+
+    while (levels.size() < maxLevels && levels.back().Indices.size() / 3 >= kMinLevelTriangles * 2)
+    {
+        const MeshLevel& previous = levels.back();
+
+        float error;
+        std::vector<uint32_t> simplified = SimplifyMesh(
+                    previous.Indices, positions, previous.Indices.size() / 6 * 3, FLT_MAX, &error);
+
+        if (simplified.size() > previous.Indices.size() * kMinLevelReduction)
+        {
+            break;
+        }
+
+        // measured against the level before, so the errors add up
+        levels.push_back({ std::move(simplified), previous.Error + error });
+    }
+
+    return levels;
+}
+
+} // end namespace GLmesh
@@ -0,0 +1,237 @@
+#include "VertexFormat.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace GLmesh
+{
+
+// round to nearest even, like the GPU does
+static uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t floatExponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (floatExponent == 0xFF)
+    {
+        // infinity stays infinity, NaN stays NaN
+        return (uint16_t) (sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+
+    int exponent = (int) floatExponent - 127 + 15;
+    if (exponent >= 31)
+    {
+        return (uint16_t) (sign | 0x7C00);
+    }
+
+    if (exponent <= 0)
+    {
+        // too small for a normal half, so denormal or zero
+        if (exponent < -10)
+        {
+            return (uint16_t) sign;
+        }
+
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t) (14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+        {
+            half++;
+        }
+        return (uint16_t) (sign | half);
+    }
+
+    uint32_t half = ((uint32_t) exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFF;
+    // a carry out of the mantissa correctly bumps the exponent, up to infinity
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return (uint16_t) (sign | half);
+}
+
+static uint16_t FloatToUnorm16(float value)
+{
+    return (uint16_t) std::lround(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f);
+}
+
+static uint32_t PackSnorm10(float value)
+{
+    long snorm = std::lround(std::min(std::max(value, -1.0f), 1.0f) * 511.0f);
+    return (uint32_t) snorm & 0x3FF;
+}
+
+static void AddAttribute(VertexLayout& layout, const char* name, GLint size, GLenum type, GLboolean normalized, GLsizei bytes)
+{
+    VertexAttributeLayout attribute;
+    attribute.Name = name;
+    attribute.Size = size;
+    attribute.Type = type;
+    attribute.Normalized = normalized;
+    attribute.Offset = layout.Stride;
+    layout.Attributes.push_back(attribute);
+
+    // every attribute starts on 4 bytes
+    layout.Stride += (bytes + 3) & ~3;
+}
+
+InterleavedVertices InterleaveVertices(
+        const std::vector<float>& positions,
+        const std::vector<float>& normals,
+        const std::vector<float>& texcoords,
+        const VertexFormat& format)
+{
+    if (positions.size() % 3 != 0)
+    {
+        throw std::runtime_error("Expected 3 floats per position.");
+    }
+
+    size_t vertexCount = positions.size() / 3;
+    bool hasNormals = !normals.empty();
+    bool hasTexcoords = !texcoords.empty();
+
+    if (hasNormals && normals.size() != vertexCount * 3)
+    {
+        throw std::runtime_error("Expected a normal per position.");
+    }
+
+    if (hasTexcoords && texcoords.size() != vertexCount * 2)
+    {
+        throw std::runtime_error("Expected a texcoord per position.");
+    }
+
+    InterleavedVertices vertices;
+    vertices.VertexCount = vertexCount;
+    VertexLayout& layout = vertices.Layout;
+
+    if (format.Position == PositionEncoding::Unorm16)
+    {
+        AddAttribute(layout, "position", 3, GL_UNSIGNED_SHORT, GL_TRUE, 3 * sizeof(uint16_t));
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float minimum = vertexCount ? positions[axis] : 0.0f;
+            float maximum = minimum;
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                minimum = std::min(minimum, positions[v * 3 + axis]);
+                maximum = std::max(maximum, positions[v * 3 + axis]);
+            }
+            layout.PositionScale[axis] = maximum - minimum;
+            layout.PositionOffset[axis] = minimum;
+        }
+    }
+    else
+    {
+        AddAttribute(layout, "position", 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float));
+    }
+
+    if (hasNormals)
+    {
+        if (format.Normal == NormalEncoding::Int2101010)
+        {
+            AddAttribute(layout, "normal", 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(uint32_t));
+        }
+        else
+        {
+            AddAttribute(layout, "normal", 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float));
+        }
+    }
+
+    if (hasTexcoords)
+    {
+        if (format.Texcoord == TexcoordEncoding::Half)
+        {
+            AddAttribute(layout, "texcoord0", 2, GL_HALF_FLOAT, GL_FALSE, 2 * sizeof(uint16_t));
+        }
+        else if (format.Texcoord == TexcoordEncoding::Unorm16)
+        {
+            AddAttribute(layout, "texcoord0", 2, GL_UNSIGNED_SHORT, GL_TRUE, 2 * sizeof(uint16_t));
+        }
+        else
+        {
+            AddAttribute(layout, "texcoord0", 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float));
+        }
+    }
+
+    vertices.Data.resize(vertexCount * layout.Stride);
+
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        unsigned char* vertex = &vertices.Data[v * layout.Stride];
+        const VertexAttributeLayout* attribute = layout.Attributes.data();
+
+        if (format.Position == PositionEncoding::Unorm16)
+        {
+            uint16_t quantized[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float extent = layout.PositionScale[axis];
+                float relative = extent > 0.0f ? (positions[v * 3 + axis] - layout.PositionOffset[axis]) / extent : 0.0f;
+                quantized[axis] = FloatToUnorm16(relative);
+            }
+            std::memcpy(vertex + attribute->Offset, quantized, sizeof(quantized));
+        }
+        else
+        {
+            std::memcpy(vertex + attribute->Offset, &positions[v * 3], 3 * sizeof(float));
+        }
+        attribute++;
+
+        if (hasNormals)
+        {
+            if (format.Normal == NormalEncoding::Int2101010)
+            {
+                uint32_t packed = PackSnorm10(normals[v * 3 + 0])
+                               | (PackSnorm10(normals[v * 3 + 1]) << 10)
+                               | (PackSnorm10(normals[v * 3 + 2]) << 20);
+                std::memcpy(vertex + attribute->Offset, &packed, sizeof(packed));
+            }
+            else
+            {
+                std::memcpy(vertex + attribute->Offset, &normals[v * 3], 3 * sizeof(float));
+            }
+            attribute++;
+        }
+
+        if (hasTexcoords)
+        {
+            float s = texcoords[v * 2 + 0];
+            float t = texcoords[v * 2 + 1];
+            if (format.Texcoord == TexcoordEncoding::Half)
+            {
+                uint16_t packed[2] = { FloatToHalf(s), FloatToHalf(t) };
+                std::memcpy(vertex + attribute->Offset, packed, sizeof(packed));
+            }
+            else if (format.Texcoord == TexcoordEncoding::Unorm16)
+            {
+                if (s < 0.0f || s > 1.0f || t < 0.0f || t > 1.0f)
+                {
+                    throw std::runtime_error("Unorm16 texcoords must be within [0,1].");
+                }
+                uint16_t packed[2] = { FloatToUnorm16(s), FloatToUnorm16(t) };
+                std::memcpy(vertex + attribute->Offset, packed, sizeof(packed));
+            }
+            else
+            {
+                std::memcpy(vertex + attribute->Offset, &texcoords[v * 2], 2 * sizeof(float));
+            }
+            attribute++;
+        }
+    }
+
+    return vertices;
+}
+
+} // end namespace GLmesh
@@ -0,0 +1,107 @@
+// Converts an OBJ file into a .glmesh file, doing all of StaticMesh::LoadShape's work
+// ahead of time, so that loading the result at runtime is only mapping it and uploading.
+// Every shape of the OBJ becomes a mesh of the .glmesh file, in the same order.
+
+#include <MeshData.hpp>
+#include <MeshFile.hpp>
+
+#include <tiny_obj_loader.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Builds each shape's mesh data as tinyobj hands it over, so only the
+// compact result of every shape is kept, not the shapes themselves.
+class MeshDataBuilder : public tinyobj::shape_visitor
+{
+    std::vector<tinyobj::material_t> mMaterials;
+    const GLmesh::VertexFormat& mFormat;
+
+public:
+    std::vector<GLmesh::MeshData> Meshes;
+
+    explicit MeshDataBuilder(const GLmesh::VertexFormat& format)
+        : mFormat(format)
+    { }
+
+    void visit_materials(std::vector<tinyobj::material_t>& materials) override
+    {
+        mMaterials.swap(materials);
+    }
+
+    void visit_shape(tinyobj::shape_t& shape) override
+    {
+        Meshes.push_back(GLmesh::BuildMeshData(shape, mMaterials, mFormat));
+    }
+};
+
+static const char* kUsage =
+    "usage: obj_to_glmesh [options] <input.obj> <output.glmesh>\n"
+    "  --float-vertices   store vertices as floats instead of quantizing them\n";
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        GLmesh::VertexFormat format;
+        std::vector<const char*> files;
+
+        for (int i = 1; i < argc; i++)
+        {
+            if (!strcmp(argv[i], "--float-vertices"))
+            {
+                format.Position = GLmesh::PositionEncoding::Float;
+                format.Normal = GLmesh::NormalEncoding::Float;
+                format.Texcoord = GLmesh::TexcoordEncoding::Float;
+            }
+            else if (!strcmp(argv[i], "--help"))
+            {
+                printf("%s", kUsage);
+                return 0;
+            }
+            else if (argv[i][0] == '-')
+            {
+                fprintf(stderr, "%s", kUsage);
+                throw std::runtime_error(std::string("Unknown argument: ") + argv[i]);
+            }
+            else
+            {
+                files.push_back(argv[i]);
+            }
+        }
+
+        if (files.size() != 2)
+        {
+            fprintf(stderr, "%s", kUsage);
+            return 1;
+        }
+
+        // materials are looked up next to the OBJ, but texture names are kept as the MTL has them
+        std::string objFile = files[0];
+        size_t slash = objFile.find_last_of("/\\");
+        std::string mtlBasePath = slash == std::string::npos ? "" : objFile.substr(0, slash + 1);
+
+        // big models are what the tool is for, so they get every core
+        MeshDataBuilder builder(format);
+        tinyobj::LoadObj(builder, objFile.c_str(), mtlBasePath.c_str(), 0);
+
+        std::vector<GLmesh::MeshDataView> views;
+        for (const GLmesh::MeshData& mesh : builder.Meshes)
+        {
+            views.push_back(mesh.GetView());
+        }
+
+        GLmesh::WriteMeshFile(files[1], views);
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Fatal exception: %s\n", e.what());
+        return 1;
+    }
+}
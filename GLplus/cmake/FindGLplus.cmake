@@ -9,6 +9,7 @@
 find_package(OpenGL REQUIRED)
 find_package(glew REQUIRED)
 find_package(soil2 REQUIRED)
+find_package(Profiler REQUIRED)
 
 set(GLplus_FOUND TRUE)
 set(GLplus_INCLUDE_DIR ${CMAKE_CURRENT_LIST_DIR}/../include)
@@ -16,10 +17,12 @@ set(GLplus_INCLUDE_DIRS
     ${GLplus_INCLUDE_DIR}
     ${OPENGL_INCLUDE_DIR}
     ${glew_INCLUDE_DIR}
-    ${soil2_INCLUDE_DIR})
+    ${soil2_INCLUDE_DIR}
+    ${Profiler_INCLUDE_DIRS})
 set(GLplus_LIBRARY GLplus)
 set(GLplus_DEPENDENCIES
     ${OPENGL_LIBRARIES}
     ${glew_LIBRARIES}
-    ${soil2_LIBRARY})
+    ${soil2_LIBRARY}
+    ${Profiler_LIBRARIES})
 set(GLplus_LIBRARIES ${GLplus_LIBRARY} ${GLplus_DEPENDENCIES})
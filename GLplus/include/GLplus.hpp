@@ -3,13 +3,92 @@
 
 #include <GL/glew.h>
 
+#include <array>
+#include <cstdint>
+#include <iosfwd>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace GLplus
 {
 
+// How GL errors are found. GLplus checks after each of its GL calls, and CheckFrameErrors
+// is meant to be called once per frame, after swapping buffers. What those checks do depends on the mode.
+enum class ErrorCheckMode
+{
+    // glGetError after every call. Errors are thrown where they happen, but each check waits on the driver.
+    EveryCall,
+    // glGetError only in CheckFrameErrors. Costs one check per frame, but only tells which frame failed.
+    PerFrame,
+    // GL reports errors through a KHR_debug callback as they happen, without being asked.
+    // They are thrown by the next check, naming the GL call that caused them.
+    DebugCallback,
+    // no checks at all
+    Off
+};
+
+// The mode starts as the GLPLUS_ERROR_CHECK_MODE CMake option picks, or else as EveryCall
+// in debug builds and Off in builds with NDEBUG, so that they never wait on glGetError.
+// Needs a current context. Switching to DebugCallback throws if the context has no KHR_debug.
+void SetErrorCheckMode(ErrorCheckMode mode);
+ErrorCheckMode GetErrorCheckMode();
+
+// "every-call", "per-frame", "debug-callback" or "off". Throws std::invalid_argument for anything else.
+ErrorCheckMode ErrorCheckModeFromString(const char* name);
+
+// Throws std::runtime_error for errors found by the current mode.
 void CheckGLErrors();
+void CheckFrameErrors();
+
+// GLplus remembers what it last bound on each thread, so scoped bindings restore without asking GL
+// and binding what's already bound is skipped. Bindings it doesn't know yet are asked of GL once.
+// Call this after binding anything with GL directly, or after making another context current,
+// so that every binding is asked of GL again.
+void ResetBindingCache();
+
+// Counts of the GL work GLplus asked for, per frame and per call site.
+// Only collected once SetCollecting(true) is called, otherwise IsCollected is false and every count stays zero.
+// GL calls made outside GLplus, including the ones SOIL makes while loading images, aren't counted.
+struct FrameStats
+{
+    // A line in GLplus that calls into GL
+    struct CallSite
+    {
+        const char* EntryPoint; // e.g. "glBindBuffer"
+        std::string Function;   // e.g. "BufferBinding::BufferBinding"
+        int Line;
+        size_t Calls;
+    };
+
+    bool IsCollected = false;
+
+    size_t Calls = 0;           // all GL entry points, including the ones below
+    size_t DrawCalls = 0;       // glDraw*
+    size_t Binds = 0;           // glBind*, glUseProgram, glActiveTexture
+    size_t Queries = 0;         // glGet* and glCheck*, which may wait for the GPU. glGetError is counted apart.
+    size_t ErrorChecks = 0;     // glGetError
+    size_t UniformUploads = 0;  // glUniform*
+    size_t BufferBytesUploaded = 0; // through BufferBinding::Upload and Patch
+    size_t TextureBytesLoaded = 0;  // through LoadImage and LoadLayer
+
+    // Sites called since the frame began, most called first
+    std::vector<CallSite> CallSites;
+
+    // Off to begin with. Turning it on starts counting a new frame.
+    static void SetCollecting(bool collecting);
+    static bool IsCollecting();
+
+    // Counts of the frame in progress
+    static FrameStats GetCurrent();
+
+    // Ends the frame in progress, returning its counts, and starts counting the next one.
+    static FrameStats EndFrame();
+
+    // Totals on one line, then the busiest call sites, one per line.
+    void Dump(std::ostream& out, size_t maxCallSites = 10) const;
+};
 
 namespace detail
 {
@@ -45,13 +124,54 @@ public:
     GLuint GetGLHandle() const { return mHandle.mHandle; }
 };
 
+// An active uniform or vertex attribute of a linked program
+struct ProgramVariable
+{
+    std::string Name; // arrays are named without their "[0]"
+    GLint Location;
+    GLenum Type;      // e.g. GL_FLOAT_MAT4 or GL_SAMPLER_2D
+    GLint Size;       // elements of an array, 1 otherwise
+};
+
+// An active uniform block of a linked program
+struct ProgramUniformBlock
+{
+    std::string Name;
+    GLuint Index;
+    GLuint BindingPoint; // from GetUniformBlockBindingPoint
+    GLint DataSize;      // bytes the block takes in a buffer
+};
+
 class Program
 {
     detail::ObjectHandle mHandle;
     std::shared_ptr<Shader> mFragmentShader;
     std::shared_ptr<Shader> mVertexShader;
 
+    // found by Link, so looking up a location doesn't ask GL
+    std::unordered_map<std::string, ProgramVariable> mUniforms;
+    std::unordered_map<std::string, ProgramVariable> mAttributes;
+    std::unordered_map<std::string, ProgramUniformBlock> mUniformBlocks;
+
+    // what was last uploaded to each uniform location, so uploading the same again can be skipped.
+    // Each element of an array has its own, so uploading part of the array through an element's
+    // location changes what's remembered for those elements only.
+    std::unordered_map<GLint, std::vector<unsigned char>> mUniformValues;
+
+    // the location of the next element of the same array, for every element of a uniform array but the last
+    std::unordered_map<GLint, GLint> mNextElementLocations;
+
+    uint64_t mLinkSerial = 0;
+
+    void ReflectVariables();
+
+    // Returns false if the 'count' elements from the location already hold these bytes, 'elementSize'
+    // of them each, or if the location is -1. Otherwise remembers them.
+    bool ReplaceUniformValue(GLint location, const void* value, size_t elementSize, GLsizei count = 1);
+
 public:
+    friend class ProgramBinding;
+
     static Program FromFiles(const char* vShaderFile, const char* fShaderFile);
 
     Program();
@@ -70,9 +190,41 @@ public:
     bool TryGetUniformLocation(const GLchar* name, GLint& loc) const;
     GLint GetUniformLocation(const GLchar* name) const;
 
+    // null if the program has no such active variable. Uniforms in blocks aren't included.
+    const ProgramVariable* FindUniform(const GLchar* name) const;
+    const ProgramVariable* FindAttribute(const GLchar* name) const;
+    const ProgramUniformBlock* FindUniformBlock(const GLchar* name) const;
+
+    const std::unordered_map<std::string, ProgramVariable>& GetUniforms() const { return mUniforms; }
+    const std::unordered_map<std::string, ProgramVariable>& GetAttributes() const { return mAttributes; }
+    const std::unordered_map<std::string, ProgramUniformBlock>& GetUniformBlocks() const { return mUniformBlocks; }
+
+    // Different for every successful Link of every program, unlike GL handles, which get reused.
+    // 0 before the first link.
+    uint64_t GetLinkSerial() const { return mLinkSerial; }
+
     GLuint GetGLHandle() const { return mHandle.mHandle; }
 };
 
+// A uniform's location, looked up by name the first time it's used with a program, and again only
+// when it's used with another program, or the same one linked again. Kept by the code that uploads
+// the uniform, so drawing doesn't look it up by name every time.
+class UniformHandle
+{
+    const GLchar* mName;
+    uint64_t mLinkSerial = 0;
+    GLint mLocation = -1;
+
+public:
+    // name must outlive the handle, as a string literal does.
+    explicit UniformHandle(const GLchar* name) : mName(name) { }
+
+    // -1 if the program has no such uniform, which GL ignores uploads to.
+    GLint GetLocation(const Program& program);
+
+    const GLchar* GetName() const { return mName; }
+};
+
 class ProgramBinding
 {
     Program& mProgram;
@@ -91,11 +243,19 @@ public:
     void UploadVec2(const GLchar* name, const GLfloat* const values) const;
     void UploadVec2(GLint location, const GLfloat* values) const;
 
+    void UploadVec3(const GLchar* name, GLfloat v0, GLfloat v1, GLfloat v2) const;
+    void UploadVec3(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) const;
+    void UploadVec3(const GLchar* name, const GLfloat* const values) const;
+    void UploadVec3(GLint location, const GLfloat* values) const;
+
     void UploadVec4(const GLchar* name, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) const;
     void UploadVec4(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) const;
     void UploadVec4(const GLchar* name, const GLfloat* const values) const;
     void UploadVec4(GLint location, const GLfloat* values) const;
 
+    void UploadVec4Array(const GLchar* name, GLsizei count, const GLfloat* values) const;
+    void UploadVec4Array(GLint location, GLsizei count, const GLfloat* values) const;
+
     void UploadMatrix4(const GLchar* name, GLboolean transpose, const GLfloat* values) const;
     void UploadMatrix4(GLint location, GLboolean transpose, const GLfloat* values) const;
 
@@ -172,10 +332,51 @@ public:
     const BufferBinding& GetBinding() const { return mBinding; }
 };
 
+// The binding point of the uniform blocks with this name. A name gets the next free point
+// the first time it's asked for, and Program::Link binds every block it finds to its name's point,
+// so programs sharing a block all read the UniformBuffer made for it.
+GLuint GetUniformBlockBindingPoint(const std::string& blockName);
+
+// Feeds the uniform block of the same name in every program.
+// Meant for data that changes every frame: each update replaces the whole buffer, orphaning the
+// old storage so the update doesn't wait for draws still reading it, and unchanged data is skipped.
+class UniformBuffer
+{
+    Buffer mBuffer;
+    std::string mBlockName;
+    GLuint mBindingPoint;
+    std::vector<unsigned char> mData; // as last uploaded
+
+public:
+    // The size should match the block's (std140) layout.
+    UniformBuffer(const std::string& blockName, GLsizeiptr size);
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    // Makes this the buffer its binding point reads. The constructor already does.
+    void Bind();
+
+    // Throws std::invalid_argument if size isn't the buffer's.
+    void Update(const void* data, GLsizeiptr size);
+
+    const std::string& GetBlockName() const { return mBlockName; }
+    GLuint GetBindingPoint() const { return mBindingPoint; }
+    GLsizeiptr GetSize() const { return (GLsizeiptr) mData.size(); }
+
+    GLuint GetGLHandle() const { return mBuffer.GetGLHandle(); }
+};
+
 class VertexArray
 {
+public:
+    // the fewest vertex attributes GL 3.2 promises. SetAttribute throws for indices past it.
+    static const GLuint kMaxAttributes = 16;
+
+private:
     detail::ObjectHandle mHandle;
-    std::unordered_map<GLuint, std::shared_ptr<Buffer> > mVertexBuffers;
+    // kept alive for as long as the attributes use them
+    std::array<std::shared_ptr<Buffer>, kMaxAttributes> mVertexBuffers;
     std::shared_ptr<Buffer> mIndexBuffer;
     GLenum mIndexType = 0;
 
@@ -210,6 +411,9 @@ public:
             GLsizei stride,
             GLsizei offset);
 
+    // Advance the attribute once per divisor instances instead of once per vertex.
+    void SetAttributeDivisor(GLuint index, GLuint divisor);
+
     void SetIndexBuffer(
             const std::shared_ptr<Buffer>& buffer,
             GLenum type);
@@ -236,6 +440,56 @@ public:
     const VertexArrayBinding& GetBinding() const { return mBinding; }
 };
 
+// Where a vertex attribute comes from. Programs are matched to it by Name.
+struct VertexAttributeSource
+{
+    std::string Name;
+    std::shared_ptr<Buffer> pBuffer;
+    GLint Size;
+    GLenum Type;
+    GLboolean Normalized;
+    GLsizei Stride;
+    GLsizei Offset;
+    GLuint Divisor; // 0 for per vertex data
+};
+
+// The vertex arrays of one set of buffers, built the first time they're drawn with a program
+// and kept until the sources change. Programs that put the attributes at the same locations share one.
+class VertexArrayCache
+{
+    std::vector<VertexAttributeSource> mSources;
+    std::shared_ptr<Buffer> mpIndexBuffer;
+    GLenum mIndexType = 0;
+
+    struct Layout
+    {
+        std::vector<GLint> Locations; // per source, -1 if the program doesn't use it
+        std::unique_ptr<VertexArray> pVertexArray;
+    };
+    std::vector<Layout> mLayouts;
+
+    // link serial -> index in mLayouts, for the programs seen so far
+    std::vector<std::pair<uint64_t, size_t>> mProgramLayouts;
+
+public:
+    VertexArrayCache() = default;
+    VertexArrayCache(const VertexArrayCache&) = delete;
+    VertexArrayCache& operator=(const VertexArrayCache&) = delete;
+
+    // Both drop the vertex arrays built so far.
+    void AddAttribute(const VertexAttributeSource& source);
+    void SetIndexBuffer(const std::shared_ptr<Buffer>& buffer, GLenum type);
+
+    // Forgets the sources and the vertex arrays.
+    void Clear();
+
+    // Returns the vertex array to draw with the program, building it if needed.
+    // The program must be linked.
+    VertexArray& Get(const Program& program);
+
+    size_t GetLayoutCount() const { return mLayouts.size(); }
+};
+
 class Texture2D
 {
     detail::ObjectHandle mHandle;
@@ -323,6 +577,63 @@ public:
     const Texture2DBinding& GetBinding() const { return mBinding; }
 };
 
+class Texture2DArray
+{
+    detail::ObjectHandle mHandle;
+
+public:
+    friend class Texture2DArrayBinding;
+
+    Texture2DArray();
+    ~Texture2DArray();
+
+    Texture2DArray(const Texture2DArray&) = delete;
+    Texture2DArray& operator=(const Texture2DArray&) = delete;
+    Texture2DArray(Texture2DArray&&) = default;
+    Texture2DArray& operator=(Texture2DArray&&) = default;
+
+    GLuint GetGLHandle() const { return mHandle.mHandle; }
+};
+
+class Texture2DArrayBinding
+{
+    Texture2DArray& mTexture2DArray;
+
+public:
+    Texture2DArrayBinding(Texture2DArray& texture2DArray);
+
+    // RGBA8 layers with no mipmaps, linearly filtered.
+    void CreateStorage(GLsizei width, GLsizei height, GLsizei layers);
+
+    // The image must have the same size as the layers. Flags are Texture2D::LoadFlags.
+    void LoadLayer(GLint layer, const char* filename, unsigned int flags);
+
+    int GetWidth() const;
+    int GetHeight() const;
+    int GetLayerCount() const;
+
+          Texture2DArray& GetTexture2DArray()       { return mTexture2DArray; }
+    const Texture2DArray& GetTexture2DArray() const { return mTexture2DArray; }
+};
+
+class ScopedTexture2DArrayBinding
+{
+    struct OldHandle
+    {
+        OldHandle();
+        detail::ObjectHandle mOldTexture;
+    } mOldHandle;
+
+    Texture2DArrayBinding mBinding;
+
+public:
+    ScopedTexture2DArrayBinding(Texture2DArray& texture2DArray);
+    ~ScopedTexture2DArrayBinding();
+
+          Texture2DArrayBinding& GetBinding()       { return mBinding; }
+    const Texture2DArrayBinding& GetBinding() const { return mBinding; }
+};
+
 class RenderBuffer
 {
     detail::ObjectHandle mHandle;
@@ -502,6 +813,8 @@ constexpr size_t SizeFromGLType(GLenum type)
 
 void DrawArrays(GLenum mode, GLint first, GLsizei count);
 
+void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount);
+
 void DrawElements(GLenum mode, GLenum indexType, GLint first, GLsizei count);
 
 } // end namespace GLplus
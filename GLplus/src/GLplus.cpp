@@ -1,17 +1,256 @@
 #include "GLplus.hpp"
 
+#include <algorithm>
 #include <stdexcept>
+#include <string>
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
+#include <cstring>
 
 #include "SOIL2.h"
+#include "Profiler.hpp"
 
 namespace GLplus
 {
 
 using namespace detail;
 
+#if defined(_MSC_VER)
+#define GLPLUS_FUNCTION_SIGNATURE __FUNCSIG__
+#else
+#define GLPLUS_FUNCTION_SIGNATURE __PRETTY_FUNCTION__
+#endif
+
+// "void GLplus::BufferBinding::Upload(GLsizeiptr, const void*, GLenum)" -> "BufferBinding::Upload"
+static std::string FunctionNameFromSignature(const char* signature)
+{
+    std::string name(signature, strcspn(signature, "("));
+    name = name.substr(name.find_last_of(' ') + 1);
+
+    static const std::string kNamespace = "GLplus::";
+    if (name.compare(0, kNamespace.size(), kNamespace) == 0)
+    {
+        name = name.substr(kNamespace.size());
+    }
+    return name;
+}
+
+// The GL call GLplus made last, so errors can say where they came from.
+struct GLCallLocation
+{
+    const char* EntryPoint;
+    const char* Signature;
+    int Line;
+};
+
+static GLCallLocation gLastGLCall = { nullptr, nullptr, 0 };
+
+static std::string DescribeGLCall(const GLCallLocation& call)
+{
+    if (!call.EntryPoint)
+    {
+        return "no GL call made by GLplus yet";
+    }
+
+    return std::string(call.EntryPoint) + " in " + FunctionNameFromSignature(call.Signature)
+         + " (GLplus.cpp:" + std::to_string(call.Line) + ")";
+}
+
+// set by FrameStats::SetCollecting. While it's off, a GL call costs only a test of it.
+static bool gCollectingFrameStats = false;
+
+enum class GLCallKind
+{
+    Other,
+    Draw,
+    Bind,
+    Query,
+    ErrorCheck,
+    Uniform
+};
+
+static GLCallKind GLCallKindFromEntryPoint(const char* entryPoint)
+{
+    auto startsWith = [entryPoint](const char* prefix) {
+        return strncmp(entryPoint, prefix, strlen(prefix)) == 0;
+    };
+
+    if (strcmp(entryPoint, "glGetError") == 0)                                        return GLCallKind::ErrorCheck;
+    if (startsWith("glDraw"))                                                         return GLCallKind::Draw;
+    if (startsWith("glBind") || startsWith("glUseProgram") || startsWith("glActiveTexture")) return GLCallKind::Bind;
+    if (startsWith("glGet") || startsWith("glCheck"))                                 return GLCallKind::Query;
+    if (startsWith("glUniform"))                                                      return GLCallKind::Uniform;
+    return GLCallKind::Other;
+}
+
+struct GLCallSite
+{
+    GLCallLocation Location;
+    const char* EntryPoint;
+    std::string Function;
+    int Line;
+    GLCallKind Kind;
+    size_t Calls = 0;
+
+    GLCallSite(const char* entryPoint, const char* signature, int line);
+};
+
+// every site called so far. sites register on their first call.
+static std::vector<GLCallSite*>& GetGLCallSites()
+{
+    static std::vector<GLCallSite*> sites;
+    return sites;
+}
+
+GLCallSite::GLCallSite(const char* entryPoint, const char* signature, int line)
+    : Location{ entryPoint, signature, line }
+    , EntryPoint(entryPoint)
+    , Function(FunctionNameFromSignature(signature))
+    , Line(line)
+    , Kind(GLCallKindFromEntryPoint(entryPoint))
+{
+    GetGLCallSites().push_back(this);
+}
+
+// one site per line of this file
+template<int Line>
+static GLCallSite& GetGLCallSite(const char* entryPoint, const char* signature)
+{
+    static GLCallSite site(entryPoint, signature, Line);
+    return site;
+}
+
+// counts of the frame in progress. call sites are kept in the sites themselves.
+static FrameStats& GetFrameTotals()
+{
+    static FrameStats totals;
+    return totals;
+}
+
+static void CountGLCall(GLCallSite& site)
+{
+    FrameStats& totals = GetFrameTotals();
+    gLastGLCall = site.Location;
+    site.Calls++;
+    totals.Calls++;
+
+    switch (site.Kind)
+    {
+    case GLCallKind::Draw:       totals.DrawCalls++;      break;
+    case GLCallKind::Bind:       totals.Binds++;          break;
+    case GLCallKind::Query:      totals.Queries++;        break;
+    case GLCallKind::ErrorCheck: totals.ErrorChecks++;    break;
+    case GLCallKind::Uniform:    totals.UniformUploads++; break;
+    case GLCallKind::Other:                               break;
+    }
+}
+
+static void CountBufferBytesUploaded(GLsizeiptr size)
+{
+    if (gCollectingFrameStats)
+    {
+        GetFrameTotals().BufferBytesUploaded += size;
+    }
+}
+
+static void CountTextureBytesLoaded(size_t size)
+{
+    if (gCollectingFrameStats)
+    {
+        GetFrameTotals().TextureBytesLoaded += size;
+    }
+}
+
+// Remembers where a call to a GL entry point is made from, and counts it against that line of
+// GLplus while frame stats are collected. Used as GLPLUS_CALL(glBindBuffer)(target, buffer).
+#define GLPLUS_CALL(entryPoint) \
+    ((gCollectingFrameStats ? CountGLCall(GetGLCallSite<__LINE__>(#entryPoint, GLPLUS_FUNCTION_SIGNATURE)) \
+                            : (void) (gLastGLCall = GLCallLocation{ #entryPoint, GLPLUS_FUNCTION_SIGNATURE, __LINE__ })), \
+     entryPoint)
+
+void FrameStats::SetCollecting(bool collecting)
+{
+    if (collecting && !gCollectingFrameStats)
+    {
+        EndFrame();
+    }
+    gCollectingFrameStats = collecting;
+}
+
+bool FrameStats::IsCollecting()
+{
+    return gCollectingFrameStats;
+}
+
+FrameStats FrameStats::GetCurrent()
+{
+    if (!gCollectingFrameStats)
+    {
+        return FrameStats();
+    }
+
+    FrameStats stats = GetFrameTotals();
+    stats.IsCollected = true;
+
+    for (const GLCallSite* pSite : GetGLCallSites())
+    {
+        if (pSite->Calls > 0)
+        {
+            stats.CallSites.push_back(CallSite{ pSite->EntryPoint, pSite->Function, pSite->Line, pSite->Calls });
+        }
+    }
+
+    std::stable_sort(stats.CallSites.begin(), stats.CallSites.end(),
+            [](const CallSite& a, const CallSite& b) { return a.Calls > b.Calls; });
+
+    return stats;
+}
+
+FrameStats FrameStats::EndFrame()
+{
+    FrameStats stats = GetCurrent();
+
+    GetFrameTotals() = FrameStats();
+    for (GLCallSite* pSite : GetGLCallSites())
+    {
+        pSite->Calls = 0;
+    }
+
+    return stats;
+}
+
+void FrameStats::Dump(std::ostream& out, size_t maxCallSites) const
+{
+    if (!IsCollected)
+    {
+        out << "GL frame stats weren't collected. Turn them on with GLplus::FrameStats::SetCollecting.\n";
+        return;
+    }
+
+    out << "GL calls: " << Calls
+        << " (draws: " << DrawCalls
+        << ", binds: " << Binds
+        << ", queries: " << Queries
+        << ", error checks: " << ErrorChecks
+        << ", uniforms: " << UniformUploads
+        << "), buffer bytes uploaded: " << BufferBytesUploaded
+        << ", texture bytes loaded: " << TextureBytesLoaded << "\n";
+
+    for (size_t i = 0; i < CallSites.size() && i < maxCallSites; i++)
+    {
+        const CallSite& site = CallSites[i];
+        out << std::setw(10) << site.Calls << "  " << site.EntryPoint
+            << " in " << site.Function << " (GLplus.cpp:" << site.Line << ")\n";
+    }
+
+    if (CallSites.size() > maxCallSites)
+    {
+        out << "  and " << CallSites.size() - maxCallSites << " more call sites\n";
+    }
+}
+
 static const char* StringFromGLError(GLenum err)
 {
     switch (err)
@@ -45,51 +284,395 @@ static const char* FrameBufferStatusToString(GLenum status)
     }
 }
 
+#ifndef GLPLUS_DEFAULT_ERROR_CHECK_MODE
+#ifdef NDEBUG
+#define GLPLUS_DEFAULT_ERROR_CHECK_MODE Off
+#else
+#define GLPLUS_DEFAULT_ERROR_CHECK_MODE EveryCall
+#endif
+#endif
+
+static ErrorCheckMode gErrorCheckMode = ErrorCheckMode::GLPLUS_DEFAULT_ERROR_CHECK_MODE;
+
+// the first error the debug callback reported since the last check, empty if none.
+static std::string gPendingDebugError;
+
+// returns the first error in GL's queue, and empties the queue.
+static GLenum DrainGLErrors()
+{
+    GLenum firstError = GLPLUS_CALL(glGetError)();
+
+    if (firstError != GL_NO_ERROR)
+    {
+        while (GLPLUS_CALL(glGetError)() != GL_NO_ERROR);
+    }
+
+    return firstError;
+}
+
+static void ThrowPendingDebugError()
+{
+    if (!gPendingDebugError.empty())
+    {
+        std::string error;
+        std::swap(error, gPendingDebugError);
+        throw std::runtime_error(error);
+    }
+}
+
+// Synchronous debug output calls this from inside the GL call that failed,
+// and GLPLUS_CALL records that call before making it, so the last call is the culprit.
+static void GLAPIENTRY OnGLDebugMessage(
+        GLenum source, GLenum type, GLuint id, GLenum severity,
+        GLsizei length, const GLchar* message, const void* userParam)
+{
+    // exceptions can't unwind through the driver, so the error is thrown by the next check.
+    if (type == GL_DEBUG_TYPE_ERROR && gPendingDebugError.empty())
+    {
+        gPendingDebugError = std::string(message, length > 0 ? length : strlen(message))
+                           + " (during " + DescribeGLCall(gLastGLCall) + ")";
+    }
+}
+
+void SetErrorCheckMode(ErrorCheckMode mode)
+{
+    bool useCallback = mode == ErrorCheckMode::DebugCallback;
+    if (useCallback && !GLEW_KHR_debug && !GLEW_VERSION_4_3)
+    {
+        throw std::runtime_error("GL error checks through a debug callback need KHR_debug");
+    }
+
+    if (useCallback || gErrorCheckMode == ErrorCheckMode::DebugCallback)
+    {
+        GLPLUS_CALL(glDebugMessageCallback)(useCallback ? OnGLDebugMessage : NULL, NULL);
+
+        if (useCallback)
+        {
+            GLPLUS_CALL(glEnable)(GL_DEBUG_OUTPUT);
+            GLPLUS_CALL(glEnable)(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        }
+        else
+        {
+            GLPLUS_CALL(glDisable)(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+            GLPLUS_CALL(glDisable)(GL_DEBUG_OUTPUT);
+        }
+    }
+
+    // errors from before the switch belong to neither mode
+    DrainGLErrors();
+    gPendingDebugError.clear();
+
+    gErrorCheckMode = mode;
+}
+
+ErrorCheckMode GetErrorCheckMode()
+{
+    return gErrorCheckMode;
+}
+
+ErrorCheckMode ErrorCheckModeFromString(const char* name)
+{
+    if (!strcmp(name, "every-call"))     return ErrorCheckMode::EveryCall;
+    if (!strcmp(name, "per-frame"))      return ErrorCheckMode::PerFrame;
+    if (!strcmp(name, "debug-callback")) return ErrorCheckMode::DebugCallback;
+    if (!strcmp(name, "off"))            return ErrorCheckMode::Off;
+    throw std::invalid_argument(std::string("Unknown GL error check mode: ") + name);
+}
+
 void CheckGLErrors()
 {
-    GLenum firstError = glGetError();
+    switch (gErrorCheckMode)
+    {
+    case ErrorCheckMode::EveryCall:
+    {
+        // glGetError takes over as the last call
+        GLCallLocation checkedCall = gLastGLCall;
+
+        GLenum firstError = DrainGLErrors();
+        if (firstError != GL_NO_ERROR)
+        {
+            throw std::runtime_error(std::string(StringFromGLError(firstError)) + " (after " + DescribeGLCall(checkedCall) + ")");
+        }
+        break;
+    }
+    case ErrorCheckMode::DebugCallback:
+        ThrowPendingDebugError();
+        break;
+    case ErrorCheckMode::PerFrame:
+    case ErrorCheckMode::Off:
+        break;
+    }
+}
+
+void CheckFrameErrors()
+{
+    switch (gErrorCheckMode)
+    {
+    case ErrorCheckMode::EveryCall:
+    case ErrorCheckMode::PerFrame:
+    {
+        GLenum firstError = DrainGLErrors();
+        if (firstError != GL_NO_ERROR)
+        {
+            throw std::runtime_error(std::string(StringFromGLError(firstError)) + " during the frame"
+                                     " (switch to every-call or debug-callback error checks to find the call)");
+        }
+        break;
+    }
+    case ErrorCheckMode::DebugCallback:
+        ThrowPendingDebugError();
+        break;
+    case ErrorCheckMode::Off:
+        break;
+    }
+}
+
+// binding caches start out, and are reset to, not knowing what GL has bound.
+static const GLint kUnknownBinding = -1;
+
+struct BindingCache
+{
+    GLint Program = kUnknownBinding;
+    GLint ArrayBuffer = kUnknownBinding;
+    GLint ElementArrayBuffer = kUnknownBinding; // of the bound vertex array
+    GLint UniformBuffer = kUnknownBinding;      // the general binding, not the indexed ones
+    GLint VertexArray = kUnknownBinding;
+    GLint ActiveTexture = kUnknownBinding;
+    GLint RenderBuffer = kUnknownBinding;
+    GLint DrawFrameBuffer = kUnknownBinding;
+    GLint ReadFrameBuffer = kUnknownBinding;
 
-    while (glGetError() != GL_NO_ERROR);
+    // per texture unit, grown as units get used
+    std::vector<GLint> Texture2Ds;
+    std::vector<GLint> Texture2DArrays;
+    std::vector<GLint> Samplers;
+};
 
-    if (firstError != GL_NO_ERROR)
+// one per thread, since a thread has at most one current context.
+static thread_local BindingCache tBindingCache;
+
+void ResetBindingCache()
+{
+    tBindingCache = BindingCache();
+}
+
+static GLint QueryBinding(GLenum binding)
+{
+    GLint handle;
+    GLPLUS_CALL(glGetIntegerv)(binding, &handle);
+    CheckGLErrors();
+    return handle;
+}
+
+static GLint GetCachedBinding(GLint& cached, GLenum binding)
+{
+    if (cached == kUnknownBinding)
+    {
+        cached = QueryBinding(binding);
+    }
+    return cached;
+}
+
+static GLint& GetUnitBinding(std::vector<GLint>& bindings, GLuint unit)
+{
+    if (unit >= bindings.size())
+    {
+        bindings.resize(unit + 1, kUnknownBinding);
+    }
+    return bindings[unit];
+}
+
+// deleting an object unbinds it from wherever it's bound in the current context
+static void ForgetDeleted(GLint& cached, GLuint handle)
+{
+    if (cached == (GLint) handle)
+    {
+        cached = 0;
+    }
+}
+
+static void ForgetDeleted(std::vector<GLint>& cached, GLuint handle)
+{
+    for (GLint& binding : cached)
+    {
+        ForgetDeleted(binding, handle);
+    }
+}
+
+static void UseProgram(GLuint program)
+{
+    if (tBindingCache.Program != (GLint) program)
+    {
+        GLPLUS_CALL(glUseProgram)(program);
+        CheckGLErrors();
+        tBindingCache.Program = program;
+    }
+}
+
+// null for targets that aren't cached
+static GLint* GetCachedBufferBinding(GLenum target)
+{
+    return target == GL_ARRAY_BUFFER         ? &tBindingCache.ArrayBuffer
+         : target == GL_ELEMENT_ARRAY_BUFFER ? &tBindingCache.ElementArrayBuffer
+         : target == GL_UNIFORM_BUFFER       ? &tBindingCache.UniformBuffer
+         : nullptr;
+}
+
+static void BindBuffer(GLenum target, GLuint buffer)
+{
+    GLint* pCached = GetCachedBufferBinding(target);
+    if (!pCached || *pCached != (GLint) buffer)
     {
-        throw std::runtime_error(StringFromGLError(firstError));
+        GLPLUS_CALL(glBindBuffer)(target, buffer);
+        CheckGLErrors();
+        if (pCached)
+        {
+            *pCached = buffer;
+        }
+    }
+}
+
+static void BindVertexArray(GLuint vertexArray)
+{
+    if (tBindingCache.VertexArray != (GLint) vertexArray)
+    {
+        GLPLUS_CALL(glBindVertexArray)(vertexArray);
+        CheckGLErrors();
+        tBindingCache.VertexArray = vertexArray;
+        // the index buffer binding belongs to the vertex array
+        tBindingCache.ElementArrayBuffer = kUnknownBinding;
+    }
+}
+
+static void SetActiveTexture(GLenum textureIndex)
+{
+    if (tBindingCache.ActiveTexture != (GLint) textureIndex)
+    {
+        GLPLUS_CALL(glActiveTexture)(textureIndex);
+        CheckGLErrors();
+        tBindingCache.ActiveTexture = textureIndex;
+    }
+}
+
+static GLuint GetActiveTextureUnit()
+{
+    return GetCachedBinding(tBindingCache.ActiveTexture, GL_ACTIVE_TEXTURE) - GL_TEXTURE0;
+}
+
+static GLint& GetCachedTextureBinding(GLenum target)
+{
+    std::vector<GLint>& bindings = target == GL_TEXTURE_2D       ? tBindingCache.Texture2Ds
+                                 : target == GL_TEXTURE_2D_ARRAY ? tBindingCache.Texture2DArrays
+                                 : throw std::logic_error("Invalid Texture target type");
+    return GetUnitBinding(bindings, GetActiveTextureUnit());
+}
+
+static GLint GetTextureBinding(GLenum target)
+{
+    return GetCachedBinding(GetCachedTextureBinding(target),
+                            target == GL_TEXTURE_2D ? GL_TEXTURE_BINDING_2D : GL_TEXTURE_BINDING_2D_ARRAY);
+}
+
+static void BindTexture(GLenum target, GLuint texture)
+{
+    GLint& cached = GetCachedTextureBinding(target);
+    if (cached != (GLint) texture)
+    {
+        GLPLUS_CALL(glBindTexture)(target, texture);
+        CheckGLErrors();
+        cached = texture;
+    }
+}
+
+static void BindRenderBuffer(GLuint renderBuffer)
+{
+    if (tBindingCache.RenderBuffer != (GLint) renderBuffer)
+    {
+        GLPLUS_CALL(glBindRenderbuffer)(GL_RENDERBUFFER, renderBuffer);
+        CheckGLErrors();
+        tBindingCache.RenderBuffer = renderBuffer;
+    }
+}
+
+static void BindFrameBuffer(GLenum target, GLuint frameBuffer)
+{
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+
+    if ((draw && tBindingCache.DrawFrameBuffer != (GLint) frameBuffer)
+     || (read && tBindingCache.ReadFrameBuffer != (GLint) frameBuffer))
+    {
+        GLPLUS_CALL(glBindFramebuffer)(target, frameBuffer);
+        CheckGLErrors();
+        if (draw)
+        {
+            tBindingCache.DrawFrameBuffer = frameBuffer;
+        }
+        if (read)
+        {
+            tBindingCache.ReadFrameBuffer = frameBuffer;
+        }
+    }
+}
+
+static GLint GetSamplerBinding(GLuint textureUnit)
+{
+    GLint& cached = GetUnitBinding(tBindingCache.Samplers, textureUnit);
+    if (cached == kUnknownBinding)
+    {
+        // GL only answers for the active unit
+        GLenum oldActiveTexture = GL_TEXTURE0 + GetActiveTextureUnit();
+        SetActiveTexture(GL_TEXTURE0 + textureUnit);
+        cached = QueryBinding(GL_SAMPLER_BINDING);
+        SetActiveTexture(oldActiveTexture);
+    }
+    return cached;
+}
+
+static void BindSampler(GLuint textureUnit, GLuint sampler)
+{
+    GLint& cached = GetUnitBinding(tBindingCache.Samplers, textureUnit);
+    if (cached != (GLint) sampler)
+    {
+        GLPLUS_CALL(glBindSampler)(textureUnit, sampler);
+        CheckGLErrors();
+        cached = sampler;
     }
 }
 
 Shader::Shader(GLenum shaderType)
     : mShaderType(shaderType)
 {
-    mHandle.mHandle = glCreateShader(shaderType);
+    mHandle.mHandle = GLPLUS_CALL(glCreateShader)(shaderType);
     CheckGLErrors();
 }
 
 Shader::~Shader()
 {
-    glDeleteShader(mHandle.mHandle);
+    GLPLUS_CALL(glDeleteShader)(mHandle.mHandle);
     CheckGLErrors();
 }
 
 void Shader::Compile(const GLchar* source)
 {
-    glShaderSource(mHandle.mHandle, 1, &source, NULL);
+    GLPLUS_CALL(glShaderSource)(mHandle.mHandle, 1, &source, NULL);
     CheckGLErrors();
 
-    glCompileShader(mHandle.mHandle);
+    GLPLUS_CALL(glCompileShader)(mHandle.mHandle);
     CheckGLErrors();
 
     int status;
-    glGetShaderiv(mHandle.mHandle, GL_COMPILE_STATUS, &status);
+    GLPLUS_CALL(glGetShaderiv)(mHandle.mHandle, GL_COMPILE_STATUS, &status);
     CheckGLErrors();
 
     if (!status)
     {
         int logLength;
-        glGetShaderiv(mHandle.mHandle, GL_INFO_LOG_LENGTH, &logLength);
+        GLPLUS_CALL(glGetShaderiv)(mHandle.mHandle, GL_INFO_LOG_LENGTH, &logLength);
         CheckGLErrors();
 
         std::vector<char> log(logLength);
-        glGetShaderInfoLog(mHandle.mHandle, log.size(), NULL, log.data());
+        GLPLUS_CALL(glGetShaderInfoLog)(mHandle.mHandle, log.size(), NULL, log.data());
         CheckGLErrors();
 
         throw std::runtime_error(log.data());
@@ -98,19 +681,25 @@ void Shader::Compile(const GLchar* source)
 
 Program::Program()
 {
-    mHandle.mHandle = glCreateProgram();
+    mHandle.mHandle = GLPLUS_CALL(glCreateProgram)();
     CheckGLErrors();
 }
 
 Program::~Program()
 {
-    glDeleteProgram(mHandle.mHandle);
+    GLPLUS_CALL(glDeleteProgram)(mHandle.mHandle);
     CheckGLErrors();
+
+    // a deleted program stays in use until something else is, so leave it to be asked again.
+    if (tBindingCache.Program == (GLint) mHandle.mHandle)
+    {
+        tBindingCache.Program = kUnknownBinding;
+    }
 }
 
 void Program::Attach(const std::shared_ptr<Shader>& shader)
 {
-    glAttachShader(mHandle.mHandle, shader->GetGLHandle());
+    GLPLUS_CALL(glAttachShader)(mHandle.mHandle, shader->GetGLHandle());
     CheckGLErrors();
 
     switch (shader->GetShaderType())
@@ -128,25 +717,126 @@ void Program::Attach(const std::shared_ptr<Shader>& shader)
 
 void Program::Link()
 {
-    glLinkProgram(mHandle.mHandle);
+    GLPLUS_CALL(glLinkProgram)(mHandle.mHandle);
     CheckGLErrors();
 
     int status;
-    glGetProgramiv(mHandle.mHandle, GL_LINK_STATUS, &status);
+    GLPLUS_CALL(glGetProgramiv)(mHandle.mHandle, GL_LINK_STATUS, &status);
     CheckGLErrors();
 
     if (!status)
     {
         int logLength;
-        glGetProgramiv(mHandle.mHandle, GL_INFO_LOG_LENGTH, &logLength);
+        GLPLUS_CALL(glGetProgramiv)(mHandle.mHandle, GL_INFO_LOG_LENGTH, &logLength);
         CheckGLErrors();
 
         std::vector<char> log(logLength);
-        glGetProgramInfoLog(mHandle.mHandle, log.size(), NULL, log.data());
+        GLPLUS_CALL(glGetProgramInfoLog)(mHandle.mHandle, log.size(), NULL, log.data());
         CheckGLErrors();
 
         throw std::runtime_error(log.data());
     }
+
+    static uint64_t sLinkCount = 0;
+    mLinkSerial = ++sLinkCount;
+
+    ReflectVariables();
+}
+
+// "spriteRects[0]" -> "spriteRects"
+static std::string ArrayBaseName(std::string name)
+{
+    static const std::string kFirstElement = "[0]";
+    if (name.size() > kFirstElement.size()
+     && name.compare(name.size() - kFirstElement.size(), kFirstElement.size(), kFirstElement) == 0)
+    {
+        name.resize(name.size() - kFirstElement.size());
+    }
+    return name;
+}
+
+void Program::ReflectVariables()
+{
+    mUniforms.clear();
+    mAttributes.clear();
+    mUniformBlocks.clear();
+    mUniformValues.clear();
+    mNextElementLocations.clear();
+
+    GLint numUniforms, maxUniformNameLength;
+    GLPLUS_CALL(glGetProgramiv)(mHandle.mHandle, GL_ACTIVE_UNIFORMS, &numUniforms);
+    GLPLUS_CALL(glGetProgramiv)(mHandle.mHandle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxUniformNameLength);
+    CheckGLErrors();
+
+    std::vector<GLchar> name(std::max(maxUniformNameLength, 1));
+    for (GLint i = 0; i < numUniforms; i++)
+    {
+        ProgramVariable uniform;
+        GLPLUS_CALL(glGetActiveUniform)(mHandle.mHandle, i, name.size(), NULL, &uniform.Size, &uniform.Type, name.data());
+        uniform.Location = GLPLUS_CALL(glGetUniformLocation)(mHandle.mHandle, name.data());
+        CheckGLErrors();
+
+        // members of uniform blocks have no location
+        if (uniform.Location != -1)
+        {
+            uniform.Name = ArrayBaseName(name.data());
+            mUniforms.emplace(uniform.Name, uniform);
+
+            GLint elementLocation = uniform.Location;
+            for (GLint element = 1; element < uniform.Size; element++)
+            {
+                std::string elementName = uniform.Name + "[" + std::to_string(element) + "]";
+                GLint nextLocation = GLPLUS_CALL(glGetUniformLocation)(mHandle.mHandle, elementName.c_str());
+                CheckGLErrors();
+
+                mNextElementLocations[elementLocation] = nextLocation;
+                elementLocation = nextLocation;
+            }
+        }
+    }
+
+    GLint numAttributes, maxAttributeNameLength;
+    GLPLUS_CALL(glGetProgramiv)(mHandle.mHandle, GL_ACTIVE_ATTRIBUTES, &numAttributes);
+    GLPLUS_CALL(glGetProgramiv)(mHandle.mHandle, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxAttributeNameLength);
+    CheckGLErrors();
+
+    name.resize(std::max(maxAttributeNameLength, 1));
+    for (GLint i = 0; i < numAttributes; i++)
+    {
+        ProgramVariable attribute;
+        GLPLUS_CALL(glGetActiveAttrib)(mHandle.mHandle, i, name.size(), NULL, &attribute.Size, &attribute.Type, name.data());
+        attribute.Location = GLPLUS_CALL(glGetAttribLocation)(mHandle.mHandle, name.data());
+        CheckGLErrors();
+
+        // built-ins like gl_VertexID have no location
+        if (attribute.Location != -1)
+        {
+            attribute.Name = ArrayBaseName(name.data());
+            mAttributes.emplace(attribute.Name, attribute);
+        }
+    }
+
+    GLint numBlocks, maxBlockNameLength;
+    GLPLUS_CALL(glGetProgramiv)(mHandle.mHandle, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
+    GLPLUS_CALL(glGetProgramiv)(mHandle.mHandle, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLength);
+    CheckGLErrors();
+
+    name.resize(std::max(maxBlockNameLength, 1));
+    for (GLint i = 0; i < numBlocks; i++)
+    {
+        ProgramUniformBlock block;
+        block.Index = i;
+        GLPLUS_CALL(glGetActiveUniformBlockName)(mHandle.mHandle, i, name.size(), NULL, name.data());
+        GLPLUS_CALL(glGetActiveUniformBlockiv)(mHandle.mHandle, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.DataSize);
+        CheckGLErrors();
+
+        block.Name = name.data();
+        block.BindingPoint = GetUniformBlockBindingPoint(block.Name);
+        GLPLUS_CALL(glUniformBlockBinding)(mHandle.mHandle, block.Index, block.BindingPoint);
+        CheckGLErrors();
+
+        mUniformBlocks.emplace(block.Name, block);
+    }
 }
 
 Program Program::FromFiles(const char* vShaderFile, const char* fShaderFile)
@@ -176,16 +866,41 @@ Program Program::FromFiles(const char* vShaderFile, const char* fShaderFile)
     return program;
 }
 
+static const ProgramVariable* FindVariable(const std::unordered_map<std::string, ProgramVariable>& variables, const GLchar* name)
+{
+    auto found = variables.find(name);
+    if (found == variables.end())
+    {
+        found = variables.find(ArrayBaseName(name));
+    }
+    return found != variables.end() ? &found->second : nullptr;
+}
+
+const ProgramVariable* Program::FindUniform(const GLchar* name) const
+{
+    return FindVariable(mUniforms, name);
+}
+
+const ProgramVariable* Program::FindAttribute(const GLchar* name) const
+{
+    return FindVariable(mAttributes, name);
+}
+
+const ProgramUniformBlock* Program::FindUniformBlock(const GLchar* name) const
+{
+    auto found = mUniformBlocks.find(name);
+    return found != mUniformBlocks.end() ? &found->second : nullptr;
+}
+
 bool Program::TryGetAttributeLocation(const GLchar* name, GLint& loc) const
 {
-    GLint location = glGetAttribLocation(mHandle.mHandle, name);
-    CheckGLErrors();
-    if (location == -1)
+    const ProgramVariable* pAttribute = FindAttribute(name);
+    if (!pAttribute)
     {
         return false;
     }
 
-    loc = location;
+    loc = pAttribute->Location;
     return true;
 }
 
@@ -201,7 +916,21 @@ GLint Program::GetAttributeLocation(const GLchar* name) const
 
 bool Program::TryGetUniformLocation(const GLchar* name, GLint& loc) const
 {
-    GLint location = glGetUniformLocation(mHandle.mHandle, name);
+    const ProgramVariable* pUniform = FindUniform(name);
+    if (pUniform)
+    {
+        loc = pUniform->Location;
+        return true;
+    }
+
+    // elements past the first of an array, like "lights[2]", aren't in the table
+    if (!strchr(name, '['))
+    {
+        return false;
+    }
+
+    GLint location = GLPLUS_CALL(glGetUniformLocation)(mHandle.mHandle, name);
+    CheckGLErrors();
     if (location == -1)
     {
         return false;
@@ -210,6 +939,7 @@ bool Program::TryGetUniformLocation(const GLchar* name, GLint& loc) const
     loc = location;
     return true;
 }
+
 GLint Program::GetUniformLocation(const GLchar* name) const
 {
     GLint loc;
@@ -220,11 +950,57 @@ GLint Program::GetUniformLocation(const GLchar* name) const
     return loc;
 }
 
+bool Program::ReplaceUniformValue(GLint location, const void* value, size_t elementSize, GLsizei count)
+{
+    // GL ignores uploads to location -1, so there's nothing to upload.
+    if (location == -1)
+    {
+        return false;
+    }
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(value);
+    bool replaced = false;
+    for (GLsizei element = 0; element < count; element++, bytes += elementSize)
+    {
+        std::vector<unsigned char>& current = mUniformValues[location];
+        if (current.size() != elementSize || !std::equal(bytes, bytes + elementSize, current.begin()))
+        {
+            current.assign(bytes, bytes + elementSize);
+            replaced = true;
+        }
+
+        // GL ignores elements past the end of the array
+        if (element + 1 < count)
+        {
+            auto next = mNextElementLocations.find(location);
+            if (next == mNextElementLocations.end())
+            {
+                break;
+            }
+            location = next->second;
+        }
+    }
+
+    return replaced;
+}
+
+GLint UniformHandle::GetLocation(const Program& program)
+{
+    if (mLinkSerial != program.GetLinkSerial())
+    {
+        mLinkSerial = program.GetLinkSerial();
+        if (!program.TryGetUniformLocation(mName, mLocation))
+        {
+            mLocation = -1;
+        }
+    }
+    return mLocation;
+}
+
 ProgramBinding::ProgramBinding(Program& program)
     : mProgram(program)
 {
-    glUseProgram(mProgram.GetGLHandle());
-    CheckGLErrors();
+    UseProgram(mProgram.GetGLHandle());
 }
 
 void ProgramBinding::UploadInt(const GLchar* name, GLuint value) const
@@ -234,8 +1010,11 @@ void ProgramBinding::UploadInt(const GLchar* name, GLuint value) const
 
 void ProgramBinding::UploadInt(GLint location, GLuint value) const
 {
-    glUniform1i(location, value);
-    CheckGLErrors();
+    if (mProgram.ReplaceUniformValue(location, &value, sizeof(value)))
+    {
+        GLPLUS_CALL(glUniform1i)(location, value);
+        CheckGLErrors();
+    }
 }
 
 void ProgramBinding::UploadFloat(const GLchar* name, GLfloat value) const
@@ -245,8 +1024,11 @@ void ProgramBinding::UploadFloat(const GLchar* name, GLfloat value) const
 
 void ProgramBinding::UploadFloat(GLint location, GLfloat value) const
 {
-    glUniform1f(location, value);
-    CheckGLErrors();
+    if (mProgram.ReplaceUniformValue(location, &value, sizeof(value)))
+    {
+        GLPLUS_CALL(glUniform1f)(location, value);
+        CheckGLErrors();
+    }
 }
 
 void ProgramBinding::UploadVec2(const GLchar* name, GLfloat v0, GLfloat v1) const
@@ -256,8 +1038,8 @@ void ProgramBinding::UploadVec2(const GLchar* name, GLfloat v0, GLfloat v1) cons
 
 void ProgramBinding::UploadVec2(GLint location, GLfloat v0, GLfloat v1) const
 {
-    glUniform2f(location, v0, v1);
-    CheckGLErrors();
+    const GLfloat values[] = { v0, v1 };
+    UploadVec2(location, values);
 }
 
 void ProgramBinding::UploadVec2(const GLchar* name, const GLfloat* values) const
@@ -267,8 +1049,36 @@ void ProgramBinding::UploadVec2(const GLchar* name, const GLfloat* values) const
 
 void ProgramBinding::UploadVec2(GLint location, const GLfloat* values) const
 {
-    glUniform2fv(location, 1, values);
-    CheckGLErrors();
+    if (mProgram.ReplaceUniformValue(location, values, 2 * sizeof(GLfloat)))
+    {
+        GLPLUS_CALL(glUniform2fv)(location, 1, values);
+        CheckGLErrors();
+    }
+}
+
+void ProgramBinding::UploadVec3(const GLchar* name, GLfloat v0, GLfloat v1, GLfloat v2) const
+{
+    UploadVec3(mProgram.GetUniformLocation(name), v0, v1, v2);
+}
+
+void ProgramBinding::UploadVec3(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) const
+{
+    const GLfloat values[] = { v0, v1, v2 };
+    UploadVec3(location, values);
+}
+
+void ProgramBinding::UploadVec3(const GLchar* name, const GLfloat* values) const
+{
+    UploadVec3(mProgram.GetUniformLocation(name), values);
+}
+
+void ProgramBinding::UploadVec3(GLint location, const GLfloat* values) const
+{
+    if (mProgram.ReplaceUniformValue(location, values, 3 * sizeof(GLfloat)))
+    {
+        GLPLUS_CALL(glUniform3fv)(location, 1, values);
+        CheckGLErrors();
+    }
 }
 
 void ProgramBinding::UploadVec4(const GLchar* name, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) const
@@ -278,8 +1088,8 @@ void ProgramBinding::UploadVec4(const GLchar* name, GLfloat v0, GLfloat v1, GLfl
 
 void ProgramBinding::UploadVec4(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) const
 {
-    glUniform4f(location, v0, v1, v2, v3);
-    CheckGLErrors();
+    const GLfloat values[] = { v0, v1, v2, v3 };
+    UploadVec4(location, values);
 }
 
 void ProgramBinding::UploadVec4(const GLchar* name, const GLfloat* values) const
@@ -289,8 +1099,21 @@ void ProgramBinding::UploadVec4(const GLchar* name, const GLfloat* values) const
 
 void ProgramBinding::UploadVec4(GLint location, const GLfloat* values) const
 {
-    glUniform4fv(location, 1, values);
-    CheckGLErrors();
+    UploadVec4Array(location, 1, values);
+}
+
+void ProgramBinding::UploadVec4Array(const GLchar* name, GLsizei count, const GLfloat* values) const
+{
+    UploadVec4Array(mProgram.GetUniformLocation(name), count, values);
+}
+
+void ProgramBinding::UploadVec4Array(GLint location, GLsizei count, const GLfloat* values) const
+{
+    if (mProgram.ReplaceUniformValue(location, values, 4 * sizeof(GLfloat), count))
+    {
+        GLPLUS_CALL(glUniform4fv)(location, count, values);
+        CheckGLErrors();
+    }
 }
 
 void ProgramBinding::UploadMatrix4(const GLchar* name, GLboolean transpose, const GLfloat* values) const
@@ -300,17 +1123,26 @@ void ProgramBinding::UploadMatrix4(const GLchar* name, GLboolean transpose, cons
 
 void ProgramBinding::UploadMatrix4(GLint location, GLboolean transpose, const GLfloat* values) const
 {
-    glUniformMatrix4fv(location, 1, transpose, values);
-    CheckGLErrors();
+    // the same values transposed are a different matrix, so that's remembered as uploaded too
+    GLfloat matrix[16];
+    for (int row = 0; row < 4; row++)
+    {
+        for (int column = 0; column < 4; column++)
+        {
+            matrix[column * 4 + row] = transpose ? values[row * 4 + column] : values[column * 4 + row];
+        }
+    }
+
+    if (mProgram.ReplaceUniformValue(location, matrix, sizeof(matrix)))
+    {
+        GLPLUS_CALL(glUniformMatrix4fv)(location, 1, transpose, values);
+        CheckGLErrors();
+    }
 }
 
 ScopedProgramBinding::OldHandle::OldHandle()
 {
-    GLint currentProgram;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
-    CheckGLErrors();
-
-    mOldProgram.mHandle = currentProgram;
+    mOldProgram.mHandle = GetCachedBinding(tBindingCache.Program, GL_CURRENT_PROGRAM);
 }
 
 ScopedProgramBinding::ScopedProgramBinding(Program& program)
@@ -320,53 +1152,59 @@ ScopedProgramBinding::ScopedProgramBinding(Program& program)
 
 ScopedProgramBinding::~ScopedProgramBinding()
 {
-    glUseProgram(mOldHandle.mOldProgram.mHandle);
-    CheckGLErrors();
+    UseProgram(mOldHandle.mOldProgram.mHandle);
 }
 
 Buffer::Buffer()
 {
-    glGenBuffers(1, &mHandle.mHandle);
+    GLPLUS_CALL(glGenBuffers)(1, &mHandle.mHandle);
     CheckGLErrors();
 }
 
 Buffer::~Buffer()
 {
-    glDeleteBuffers(1, &mHandle.mHandle);
+    GLPLUS_CALL(glDeleteBuffers)(1, &mHandle.mHandle);
     CheckGLErrors();
+
+    ForgetDeleted(tBindingCache.ArrayBuffer, mHandle.mHandle);
+    ForgetDeleted(tBindingCache.ElementArrayBuffer, mHandle.mHandle);
+    ForgetDeleted(tBindingCache.UniformBuffer, mHandle.mHandle);
 }
 
 BufferBinding::BufferBinding(Buffer& buffer, GLenum target)
     : mBuffer(buffer)
     , mTarget(target)
 {
-    glBindBuffer(mTarget, mBuffer.GetGLHandle());
-    CheckGLErrors();
+    BindBuffer(mTarget, mBuffer.GetGLHandle());
 }
 
 void BufferBinding::Upload(GLsizeiptr size, const GLvoid* data, GLenum usage)
 {
-    glBufferData(mTarget, size, data, usage);
+    GLPLUS_CALL(glBufferData)(mTarget, size, data, usage);
     CheckGLErrors();
+
+    if (data)
+    {
+        CountBufferBytesUploaded(size);
+    }
 }
 
 void BufferBinding::Patch(GLintptr offset, GLsizeiptr size, const GLvoid* data)
 {
-    glBufferSubData(mTarget, offset, size, data);
+    GLPLUS_CALL(glBufferSubData)(mTarget, offset, size, data);
     CheckGLErrors();
+
+    CountBufferBytesUploaded(size);
 }
 
 ScopedBufferBinding::OldHandle::OldHandle(GLuint target)
 {
     GLenum binding = target == GL_ARRAY_BUFFER ? GL_ARRAY_BUFFER_BINDING
                    : target == GL_ELEMENT_ARRAY_BUFFER ? GL_ELEMENT_ARRAY_BUFFER_BINDING
+                   : target == GL_UNIFORM_BUFFER ? GL_UNIFORM_BUFFER_BINDING
                    : throw std::logic_error("Invalid Buffer target type");
 
-    GLint oldBuffer;
-    glGetIntegerv(binding, &oldBuffer);
-    CheckGLErrors();
-
-    mOldBuffer.mHandle = oldBuffer;
+    mOldBuffer.mHandle = GetCachedBinding(*GetCachedBufferBinding(target), binding);
 }
 
 ScopedBufferBinding::ScopedBufferBinding(Buffer& buffer, GLenum target)
@@ -376,20 +1214,73 @@ ScopedBufferBinding::ScopedBufferBinding(Buffer& buffer, GLenum target)
 
 ScopedBufferBinding::~ScopedBufferBinding()
 {
-    glBindBuffer(GetBinding().GetTarget(), mOldHandle.mOldBuffer.mHandle);
+    BindBuffer(GetBinding().GetTarget(), mOldHandle.mOldBuffer.mHandle);
+}
+
+GLuint GetUniformBlockBindingPoint(const std::string& blockName)
+{
+    static std::unordered_map<std::string, GLuint> bindingPoints;
+    return bindingPoints.emplace(blockName, (GLuint) bindingPoints.size()).first->second;
+}
+
+UniformBuffer::UniformBuffer(const std::string& blockName, GLsizeiptr size)
+    : mBlockName(blockName)
+    , mBindingPoint(GetUniformBlockBindingPoint(blockName))
+    , mData(size)
+{
+    {
+        // zeroed, like mData, so the first update can be skipped if it's all zeros
+        ScopedBufferBinding bufferBinding(mBuffer, GL_UNIFORM_BUFFER);
+        bufferBinding.GetBinding().Upload(size, mData.data(), GL_STREAM_DRAW);
+    }
+
+    Bind();
+}
+
+void UniformBuffer::Bind()
+{
+    GLPLUS_CALL(glBindBufferBase)(GL_UNIFORM_BUFFER, mBindingPoint, mBuffer.GetGLHandle());
     CheckGLErrors();
+
+    // binding a range also binds the general target
+    tBindingCache.UniformBuffer = mBuffer.GetGLHandle();
+}
+
+void UniformBuffer::Update(const void* data, GLsizeiptr size)
+{
+    if (size != GetSize())
+    {
+        throw std::invalid_argument("Uniform buffer update of the wrong size");
+    }
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    if (std::equal(bytes, bytes + size, mData.begin()))
+    {
+        return;
+    }
+    mData.assign(bytes, bytes + size);
+
+    ScopedBufferBinding bufferBinding(mBuffer, GL_UNIFORM_BUFFER);
+    bufferBinding.GetBinding().Upload(size, NULL, GL_STREAM_DRAW);
+    bufferBinding.GetBinding().Patch(0, size, data);
 }
 
 VertexArray::VertexArray()
 {
-    glGenVertexArrays(1, &mHandle.mHandle);
+    GLPLUS_CALL(glGenVertexArrays)(1, &mHandle.mHandle);
     CheckGLErrors();
 }
 
 VertexArray::~VertexArray()
 {
-    glDeleteVertexArrays(1, &mHandle.mHandle);
+    GLPLUS_CALL(glDeleteVertexArrays)(1, &mHandle.mHandle);
     CheckGLErrors();
+
+    if (tBindingCache.VertexArray == (GLint) mHandle.mHandle)
+    {
+        tBindingCache.VertexArray = 0;
+        tBindingCache.ElementArrayBuffer = kUnknownBinding;
+    }
 }
 
 GLenum VertexArray::GetIndexType() const
@@ -404,8 +1295,7 @@ GLenum VertexArray::GetIndexType() const
 VertexArrayBinding::VertexArrayBinding(VertexArray& vertexArray)
     : mVertexArray(vertexArray)
 {
-    glBindVertexArray(mVertexArray.GetGLHandle());
-    CheckGLErrors();
+    BindVertexArray(mVertexArray.GetGLHandle());
 }
 
 void VertexArrayBinding::SetAttribute(
@@ -417,22 +1307,32 @@ void VertexArrayBinding::SetAttribute(
         GLsizei stride,
         GLsizei offset)
 {
-    glEnableVertexAttribArray(index);
+    if (index >= VertexArray::kMaxAttributes)
+    {
+        throw std::out_of_range("Vertex attribute index " + std::to_string(index) + " is past VertexArray::kMaxAttributes");
+    }
+
+    GLPLUS_CALL(glEnableVertexAttribArray)(index);
     CheckGLErrors();
 
     ScopedBufferBinding bufferBinding(*buffer, GL_ARRAY_BUFFER);
 
-    glVertexAttribPointer(index, size, type, normalized, stride, (char*)NULL + offset);
+    GLPLUS_CALL(glVertexAttribPointer)(index, size, type, normalized, stride, (char*)NULL + offset);
     CheckGLErrors();
 
     mVertexArray.mVertexBuffers[index] = buffer;
 }
 
+void VertexArrayBinding::SetAttributeDivisor(GLuint index, GLuint divisor)
+{
+    GLPLUS_CALL(glVertexAttribDivisor)(index, divisor);
+    CheckGLErrors();
+}
+
 void VertexArrayBinding::SetIndexBuffer(const std::shared_ptr<Buffer>& buffer, GLenum type)
 {
     // spookiest, most unobviously documented thing about the GL spec I found so far.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->GetGLHandle());
-    CheckGLErrors();
+    BindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->GetGLHandle());
 
     mVertexArray.mIndexBuffer = buffer;
     mVertexArray.mIndexType = type;
@@ -441,11 +1341,7 @@ void VertexArrayBinding::SetIndexBuffer(const std::shared_ptr<Buffer>& buffer, G
 
 ScopedVertexArrayBinding::OldHandle::OldHandle()
 {
-    GLint oldArray;
-    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &oldArray);
-    CheckGLErrors();
-
-    mOldVertexArray.mHandle = oldArray;
+    mOldVertexArray.mHandle = GetCachedBinding(tBindingCache.VertexArray, GL_VERTEX_ARRAY_BINDING);
 }
 
 ScopedVertexArrayBinding::ScopedVertexArrayBinding(VertexArray& vertexArray)
@@ -455,36 +1351,124 @@ ScopedVertexArrayBinding::ScopedVertexArrayBinding(VertexArray& vertexArray)
 
 ScopedVertexArrayBinding::~ScopedVertexArrayBinding()
 {
-    glBindVertexArray(mOldHandle.mOldVertexArray.mHandle);
-    CheckGLErrors();
+    BindVertexArray(mOldHandle.mOldVertexArray.mHandle);
+}
+
+void VertexArrayCache::AddAttribute(const VertexAttributeSource& source)
+{
+    mSources.push_back(source);
+    mLayouts.clear();
+    mProgramLayouts.clear();
+}
+
+void VertexArrayCache::SetIndexBuffer(const std::shared_ptr<Buffer>& buffer, GLenum type)
+{
+    mpIndexBuffer = buffer;
+    mIndexType = type;
+    mLayouts.clear();
+    mProgramLayouts.clear();
+}
+
+void VertexArrayCache::Clear()
+{
+    mSources.clear();
+    mpIndexBuffer.reset();
+    mIndexType = 0;
+    mLayouts.clear();
+    mProgramLayouts.clear();
+}
+
+VertexArray& VertexArrayCache::Get(const Program& program)
+{
+    uint64_t serial = program.GetLinkSerial();
+    if (serial == 0)
+    {
+        throw std::logic_error("VertexArrayCache needs a linked program");
+    }
+
+    for (const std::pair<uint64_t, size_t>& programLayout : mProgramLayouts)
+    {
+        if (programLayout.first == serial)
+        {
+            return *mLayouts[programLayout.second].pVertexArray;
+        }
+    }
+
+    std::vector<GLint> locations(mSources.size(), -1);
+    for (size_t i = 0; i < mSources.size(); i++)
+    {
+        if (const ProgramVariable* attribute = program.FindAttribute(mSources[i].Name.c_str()))
+        {
+            locations[i] = attribute->Location;
+        }
+    }
+
+    size_t layoutIndex = 0;
+    while (layoutIndex < mLayouts.size() && mLayouts[layoutIndex].Locations != locations)
+    {
+        layoutIndex++;
+    }
+
+    if (layoutIndex == mLayouts.size())
+    {
+        Layout layout;
+        layout.Locations = locations;
+        layout.pVertexArray.reset(new VertexArray());
+
+        ScopedVertexArrayBinding scopedVAO(*layout.pVertexArray);
+        VertexArrayBinding& vaoBinding = scopedVAO.GetBinding();
+
+        if (mpIndexBuffer)
+        {
+            vaoBinding.SetIndexBuffer(mpIndexBuffer, mIndexType);
+        }
+
+        for (size_t i = 0; i < mSources.size(); i++)
+        {
+            if (locations[i] < 0)
+            {
+                continue;
+            }
+
+            const VertexAttributeSource& source = mSources[i];
+            vaoBinding.SetAttribute(locations[i], source.pBuffer, source.Size, source.Type,
+                                    source.Normalized, source.Stride, source.Offset);
+            if (source.Divisor != 0)
+            {
+                vaoBinding.SetAttributeDivisor(locations[i], source.Divisor);
+            }
+        }
+
+        mLayouts.push_back(std::move(layout));
+    }
+
+    mProgramLayouts.emplace_back(serial, layoutIndex);
+    return *mLayouts[layoutIndex].pVertexArray;
 }
 
 Texture2D::Texture2D()
 {
-    glGenTextures(1, &mHandle.mHandle);
+    GLPLUS_CALL(glGenTextures)(1, &mHandle.mHandle);
     CheckGLErrors();
 }
 
 Texture2D::~Texture2D()
 {
-    glDeleteTextures(1, &mHandle.mHandle);
+    GLPLUS_CALL(glDeleteTextures)(1, &mHandle.mHandle);
     CheckGLErrors();
+
+    ForgetDeleted(tBindingCache.Texture2Ds, mHandle.mHandle);
 }
 
 ActiveTextureBinding::ActiveTextureBinding(GLenum textureIndex)
     : mTextureIndex(textureIndex)
 {
-    glActiveTexture(textureIndex);
-    CheckGLErrors();
+    SetActiveTexture(textureIndex);
 }
 
 ScopedActiveTextureBinding::OldIndex::OldIndex()
 {
-    GLint oldIndex;
-    glGetIntegerv(GL_ACTIVE_TEXTURE, &oldIndex);
-    CheckGLErrors();
-
-    mOldIndex = oldIndex;
+    mOldIndex = GetCachedBinding(tBindingCache.ActiveTexture, GL_ACTIVE_TEXTURE);
 }
 
 ScopedActiveTextureBinding::ScopedActiveTextureBinding(GLenum textureIndex)
@@ -494,25 +1478,28 @@ ScopedActiveTextureBinding::ScopedActiveTextureBinding(GLenum textureIndex)
 
 ScopedActiveTextureBinding::~ScopedActiveTextureBinding()
 {
-    glActiveTexture(mOldIndex.mOldIndex);
-    CheckGLErrors();
+    SetActiveTexture(mOldIndex.mOldIndex);
 }
 
 Texture2DBinding::Texture2DBinding(Texture2D& texture2D)
     : mTexture2D(texture2D)
 {
-    glBindTexture(GL_TEXTURE_2D, mTexture2D.GetGLHandle());
-    CheckGLErrors();
+    BindTexture(GL_TEXTURE_2D, mTexture2D.GetGLHandle());
 }
 
 void Texture2DBinding::LoadImage(const char* filename, unsigned int flags)
 {
+    PROFILE_ZONE("Texture2DBinding::LoadImage");
+
     unsigned int soilFlags = 0;
     if (flags & Texture2D::InvertY)
     {
         soilFlags |= SOIL_FLAG_INVERT_Y;
     }
 
+    // SOIL binds the texture itself
+    GetCachedTextureBinding(GL_TEXTURE_2D) = kUnknownBinding;
+
     if (!SOIL_load_OGL_texture(filename,
                 NULL, NULL, NULL,
                 SOIL_LOAD_AUTO,
@@ -521,18 +1508,33 @@ void Texture2DBinding::LoadImage(const char* filename, unsigned int flags)
     {
         throw std::runtime_error(SOIL_last_result());
     }
+
+    // SOIL picked the format, so ask GL how big the texels turned out.
+    if (FrameStats::IsCollecting())
+    {
+        GLint bits = 0;
+        for (GLenum sizeParameter : { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE })
+        {
+            GLint componentBits;
+            GLPLUS_CALL(glGetTexLevelParameteriv)(GL_TEXTURE_2D, 0, sizeParameter, &componentBits);
+            bits += componentBits;
+        }
+        CheckGLErrors();
+
+        CountTextureBytesLoaded((size_t) GetWidth() * GetHeight() * bits / 8);
+    }
 }
 
 void Texture2DBinding::CreateStorage(GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height)
 {
-    glTexStorage2D(GL_TEXTURE_2D, levels, internalformat, width, height);
+    GLPLUS_CALL(glTexStorage2D)(GL_TEXTURE_2D, levels, internalformat, width, height);
     CheckGLErrors();
 }
 
 int Texture2DBinding::GetWidth() const
 {
     int width;
-    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0,  GL_TEXTURE_WIDTH, &width);
+    GLPLUS_CALL(glGetTexLevelParameteriv)(GL_TEXTURE_2D, 0,  GL_TEXTURE_WIDTH, &width);
     CheckGLErrors();
     return width;
 }
@@ -540,18 +1542,14 @@ int Texture2DBinding::GetWidth() const
 int Texture2DBinding::GetHeight() const
 {
     int height;
-    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0,  GL_TEXTURE_HEIGHT, &height);
+    GLPLUS_CALL(glGetTexLevelParameteriv)(GL_TEXTURE_2D, 0,  GL_TEXTURE_HEIGHT, &height);
     CheckGLErrors();
     return height;
 }
 
 ScopedTexture2DBinding::OldHandle::OldHandle()
 {
-    GLint oldTexture;
-    glGetIntegerv(GL_TEXTURE_BINDING_2D, &oldTexture);
-    CheckGLErrors();
-
-    mOldTexture.mHandle = oldTexture;
+    mOldTexture.mHandle = GetTextureBinding(GL_TEXTURE_2D);
 }
 
 ScopedTexture2DBinding::ScopedTexture2DBinding(Texture2D& texture2D)
@@ -561,42 +1559,144 @@ ScopedTexture2DBinding::ScopedTexture2DBinding(Texture2D& texture2D)
 
 ScopedTexture2DBinding::~ScopedTexture2DBinding()
 {
-    glBindTexture(GL_TEXTURE_2D, mOldHandle.mOldTexture.mHandle);
+    BindTexture(GL_TEXTURE_2D, mOldHandle.mOldTexture.mHandle);
+}
+
+Texture2DArray::Texture2DArray()
+{
+    GLPLUS_CALL(glGenTextures)(1, &mHandle.mHandle);
+    CheckGLErrors();
+}
+
+Texture2DArray::~Texture2DArray()
+{
+    GLPLUS_CALL(glDeleteTextures)(1, &mHandle.mHandle);
+    CheckGLErrors();
+
+    ForgetDeleted(tBindingCache.Texture2DArrays, mHandle.mHandle);
+}
+
+Texture2DArrayBinding::Texture2DArrayBinding(Texture2DArray& texture2DArray)
+    : mTexture2DArray(texture2DArray)
+{
+    BindTexture(GL_TEXTURE_2D_ARRAY, mTexture2DArray.GetGLHandle());
+}
+
+void Texture2DArrayBinding::CreateStorage(GLsizei width, GLsizei height, GLsizei layers)
+{
+    GLPLUS_CALL(glTexImage3D)(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    CheckGLErrors();
+
+    GLPLUS_CALL(glTexParameteri)(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    GLPLUS_CALL(glTexParameteri)(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    GLPLUS_CALL(glTexParameteri)(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    GLPLUS_CALL(glTexParameteri)(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    CheckGLErrors();
+}
+
+void Texture2DArrayBinding::LoadLayer(GLint layer, const char* filename, unsigned int flags)
+{
+    int width, height, channels;
+    unsigned char* pixels = SOIL_load_image(filename, &width, &height, &channels, SOIL_LOAD_RGBA);
+    if (!pixels)
+    {
+        throw std::runtime_error(SOIL_last_result());
+    }
+
+    if (width != GetWidth() || height != GetHeight())
+    {
+        SOIL_free_image_data(pixels);
+        throw std::runtime_error(std::string("Image size doesn't match texture array: ") + filename);
+    }
+
+    if (flags & Texture2D::InvertY)
+    {
+        std::vector<unsigned char> row(width * 4);
+        for (int y = 0; y < height / 2; y++)
+        {
+            unsigned char* top = pixels + y * width * 4;
+            unsigned char* bottom = pixels + (height - 1 - y) * width * 4;
+            std::copy(top, top + row.size(), row.begin());
+            std::copy(bottom, bottom + row.size(), top);
+            std::copy(row.begin(), row.end(), bottom);
+        }
+    }
+
+    GLPLUS_CALL(glTexSubImage3D)(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    SOIL_free_image_data(pixels);
+    CheckGLErrors();
+
+    CountTextureBytesLoaded((size_t) width * height * 4);
+}
+
+int Texture2DArrayBinding::GetWidth() const
+{
+    int width;
+    GLPLUS_CALL(glGetTexLevelParameteriv)(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_WIDTH, &width);
+    CheckGLErrors();
+    return width;
+}
+
+int Texture2DArrayBinding::GetHeight() const
+{
+    int height;
+    GLPLUS_CALL(glGetTexLevelParameteriv)(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_HEIGHT, &height);
+    CheckGLErrors();
+    return height;
+}
+
+int Texture2DArrayBinding::GetLayerCount() const
+{
+    int layers;
+    GLPLUS_CALL(glGetTexLevelParameteriv)(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_DEPTH, &layers);
     CheckGLErrors();
+    return layers;
+}
+
+ScopedTexture2DArrayBinding::OldHandle::OldHandle()
+{
+    mOldTexture.mHandle = GetTextureBinding(GL_TEXTURE_2D_ARRAY);
+}
+
+ScopedTexture2DArrayBinding::ScopedTexture2DArrayBinding(Texture2DArray& texture2DArray)
+    : mOldHandle()
+    , mBinding(texture2DArray)
+{ }
+
+ScopedTexture2DArrayBinding::~ScopedTexture2DArrayBinding()
+{
+    BindTexture(GL_TEXTURE_2D_ARRAY, mOldHandle.mOldTexture.mHandle);
 }
 
 RenderBuffer::RenderBuffer()
 {
-    glGenRenderbuffers(1, &mHandle.mHandle);
+    GLPLUS_CALL(glGenRenderbuffers)(1, &mHandle.mHandle);
     CheckGLErrors();
 }
 
 RenderBuffer::~RenderBuffer()
 {
-    glDeleteRenderbuffers(1, &mHandle.mHandle);
+    GLPLUS_CALL(glDeleteRenderbuffers)(1, &mHandle.mHandle);
     CheckGLErrors();
+
+    ForgetDeleted(tBindingCache.RenderBuffer, mHandle.mHandle);
 }
 
 RenderBufferBinding::RenderBufferBinding(RenderBuffer& renderBuffer)
     : mRenderBuffer(renderBuffer)
 {
-    glBindRenderbuffer(GL_RENDERBUFFER, mRenderBuffer.GetGLHandle());
-    CheckGLErrors();
+    BindRenderBuffer(mRenderBuffer.GetGLHandle());
 }
 
 void RenderBufferBinding::CreateStorage(GLenum internalformat, GLsizei width, GLsizei height)
 {
-    glRenderbufferStorage(GL_RENDERBUFFER, internalformat, width, height);
+    GLPLUS_CALL(glRenderbufferStorage)(GL_RENDERBUFFER, internalformat, width, height);
     CheckGLErrors();
 }
 
 ScopedRenderBufferBinding::OldHandle::OldHandle()
 {
-    GLint oldRenderbuffer;
-    glGetIntegerv(GL_RENDERBUFFER_BINDING, &oldRenderbuffer);
-    CheckGLErrors();
-
-    mOldRenderBuffer.mHandle = oldRenderbuffer;
+    mOldRenderBuffer.mHandle = GetCachedBinding(tBindingCache.RenderBuffer, GL_RENDERBUFFER_BINDING);
 }
 
 ScopedRenderBufferBinding::ScopedRenderBufferBinding(RenderBuffer& renderBuffer)
@@ -606,8 +1706,7 @@ ScopedRenderBufferBinding::ScopedRenderBufferBinding(RenderBuffer& renderBuffer)
 
 ScopedRenderBufferBinding::~ScopedRenderBufferBinding()
 {
-    glBindRenderbuffer(GL_RENDERBUFFER, mOldHandle.mOldRenderBuffer.mHandle);
-    CheckGLErrors();
+    BindRenderBuffer(mOldHandle.mOldRenderBuffer.mHandle);
 }
 
 FrameBuffer::Attachment::Attachment(const std::shared_ptr<Texture2D>& texture)
@@ -620,7 +1719,7 @@ FrameBuffer::Attachment::Attachment(const std::shared_ptr<RenderBuffer>& renderB
 
 FrameBuffer::FrameBuffer()
 {
-    glGenFramebuffers(1, &mHandle.mHandle);
+    GLPLUS_CALL(glGenFramebuffers)(1, &mHandle.mHandle);
     CheckGLErrors();
 }
 
@@ -631,21 +1730,27 @@ FrameBuffer::FrameBuffer(DefaultFrameBuffer)
 
 FrameBuffer::~FrameBuffer()
 {
-    glDeleteFramebuffers(1, &mHandle.mHandle);
+    GLPLUS_CALL(glDeleteFramebuffers)(1, &mHandle.mHandle);
     CheckGLErrors();
+
+    // the default framebuffer has nothing to delete, and stays bound.
+    if (mHandle.mHandle != 0)
+    {
+        ForgetDeleted(tBindingCache.DrawFrameBuffer, mHandle.mHandle);
+        ForgetDeleted(tBindingCache.ReadFrameBuffer, mHandle.mHandle);
+    }
 }
 
 FrameBufferBinding::FrameBufferBinding(FrameBuffer& frameBuffer, GLuint target)
     : mFrameBuffer(frameBuffer)
     , mTarget(target)
 {
-    glBindFramebuffer(mTarget, mFrameBuffer.GetGLHandle());
-    CheckGLErrors();
+    BindFrameBuffer(mTarget, mFrameBuffer.GetGLHandle());
 }
 
 void FrameBufferBinding::Attach(GLenum attachment, const std::shared_ptr<Texture2D>& texture)
 {
-    glFramebufferTexture2D(mTarget, attachment, GL_TEXTURE_2D, texture->GetGLHandle(), 0);
+    GLPLUS_CALL(glFramebufferTexture2D)(mTarget, attachment, GL_TEXTURE_2D, texture->GetGLHandle(), 0);
     CheckGLErrors();
 
     mFrameBuffer.mAttachments.emplace(attachment, texture);
@@ -653,7 +1758,7 @@ void FrameBufferBinding::Attach(GLenum attachment, const std::shared_ptr<Texture
 
 void FrameBufferBinding::Attach(GLenum attachment, const std::shared_ptr<RenderBuffer>& renderBuffer)
 {
-    glFramebufferRenderbuffer(mTarget, attachment, GL_RENDERBUFFER, renderBuffer->GetGLHandle());
+    GLPLUS_CALL(glFramebufferRenderbuffer)(mTarget, attachment, GL_RENDERBUFFER, renderBuffer->GetGLHandle());
     CheckGLErrors();
 
     mFrameBuffer.mAttachments.emplace(attachment, renderBuffer);
@@ -661,7 +1766,7 @@ void FrameBufferBinding::Attach(GLenum attachment, const std::shared_ptr<RenderB
 
 void FrameBufferBinding::Detach(GLenum attachment)
 {
-    glFramebufferRenderbuffer(mTarget, attachment, GL_RENDERBUFFER, 0);
+    GLPLUS_CALL(glFramebufferRenderbuffer)(mTarget, attachment, GL_RENDERBUFFER, 0);
     CheckGLErrors();
 
     mFrameBuffer.mAttachments.erase(attachment);
@@ -669,7 +1774,7 @@ void FrameBufferBinding::Detach(GLenum attachment)
 
 GLenum FrameBufferBinding::GetStatus() const
 {
-    GLenum status = glCheckFramebufferStatus(mTarget);
+    GLenum status = GLPLUS_CALL(glCheckFramebufferStatus)(mTarget);
     CheckGLErrors();
 
     return status;
@@ -686,29 +1791,14 @@ void FrameBufferBinding::ValidateStatus() const
 
 ScopedFrameBufferBinding::OldHandles::OldHandles(GLuint target)
 {
-    if (target == GL_FRAMEBUFFER)
+    if (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER)
     {
-        GLint oldFrameBuffer;
-        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &oldFrameBuffer);
-        CheckGLErrors();
-
-        mOldDrawFrameBuffer.mHandle = oldFrameBuffer;
+        mOldDrawFrameBuffer.mHandle = GetCachedBinding(tBindingCache.DrawFrameBuffer, GL_DRAW_FRAMEBUFFER_BINDING);
     }
-    else if (target == GL_DRAW_FRAMEBUFFER)
-    {
-        GLint oldDrawFrameBuffer;
-        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldDrawFrameBuffer);
-        CheckGLErrors();
 
-        mOldDrawFrameBuffer.mHandle = oldDrawFrameBuffer;
-    }
-    else if (target == GL_READ_FRAMEBUFFER)
+    if (target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER)
     {
-        GLint oldReadFrameBuffer;
-        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &oldReadFrameBuffer);
-        CheckGLErrors();
-
-        mOldReadFrameBuffer.mHandle = oldReadFrameBuffer;
+        mOldReadFrameBuffer.mHandle = GetCachedBinding(tBindingCache.ReadFrameBuffer, GL_READ_FRAMEBUFFER_BINDING);
     }
 }
 
@@ -721,18 +1811,23 @@ ScopedFrameBufferBinding::~ScopedFrameBufferBinding()
 {
     if (mBinding.GetTarget() == GL_FRAMEBUFFER)
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, mOldHandles.mOldDrawFrameBuffer.mHandle);
-        CheckGLErrors();
+        if (mOldHandles.mOldDrawFrameBuffer.mHandle == mOldHandles.mOldReadFrameBuffer.mHandle)
+        {
+            BindFrameBuffer(GL_FRAMEBUFFER, mOldHandles.mOldDrawFrameBuffer.mHandle);
+        }
+        else
+        {
+            BindFrameBuffer(GL_DRAW_FRAMEBUFFER, mOldHandles.mOldDrawFrameBuffer.mHandle);
+            BindFrameBuffer(GL_READ_FRAMEBUFFER, mOldHandles.mOldReadFrameBuffer.mHandle);
+        }
     }
     else if (mBinding.GetTarget() == GL_DRAW_FRAMEBUFFER)
     {
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mOldHandles.mOldDrawFrameBuffer.mHandle);
-        CheckGLErrors();
+        BindFrameBuffer(GL_DRAW_FRAMEBUFFER, mOldHandles.mOldDrawFrameBuffer.mHandle);
     }
     else if (mBinding.GetTarget() == GL_READ_FRAMEBUFFER)
     {
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, mOldHandles.mOldReadFrameBuffer.mHandle);
-        CheckGLErrors();
+        BindFrameBuffer(GL_READ_FRAMEBUFFER, mOldHandles.mOldReadFrameBuffer.mHandle);
     }
     else
     {
@@ -742,48 +1837,34 @@ ScopedFrameBufferBinding::~ScopedFrameBufferBinding()
 
 Sampler::Sampler()
 {
-    glGenSamplers(1, &mHandle.mHandle);
+    GLPLUS_CALL(glGenSamplers)(1, &mHandle.mHandle);
     CheckGLErrors();
 }
 
 Sampler::~Sampler()
 {
-    glDeleteSamplers(1, &mHandle.mHandle);
+    GLPLUS_CALL(glDeleteSamplers)(1, &mHandle.mHandle);
     CheckGLErrors();
+
+    ForgetDeleted(tBindingCache.Samplers, mHandle.mHandle);
 }
 
 void Sampler::SetParameter(GLenum pname, int param)
 {
-    glSamplerParameteri(mHandle.mHandle, pname, param);
+    GLPLUS_CALL(glSamplerParameteri)(mHandle.mHandle, pname, param);
     CheckGLErrors();
 }
 
 SamplerBinding::SamplerBinding(Sampler& sampler, GLuint textureUnit)
     : mSampler(sampler)
 {
-    glBindSampler(textureUnit, sampler.GetGLHandle());
-    CheckGLErrors();
+    BindSampler(textureUnit, sampler.GetGLHandle());
 }
 
 ScopedSamplerBinding::OldBinding::OldBinding(GLuint textureUnit)
 {
-    GLint oldActiveTexture;
-    glGetIntegerv(GL_ACTIVE_TEXTURE, &oldActiveTexture);
-    CheckGLErrors();
-
     mOldTextureUnit = textureUnit;
-
-    glActiveTexture(GL_TEXTURE0 + textureUnit);
-    CheckGLErrors();
-
-    GLint oldSampler;
-    glGetIntegerv(GL_SAMPLER_BINDING, &oldSampler);
-    CheckGLErrors();
-
-    mOldHandle.mHandle = oldSampler;
-
-    glActiveTexture(oldActiveTexture);
-    CheckGLErrors();
+    mOldHandle.mHandle = GetSamplerBinding(textureUnit);
 }
 
 ScopedSamplerBinding::ScopedSamplerBinding(Sampler& sampler, GLuint textureUnit)
@@ -793,19 +1874,24 @@ ScopedSamplerBinding::ScopedSamplerBinding(Sampler& sampler, GLuint textureUnit)
 
 ScopedSamplerBinding::~ScopedSamplerBinding()
 {
-    glBindSampler(mOldBinding.mOldTextureUnit, mOldBinding.mOldHandle.mHandle);
-    CheckGLErrors();
+    BindSampler(mOldBinding.mOldTextureUnit, mOldBinding.mOldHandle.mHandle);
 }
 
 void DrawArrays(GLenum mode, GLint first, GLsizei count)
 {
-    glDrawArrays(mode, first, count);
+    GLPLUS_CALL(glDrawArrays)(mode, first, count);
+    CheckGLErrors();
+}
+
+void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
+{
+    GLPLUS_CALL(glDrawArraysInstanced)(mode, first, count, instanceCount);
     CheckGLErrors();
 }
 
 void DrawElements(GLenum mode, GLenum indexType, GLint first, GLsizei count)
 {
-    glDrawElements(mode, count, indexType,
+    GLPLUS_CALL(glDrawElements)(mode, count, indexType,
                    (const GLvoid*) (SizeFromGLType(indexType) * first));
     CheckGLErrors();
 }
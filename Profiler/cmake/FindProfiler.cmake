@@ -0,0 +1,22 @@
+# Defines:
+# Profiler_FOUND - Always true
+# Profiler_INCLUDE_DIR - The include directory for Profiler
+# Profiler_INCLUDE_DIRS - All include directories needed by Profiler
+# Profiler_DEFINITIONS - Definitions every user of Profiler.hpp must build with
+# Profiler_LIBRARY - The library for Profiler
+# Profiler_DEPENDENCIES - The libraries Profiler depends on
+# Profiler_LIBRARIES - The library for Profiler and all dependencies
+
+find_package(Threads REQUIRED)
+
+set(Profiler_FOUND TRUE)
+set(Profiler_INCLUDE_DIR ${CMAKE_CURRENT_LIST_DIR}/../include)
+set(Profiler_INCLUDE_DIRS ${Profiler_INCLUDE_DIR})
+if(PROFILER_ENABLED)
+    set(Profiler_DEFINITIONS -DPROFILER_ENABLED=1)
+else()
+    set(Profiler_DEFINITIONS -DPROFILER_ENABLED=0)
+endif()
+set(Profiler_LIBRARY Profiler)
+set(Profiler_DEPENDENCIES ${CMAKE_THREAD_LIBS_INIT})
+set(Profiler_LIBRARIES ${Profiler_LIBRARY} ${Profiler_DEPENDENCIES})
@@ -0,0 +1,73 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Zone profiler. PROFILE_ZONE("name") times the rest of its scope, PROFILE_FRAME()
+// marks the end of a frame, and WriteChromeTrace saves everything recorded so far
+// as Chrome trace events (load it in chrome://tracing or ui.perfetto.dev).
+//
+// Each thread records into its own fixed size ring buffer, so marking a zone takes
+// no lock and never allocates. When a buffer wraps, its oldest zones are lost.
+// Zone names must be string literals, or otherwise outlive the profiler.
+//
+// Builds without PROFILER_ENABLED turn the macros into nothing.
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 0
+#endif
+
+namespace Profiler
+{
+
+// Nanoseconds on a steady clock.
+uint64_t Now();
+
+// Records a zone on the calling thread.
+void RecordZone(const char* name, uint64_t start, uint64_t end);
+
+// Ends the calling thread's current frame and starts the next.
+void MarkFrame();
+
+// Shown as the thread's name in the trace. The name is copied.
+void SetThreadName(const char* name);
+
+// Writes the zones recorded on every thread so far. Throws if the file can't be written.
+// Returns the number of zones written. Safe to call while other threads keep recording.
+size_t WriteChromeTrace(const char* filename);
+
+class ScopedZone
+{
+    const char* mName;
+    uint64_t mStart;
+
+public:
+    ScopedZone(const char* name)
+        : mName(name)
+        , mStart(Now())
+    { }
+
+    ~ScopedZone()
+    {
+        RecordZone(mName, mStart, Now());
+    }
+
+    ScopedZone(const ScopedZone&) = delete;
+    ScopedZone& operator=(const ScopedZone&) = delete;
+};
+
+} // end namespace Profiler
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_ZONE(name) ::Profiler::ScopedZone PROFILER_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FRAME() ::Profiler::MarkFrame()
+#else
+#define PROFILE_ZONE(name) do { } while (0)
+#define PROFILE_FRAME() do { } while (0)
+#endif
+
+#endif // PROFILER_HPP
@@ -0,0 +1,245 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+namespace Profiler
+{
+
+// zones kept per thread. a power of two, so the ring index is a mask.
+static const uint64_t kRingSize = 1 << 16;
+
+// Fields are atomics so the exporter can read a ring while its thread writes to it.
+// The stores are release stores (plain moves on x86), so an exporter that sees one
+// also sees the write count that came before it, and can tell the slot was reused.
+struct ZoneEvent
+{
+    std::atomic<const char*> Name;
+    std::atomic<uint64_t> Start;
+    std::atomic<uint64_t> End;
+};
+
+struct ThreadBuffer
+{
+    int ThreadIndex;
+    std::string Name; // guarded by the registry's mutex
+
+    std::unique_ptr<ZoneEvent[]> Events;
+    // zones ever recorded. only the owning thread writes it.
+    std::atomic<uint64_t> WriteCount;
+
+    uint64_t FrameStart = 0;
+
+    ThreadBuffer(int threadIndex)
+        : ThreadIndex(threadIndex)
+        , Events(new ZoneEvent[kRingSize])
+        , WriteCount(0)
+    { }
+};
+
+// Buffers outlive their threads, so zones of finished threads can still be exported.
+struct Registry
+{
+    std::mutex Mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+};
+
+static Registry& GetRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+static thread_local ThreadBuffer* tpThreadBuffer = nullptr;
+
+static ThreadBuffer& GetThreadBuffer()
+{
+    if (!tpThreadBuffer)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.Mutex);
+        registry.Buffers.emplace_back(new ThreadBuffer((int) registry.Buffers.size()));
+        tpThreadBuffer = registry.Buffers.back().get();
+    }
+    return *tpThreadBuffer;
+}
+
+uint64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void RecordZone(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadBuffer& buffer = GetThreadBuffer();
+    uint64_t index = buffer.WriteCount.load(std::memory_order_relaxed);
+
+    ZoneEvent& event = buffer.Events[index & (kRingSize - 1)];
+    event.Name.store(name, std::memory_order_release);
+    event.Start.store(start, std::memory_order_release);
+    event.End.store(end, std::memory_order_release);
+
+    buffer.WriteCount.store(index + 1, std::memory_order_release);
+}
+
+void MarkFrame()
+{
+    ThreadBuffer& buffer = GetThreadBuffer();
+    uint64_t now = Now();
+    if (buffer.FrameStart != 0)
+    {
+        RecordZone("Frame", buffer.FrameStart, now);
+    }
+    buffer.FrameStart = now;
+}
+
+void SetThreadName(const char* name)
+{
+    ThreadBuffer& buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(GetRegistry().Mutex);
+    buffer.Name = name;
+}
+
+struct ExportedZone
+{
+    const char* Name;
+    uint64_t Start;
+    uint64_t End;
+    int ThreadIndex;
+};
+
+// Copies what's left in a ring, dropping zones the owning thread overwrote during the copy.
+static void CopyZones(const ThreadBuffer& buffer, std::vector<ExportedZone>& zones)
+{
+    uint64_t end = buffer.WriteCount.load(std::memory_order_acquire);
+    uint64_t begin = end > kRingSize ? end - kRingSize : 0;
+
+    std::vector<ExportedZone> copied;
+    copied.reserve(end - begin);
+    for (uint64_t index = begin; index < end; index++)
+    {
+        const ZoneEvent& event = buffer.Events[index & (kRingSize - 1)];
+        ExportedZone zone;
+        zone.Name = event.Name.load(std::memory_order_relaxed);
+        zone.Start = event.Start.load(std::memory_order_relaxed);
+        zone.End = event.End.load(std::memory_order_relaxed);
+        zone.ThreadIndex = buffer.ThreadIndex;
+        copied.push_back(zone);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // the slot of the zone being written now, and every older one, may have been reused.
+    uint64_t endAfter = buffer.WriteCount.load(std::memory_order_relaxed);
+    uint64_t firstIntact = endAfter + 1 > kRingSize ? endAfter + 1 - kRingSize : 0;
+    size_t skip = (size_t) (std::max(firstIntact, begin) - begin);
+
+    zones.insert(zones.end(), copied.begin() + std::min(skip, copied.size()), copied.end());
+}
+
+static void WriteJSONString(std::ostream& out, const char* text)
+{
+    out << '"';
+    for (const char* c = text; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            out << '\\' << *c;
+        }
+        else if ((unsigned char) *c < 0x20)
+        {
+            out << ' ';
+        }
+        else
+        {
+            out << *c;
+        }
+    }
+    out << '"';
+}
+
+static void WriteMicroseconds(std::ostream& out, uint64_t nanoseconds)
+{
+    // integer math, since doubles lose the nanoseconds of long runs.
+    char digits[32];
+    snprintf(digits, sizeof(digits), "%llu.%03u",
+             (unsigned long long) (nanoseconds / 1000), (unsigned int) (nanoseconds % 1000));
+    out << digits;
+}
+
+size_t WriteChromeTrace(const char* filename)
+{
+    std::vector<ExportedZone> zones;
+    std::vector<std::pair<int, std::string>> threadNames;
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.Mutex);
+        for (const std::unique_ptr<ThreadBuffer>& pBuffer : registry.Buffers)
+        {
+            CopyZones(*pBuffer, zones);
+            threadNames.emplace_back(pBuffer->ThreadIndex, pBuffer->Name);
+        }
+    }
+
+    std::ofstream out(filename);
+    if (!out)
+    {
+        throw std::runtime_error(std::string("Failed to open ") + filename + " for writing");
+    }
+
+    uint64_t origin = UINT64_MAX;
+    for (const ExportedZone& zone : zones)
+    {
+        origin = std::min(origin, zone.Start);
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+    for (const std::pair<int, std::string>& threadName : threadNames)
+    {
+        if (threadName.second.empty())
+        {
+            continue;
+        }
+
+        out << (first ? "" : ",\n");
+        out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << threadName.first << ",\"args\":{\"name\":";
+        WriteJSONString(out, threadName.second.c_str());
+        out << "}}";
+        first = false;
+    }
+
+    for (const ExportedZone& zone : zones)
+    {
+        out << (first ? "" : ",\n");
+        out << "{\"ph\":\"X\",\"name\":";
+        WriteJSONString(out, zone.Name);
+        out << ",\"pid\":1,\"tid\":" << zone.ThreadIndex << ",\"ts\":";
+        WriteMicroseconds(out, zone.Start - origin);
+        out << ",\"dur\":";
+        WriteMicroseconds(out, zone.End - zone.Start);
+        out << "}";
+        first = false;
+    }
+
+    out << "\n]}\n";
+
+    if (!out)
+    {
+        throw std::runtime_error(std::string("Failed to write ") + filename);
+    }
+
+    return zones.size();
+}
+
+} // end namespace Profiler
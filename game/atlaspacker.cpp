@@ -0,0 +1,388 @@
+// Build step that packs the game's sprites into one atlas image and writes the
+// table of where each one went, so the game opens two files instead of one per sprite
+// and draws every billboard from the same texture.
+
+#include "spriteatlas.hpp"
+
+#include <SOIL2.h>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct PackerOptions
+{
+    std::string ImageFile;
+    std::string TableFile;
+    // border around each sprite, filled with copies of its edge pixels so that
+    // linear filtering at the sprite's edge doesn't pull in its neighbours.
+    int Padding = 2;
+    int MaxSize = 4096;
+    std::vector<std::string> SpriteFiles;
+};
+
+struct SourceSprite
+{
+    std::string Name;
+    int Width;
+    int Height;
+    std::vector<unsigned char> Pixels; // RGBA, top row first
+
+    // top-left of the padded rectangle in the atlas
+    int X;
+    int Y;
+};
+
+// Skyline bottom-left packing: the packed area is kept as a skyline of horizontal
+// segments, and each rectangle is put where it rests lowest, leftmost on ties.
+// Image rows grow downwards, so "lowest" here means the smallest y.
+class SkylinePacker
+{
+    struct Segment
+    {
+        int X;
+        int Y;
+        int Width;
+    };
+
+    int mWidth;
+    int mHeight = 0;
+    std::vector<Segment> mSkyline;
+
+public:
+    SkylinePacker(int width)
+        : mWidth(width)
+    {
+        Segment ground = { 0, 0, width };
+        mSkyline.push_back(ground);
+    }
+
+    // Height the packed rectangles reach so far.
+    int GetHeight() const { return mHeight; }
+
+    // Returns false if the rectangle is wider than the packer.
+    bool Insert(int width, int height, int& x, int& y)
+    {
+        size_t bestSegment = mSkyline.size();
+        int bestY = 0;
+
+        for (size_t first = 0; first < mSkyline.size(); first++)
+        {
+            int left = mSkyline[first].X;
+            if (left + width > mWidth)
+            {
+                break;
+            }
+
+            // the rectangle rests on the highest segment under it
+            int restY = 0;
+            for (size_t i = first; i < mSkyline.size() && mSkyline[i].X < left + width; i++)
+            {
+                restY = std::max(restY, mSkyline[i].Y);
+            }
+
+            if (bestSegment == mSkyline.size() || restY < bestY)
+            {
+                bestSegment = first;
+                bestY = restY;
+            }
+        }
+
+        if (bestSegment == mSkyline.size())
+        {
+            return false;
+        }
+
+        x = mSkyline[bestSegment].X;
+        y = bestY;
+        mHeight = std::max(mHeight, y + height);
+
+        // replace the segments under the rectangle by its top edge
+        Segment top = { x, y + height, width };
+        size_t end = bestSegment;
+        while (end < mSkyline.size() && mSkyline[end].X + mSkyline[end].Width <= x + width)
+        {
+            end++;
+        }
+        if (end < mSkyline.size() && mSkyline[end].X < x + width)
+        {
+            // partly covered, keep the part that sticks out to the right
+            int right = mSkyline[end].X + mSkyline[end].Width;
+            mSkyline[end].X = x + width;
+            mSkyline[end].Width = right - mSkyline[end].X;
+        }
+        mSkyline.erase(mSkyline.begin() + bestSegment, mSkyline.begin() + end);
+        mSkyline.insert(mSkyline.begin() + bestSegment, top);
+
+        // merge neighbours at the same height
+        for (size_t i = 0; i + 1 < mSkyline.size(); )
+        {
+            if (mSkyline[i].Y == mSkyline[i + 1].Y)
+            {
+                mSkyline[i].Width += mSkyline[i + 1].Width;
+                mSkyline.erase(mSkyline.begin() + i + 1);
+            }
+            else
+            {
+                i++;
+            }
+        }
+
+        return true;
+    }
+};
+
+static int NextPowerOfTwo(int value)
+{
+    int power = 1;
+    while (power < value)
+    {
+        power *= 2;
+    }
+    return power;
+}
+
+static std::string SpriteNameFromPath(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+static SourceSprite LoadSprite(const std::string& path)
+{
+    int width, height, channels;
+    unsigned char* pixels = SOIL_load_image(path.c_str(), &width, &height, &channels, SOIL_LOAD_RGBA);
+    if (!pixels)
+    {
+        throw std::runtime_error("Failed to load " + path + ": " + SOIL_last_result());
+    }
+
+    SourceSprite sprite;
+    sprite.Name = SpriteNameFromPath(path);
+    sprite.Width = width;
+    sprite.Height = height;
+    sprite.Pixels.assign(pixels, pixels + (size_t) width * height * 4);
+    sprite.X = 0;
+    sprite.Y = 0;
+
+    SOIL_free_image_data(pixels);
+    return sprite;
+}
+
+// Tries every power of two width and keeps the smallest power of two atlas.
+// Returns false if the sprites don't fit in maxSize x maxSize.
+static bool PackSprites(std::vector<SourceSprite>& sprites, int padding, int maxSize, int& atlasWidth, int& atlasHeight)
+{
+    // tallest first, widest first among equals: the usual order for skyline packing.
+    std::vector<size_t> order(sprites.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (sprites[a].Height != sprites[b].Height)
+        {
+            return sprites[a].Height > sprites[b].Height;
+        }
+        return sprites[a].Width > sprites[b].Width;
+    });
+
+    long long bestArea = 0;
+    std::vector<int> bestX, bestY;
+
+    for (int width = 1; width <= maxSize; width *= 2)
+    {
+        SkylinePacker packer(width);
+        std::vector<int> xs(sprites.size()), ys(sprites.size());
+
+        bool fits = true;
+        for (size_t index : order)
+        {
+            if (!packer.Insert(sprites[index].Width + 2 * padding, sprites[index].Height + 2 * padding,
+                               xs[index], ys[index]))
+            {
+                fits = false;
+                break;
+            }
+        }
+
+        int height = NextPowerOfTwo(std::max(packer.GetHeight(), 1));
+        if (!fits || height > maxSize)
+        {
+            continue;
+        }
+
+        // squarer wins ties, since widths are tried in increasing order.
+        long long area = (long long) width * height;
+        if (bestX.empty() || area < bestArea || (area == bestArea && width <= height))
+        {
+            bestArea = area;
+            bestX = xs;
+            bestY = ys;
+            atlasWidth = width;
+            atlasHeight = height;
+        }
+    }
+
+    if (bestX.empty())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < sprites.size(); i++)
+    {
+        sprites[i].X = bestX[i];
+        sprites[i].Y = bestY[i];
+    }
+    return true;
+}
+
+// Copies a sprite into its padded rectangle, extruding its edge pixels into the padding.
+static void BlitSprite(const SourceSprite& sprite, int padding, int atlasWidth, std::vector<unsigned char>& atlas)
+{
+    for (int y = 0; y < sprite.Height + 2 * padding; y++)
+    {
+        int sourceY = std::min(std::max(y - padding, 0), sprite.Height - 1);
+        for (int x = 0; x < sprite.Width + 2 * padding; x++)
+        {
+            int sourceX = std::min(std::max(x - padding, 0), sprite.Width - 1);
+            const unsigned char* source = &sprite.Pixels[((size_t) sourceY * sprite.Width + sourceX) * 4];
+            unsigned char* dest = &atlas[((size_t) (sprite.Y + y) * atlasWidth + sprite.X + x) * 4];
+            memcpy(dest, source, 4);
+        }
+    }
+}
+
+static const char* kUsage =
+    "usage: atlas_packer [options] <sprite.png>...\n"
+    "  --image <file.png>       atlas image to write\n"
+    "  --table <file>           sprite table to write\n"
+    "  --padding <N>            pixels of extruded border around each sprite (default: 2)\n"
+    "  --max-size <N>           largest atlas width or height (default: 4096)\n";
+
+static PackerOptions ParsePackerOptions(int argc, char* argv[])
+{
+    PackerOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        auto nextValue = [&]() -> const char* {
+            if (i + 1 >= argc)
+            {
+                throw std::runtime_error(std::string("Missing value for ") + arg);
+            }
+            return argv[++i];
+        };
+
+        if (!strcmp(arg, "--image"))
+        {
+            options.ImageFile = nextValue();
+        }
+        else if (!strcmp(arg, "--table"))
+        {
+            options.TableFile = nextValue();
+        }
+        else if (!strcmp(arg, "--padding"))
+        {
+            options.Padding = std::stoi(nextValue());
+        }
+        else if (!strcmp(arg, "--max-size"))
+        {
+            options.MaxSize = std::stoi(nextValue());
+        }
+        else if (!strcmp(arg, "--help"))
+        {
+            printf("%s", kUsage);
+            exit(0);
+        }
+        else if (arg[0] == '-')
+        {
+            fprintf(stderr, "%s", kUsage);
+            throw std::runtime_error(std::string("Unknown argument: ") + arg);
+        }
+        else
+        {
+            options.SpriteFiles.push_back(arg);
+        }
+    }
+
+    if (options.ImageFile.empty() || options.TableFile.empty() || options.SpriteFiles.empty())
+    {
+        fprintf(stderr, "%s", kUsage);
+        throw std::runtime_error("Need an image, a table and at least one sprite");
+    }
+
+    if (options.Padding < 0)
+    {
+        throw std::runtime_error("Padding can't be negative");
+    }
+
+    return options;
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        PackerOptions options = ParsePackerOptions(argc, argv);
+
+        std::vector<SourceSprite> sprites;
+        for (const std::string& file : options.SpriteFiles)
+        {
+            sprites.push_back(LoadSprite(file));
+            for (size_t i = 0; i + 1 < sprites.size(); i++)
+            {
+                if (sprites[i].Name == sprites.back().Name)
+                {
+                    throw std::runtime_error("Two sprites are named " + sprites.back().Name);
+                }
+            }
+        }
+
+        int atlasWidth, atlasHeight;
+        if (!PackSprites(sprites, options.Padding, options.MaxSize, atlasWidth, atlasHeight))
+        {
+            throw std::runtime_error("Sprites don't fit in a " + std::to_string(options.MaxSize) + " pixel atlas");
+        }
+
+        // transparent black where nothing was packed
+        std::vector<unsigned char> atlas((size_t) atlasWidth * atlasHeight * 4, 0);
+        SpriteAtlas table(glm::ivec2(atlasWidth, atlasHeight));
+        size_t usedPixels = 0;
+
+        // the table keeps the command line's order
+        for (const SourceSprite& sprite : sprites)
+        {
+            BlitSprite(sprite, options.Padding, atlasWidth, atlas);
+            table.AddSprite(sprite.Name,
+                            glm::ivec2(sprite.X + options.Padding, sprite.Y + options.Padding),
+                            glm::ivec2(sprite.Width, sprite.Height));
+            usedPixels += (size_t) sprite.Width * sprite.Height;
+        }
+
+        if (!SOIL_save_image(options.ImageFile.c_str(), SOIL_SAVE_TYPE_PNG, atlasWidth, atlasHeight, 4, atlas.data()))
+        {
+            throw std::runtime_error("Failed to write " + options.ImageFile + ": " + SOIL_last_result());
+        }
+
+        table.WriteFile(options.TableFile.c_str());
+
+        printf("packed %zu sprites into %dx%d (%.1f%% used)\n",
+               sprites.size(), atlasWidth, atlasHeight,
+               100.0 * usedPixels / ((double) atlasWidth * atlasHeight));
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Fatal exception: %s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,201 @@
+#include "billboardbatch.hpp"
+
+#include <Profiler.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+
+// changed instances closer than this are uploaded together, unchanged ones in between included.
+static const size_t kMaxUploadGap = 8;
+
+BillboardBatchStats& BillboardBatchStats::operator+=(const BillboardBatchStats& other)
+{
+    DrawCalls += other.DrawCalls;
+    InstancesDrawn += other.InstancesDrawn;
+    TextureBinds += other.TextureBinds;
+    BufferUploads += other.BufferUploads;
+    BytesUploaded += other.BytesUploaded;
+    return *this;
+}
+
+BillboardBatch::BillboardBatch(const std::shared_ptr<GLplus::Texture2D>& pAtlasTexture, const SpriteAtlas& atlas)
+    : mpAtlasTexture(pAtlasTexture)
+{
+    if (!mpAtlasTexture)
+    {
+        throw std::invalid_argument("BillboardBatch needs an atlas texture");
+    }
+
+    if (atlas.GetSpriteCount() > kMaxSprites)
+    {
+        throw std::length_error("Too many sprites in atlas for world.vs spriteRects");
+    }
+
+    for (size_t i = 0; i < atlas.GetSpriteCount(); i++)
+    {
+        mSpriteRects.push_back(atlas.GetSprite(i).UVRect);
+    }
+
+    glm::vec2 corners[4] = {
+        glm::vec2(0.0f, 0.0f),
+        glm::vec2(1.0f, 0.0f),
+        glm::vec2(1.0f, 1.0f),
+        glm::vec2(0.0f, 1.0f)
+    };
+
+    mpCorners.reset(new GLplus::Buffer());
+    {
+        GLplus::ScopedBufferBinding scopedBind(*mpCorners, GL_ARRAY_BUFFER);
+        scopedBind.GetBinding().Upload(sizeof(corners), corners, GL_STATIC_DRAW);
+    }
+
+    mpInstanceBuffer.reset(new GLplus::Buffer());
+
+    mVertexArrays.AddAttribute({ "corner", mpCorners, 2, GL_FLOAT, GL_FALSE, 0, 0, 0 });
+    mVertexArrays.AddAttribute({ "instanceCenter", mpInstanceBuffer, 3, GL_FLOAT, GL_FALSE,
+                                 sizeof(Instance), offsetof(Instance, Center), 1 });
+    mVertexArrays.AddAttribute({ "instanceDimensions", mpInstanceBuffer, 2, GL_FLOAT, GL_FALSE,
+                                 sizeof(Instance), offsetof(Instance, Dimensions), 1 });
+    mVertexArrays.AddAttribute({ "instanceSprite", mpInstanceBuffer, 1, GL_FLOAT, GL_FALSE,
+                                 sizeof(Instance), offsetof(Instance, Sprite), 1 });
+}
+
+void BillboardBatch::MarkDirty(size_t instance)
+{
+    if (instance < mIsDirty.size() && !mIsDirty[instance])
+    {
+        mIsDirty[instance] = true;
+        mDirtyInstances.push_back((uint32_t) instance);
+    }
+}
+
+size_t BillboardBatch::AddInstance(glm::vec3 centerPosition, glm::vec2 dimensions, int sprite)
+{
+    if (mInstances.size() >= UINT32_MAX)
+    {
+        throw std::length_error("Too many billboards in batch");
+    }
+
+    if (sprite < 0 || (size_t) sprite >= mSpriteRects.size())
+    {
+        throw std::out_of_range("No such sprite in atlas");
+    }
+
+    Instance instance = { centerPosition, dimensions, (float) sprite };
+    mInstances.push_back(instance);
+    mIsDirty.push_back(false);
+    MarkDirty(mInstances.size() - 1);
+    return mInstances.size() - 1;
+}
+
+void BillboardBatch::SetCenterPosition(size_t instance, glm::vec3 centerPosition)
+{
+    mInstances.at(instance).Center = centerPosition;
+    MarkDirty(instance);
+}
+
+void BillboardBatch::SetDimensions(size_t instance, glm::vec2 dimensions)
+{
+    mInstances.at(instance).Dimensions = dimensions;
+    MarkDirty(instance);
+}
+
+void BillboardBatch::SetSprite(size_t instance, int sprite)
+{
+    if (sprite < 0 || (size_t) sprite >= mSpriteRects.size())
+    {
+        throw std::out_of_range("No such sprite in atlas");
+    }
+
+    Instance& changed = mInstances.at(instance);
+    if (changed.Sprite != (float) sprite)
+    {
+        changed.Sprite = (float) sprite;
+        MarkDirty(instance);
+    }
+}
+
+void BillboardBatch::UpdateBuffers()
+{
+    PROFILE_ZONE("BillboardBatch::UpdateBuffers");
+
+    if (mDirtyInstances.empty())
+    {
+        return;
+    }
+
+    GLplus::ScopedBufferBinding scopedBind(*mpInstanceBuffer, GL_ARRAY_BUFFER);
+    GLplus::BufferBinding& bufferBinding = scopedBind.GetBinding();
+
+    if (mInstances.size() > mInstanceCapacity)
+    {
+        // grow geometrically and send everything, since the old contents are gone.
+        mInstanceCapacity = std::max(mInstances.size(), mInstanceCapacity * 2);
+        bufferBinding.Upload(mInstanceCapacity * sizeof(Instance), NULL, GL_DYNAMIC_DRAW);
+        bufferBinding.Patch(0, mInstances.size() * sizeof(Instance), mInstances.data());
+
+        mStats.BufferUploads++;
+        mStats.BytesUploaded += mInstances.size() * sizeof(Instance);
+    }
+    else
+    {
+        std::sort(mDirtyInstances.begin(), mDirtyInstances.end());
+
+        size_t runStart = 0;
+        while (runStart < mDirtyInstances.size())
+        {
+            size_t runEnd = runStart + 1;
+            while (runEnd < mDirtyInstances.size() &&
+                   mDirtyInstances[runEnd] - mDirtyInstances[runEnd - 1] <= kMaxUploadGap)
+            {
+                runEnd++;
+            }
+
+            size_t first = mDirtyInstances[runStart];
+            size_t count = mDirtyInstances[runEnd - 1] - first + 1;
+            bufferBinding.Patch(first * sizeof(Instance), count * sizeof(Instance), &mInstances[first]);
+
+            mStats.BufferUploads++;
+            mStats.BytesUploaded += count * sizeof(Instance);
+
+            runStart = runEnd;
+        }
+    }
+
+    for (uint32_t instance : mDirtyInstances)
+    {
+        mIsDirty[instance] = false;
+    }
+    mDirtyInstances.clear();
+}
+
+void BillboardBatch::Render(GLplus::Program& program, const BillboardBasis& basis)
+{
+    PROFILE_ZONE("BillboardBatch::Render");
+
+    UpdateBuffers();
+
+    if (mInstances.empty())
+    {
+        return;
+    }
+
+    GLplus::ScopedProgramBinding scopedProgram(program);
+    GLplus::ProgramBinding& programBinding = scopedProgram.GetBinding();
+    programBinding.UploadInt(mBillboardModeUniform.GetLocation(program), 1);
+    programBinding.UploadVec3(mBillboardSideUniform.GetLocation(program), &basis.Side[0]);
+    programBinding.UploadVec3(mBillboardUpUniform.GetLocation(program), &basis.Up[0]);
+    programBinding.UploadVec4Array(mSpriteRectsUniform.GetLocation(program), (GLsizei) mSpriteRects.size(), &mSpriteRects[0][0]);
+    programBinding.UploadInt(mDiffuseTextureUniform.GetLocation(program), 0);
+
+    GLplus::ScopedVertexArrayBinding scopedVAO(mVertexArrays.Get(program));
+    GLplus::ScopedActiveTextureBinding activeTextureBind(GL_TEXTURE0);
+    GLplus::ScopedTexture2DBinding textureBind(*mpAtlasTexture);
+
+    GLplus::DrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, (GLsizei) mInstances.size());
+
+    mStats.DrawCalls++;
+    mStats.InstancesDrawn += mInstances.size();
+    mStats.TextureBinds++;
+}
@@ -0,0 +1,97 @@
+#ifndef BILLBOARDBATCH_HPP
+#define BILLBOARDBATCH_HPP
+
+#include "spriteatlas.hpp"
+#include "geometry.hpp"
+
+#include <GLplus.hpp>
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+// What a batch asked GL to do, counted on the CPU so it can be checked without a GPU.
+struct BillboardBatchStats
+{
+    size_t DrawCalls = 0;
+    size_t InstancesDrawn = 0;
+    size_t TextureBinds = 0;
+    size_t BufferUploads = 0;
+    size_t BytesUploaded = 0;
+
+    BillboardBatchStats& operator+=(const BillboardBatchStats& other);
+};
+
+// Camera-facing sprites that share one atlas texture, drawn with a single instanced draw.
+// Each instance is a center, a size and a sprite of the atlas, kept together in
+// one buffer, and world.vs turns each into a quad facing the camera. The sprites' uv
+// rectangles are a uniform array indexed by the vertex shader. Only the instances
+// changed since the last draw are uploaded again, so the cost of a frame doesn't
+// grow with the number of billboards that sit still.
+class BillboardBatch
+{
+    struct Instance
+    {
+        glm::vec3 Center;
+        glm::vec2 Dimensions;
+        float Sprite;
+    };
+
+    std::shared_ptr<GLplus::Texture2D> mpAtlasTexture;
+    std::vector<glm::vec4> mSpriteRects;
+
+    std::vector<Instance> mInstances;
+
+    // instances changed since the last upload, without duplicates
+    std::vector<uint32_t> mDirtyInstances;
+    std::vector<bool> mIsDirty;
+
+    std::shared_ptr<GLplus::Buffer> mpCorners;
+    std::shared_ptr<GLplus::Buffer> mpInstanceBuffer;
+    size_t mInstanceCapacity = 0;
+
+    GLplus::VertexArrayCache mVertexArrays;
+
+    GLplus::UniformHandle mBillboardModeUniform{"billboardMode"};
+    GLplus::UniformHandle mBillboardSideUniform{"billboardSide"};
+    GLplus::UniformHandle mBillboardUpUniform{"billboardUp"};
+    GLplus::UniformHandle mSpriteRectsUniform{"spriteRects"};
+    GLplus::UniformHandle mDiffuseTextureUniform{"diffuseTexture"};
+
+    BillboardBatchStats mStats;
+
+    void MarkDirty(size_t instance);
+
+public:
+    // as many sprites as world.vs has room for
+    static const size_t kMaxSprites = 32;
+
+    // The texture must hold the image the atlas table describes.
+    BillboardBatch(const std::shared_ptr<GLplus::Texture2D>& pAtlasTexture, const SpriteAtlas& atlas);
+
+    // Returns the new instance's index. sprite is an index into the atlas.
+    size_t AddInstance(glm::vec3 centerPosition, glm::vec2 dimensions, int sprite);
+    size_t GetInstanceCount() const { return mInstances.size(); }
+
+    void SetCenterPosition(size_t instance, glm::vec3 centerPosition);
+    glm::vec3 GetCenterPosition(size_t instance) const { return mInstances.at(instance).Center; }
+
+    void SetDimensions(size_t instance, glm::vec2 dimensions);
+    glm::vec2 GetDimensions(size_t instance) const { return mInstances.at(instance).Dimensions; }
+
+    void SetSprite(size_t instance, int sprite);
+    int GetSprite(size_t instance) const { return (int) mInstances.at(instance).Sprite; }
+
+    // Uploads the changed instances. Called by Render.
+    void UpdateBuffers();
+
+    // Needs a program with world.vs, which is switched to billboard mode.
+    // Its projection and modelview must already be set.
+    void Render(GLplus::Program& program, const BillboardBasis& basis);
+
+    // Counts since the last ResetStats.
+    const BillboardBatchStats& GetStats() const { return mStats; }
+    void ResetStats() { mStats = BillboardBatchStats(); }
+};
+
+#endif // BILLBOARDBATCH_HPP
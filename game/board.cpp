@@ -0,0 +1,46 @@
+#include "board.hpp"
+
+#include <stdexcept>
+
+Board::Board(int width, int height, int mineCount, uint64_t seed, unsigned int numThreads)
+    : mMinefield(width, height)
+    , mMineCount(mineCount)
+    , mSeed(seed)
+    , mNumThreads(numThreads)
+{
+    if (mineCount < 0 || (size_t) mineCount > mMinefield.GetCellCount())
+    {
+        throw std::invalid_argument("mineCount");
+    }
+
+    Reset(0);
+}
+
+void Board::Reset()
+{
+    Reset(mBoardId + 1);
+}
+
+void Board::Reset(uint64_t boardId)
+{
+    mBoardId = boardId;
+    mUncoveredCount = 0;
+    mMinefield.GenerateMines(mMineCount, mSeed, mBoardId, mNumThreads);
+}
+
+RevealResult Board::Click(size_t cellIndex, std::vector<uint32_t>& changedCells)
+{
+    RevealResult result = mMinefield.Reveal(cellIndex, changedCells);
+
+    if (result == RevealResult::Revealed)
+    {
+        mUncoveredCount += changedCells.size();
+    }
+
+    return result;
+}
+
+bool Board::IsCleared() const
+{
+    return mUncoveredCount + mMineCount == mMinefield.GetCellCount();
+}
@@ -0,0 +1,45 @@
+#ifndef BOARD_HPP
+#define BOARD_HPP
+
+#include "minefield.hpp"
+
+// The rules of the mound game, independent of rendering.
+// Wraps a Minefield with mine placement, losing and winning.
+class Board
+{
+    Minefield mMinefield;
+    int mMineCount;
+    size_t mUncoveredCount = 0;
+
+    uint64_t mSeed;
+    uint64_t mBoardId = 0;
+
+    unsigned int mNumThreads;
+
+public:
+    // numThreads is how many threads place the mines of a large board, picked from its size when 0.
+    // Callers that already run a board per thread pass 1.
+    Board(int width, int height, int mineCount, uint64_t seed, unsigned int numThreads = 0);
+
+    // Covers every mound and places the mines of the next board id.
+    void Reset();
+    // Same as above, for a given board id. The layout only depends on the seed and the board id.
+    void Reset(uint64_t boardId);
+
+    uint64_t GetBoardId() const { return mBoardId; }
+
+    // Uncovers a mound. HitMine means the game is lost; it's up to the caller to Reset.
+    // changedCells receives the mounds that were uncovered.
+    RevealResult Click(size_t cellIndex, std::vector<uint32_t>& changedCells);
+
+    void ToggleFlag(size_t cellIndex) { mMinefield.ToggleFlag(cellIndex); }
+
+    // True once every mound that isn't a mine has been uncovered.
+    bool IsCleared() const;
+
+    int GetMineCount() const { return mMineCount; }
+
+    const Minefield& GetMinefield() const { return mMinefield; }
+};
+
+#endif // BOARD_HPP
@@ -0,0 +1,316 @@
+#include "chunkedminefield.hpp"
+#include "counterrandom.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+
+// cell byte layout, same as minefield.cpp: [0..3] adjacent mine count, [4] mine, [5..6] MoundState
+static const uint8_t kCountMask = 0x0F;
+static const uint8_t kMineBit = 0x10;
+static const int kStateShift = 5;
+static const uint8_t kStateMask = 0x60;
+
+static const uint8_t kUncoveredBits = (uint8_t) MoundState::Uncovered << kStateShift;
+static const uint8_t kFlaggedBits = (uint8_t) MoundState::Flagged << kStateShift;
+
+// compact chunk nibbles past the uncovered counts 0-8
+static const uint8_t kUntouchedNibble = 9;
+static const uint8_t kFlaggedNibble = 10;
+
+size_t ChunkedMinefield::ChunkKeyHash::operator()(const ChunkKey& key) const
+{
+    return Mix64((uint64_t) key.X * 0x9E3779B97F4A7C15ull + (uint64_t) key.Y);
+}
+
+ChunkedMinefield::ChunkedMinefield(uint64_t seed, float mineDensity, size_t maxRevealCells)
+    : mSeed(seed)
+    , mMaxRevealCells(maxRevealCells)
+{
+    if (!(mineDensity >= 0.0f && mineDensity <= 1.0f))
+    {
+        throw std::invalid_argument("mineDensity must be within [0,1]");
+    }
+
+    mMineThreshold = mineDensity >= 1.0f ? UINT64_MAX
+                                         : (uint64_t) (mineDensity * 18446744073709551616.0);
+}
+
+uint64_t ChunkedMinefield::ChunkSeed(ChunkKey key) const
+{
+    return Mix64(Mix64(mSeed ^ (uint64_t) key.X) + (uint64_t) key.Y);
+}
+
+bool ChunkedMinefield::IsMineInChunk(uint64_t chunkSeed, int localIndex) const
+{
+    return Mix64(chunkSeed + (uint64_t) localIndex * 0x9E3779B97F4A7C15ull) < mMineThreshold;
+}
+
+bool ChunkedMinefield::IsMine(int64_t x, int64_t y) const
+{
+    // arithmetic shifts, so negative coordinates land in negative chunks.
+    ChunkKey key = { x >> kChunkShift, y >> kChunkShift };
+    int localIndex = (int) ((y & (kChunkSize - 1)) * kChunkSize + (x & (kChunkSize - 1)));
+    return IsMineInChunk(ChunkSeed(key), localIndex);
+}
+
+void ChunkedMinefield::GenerateChunk(ChunkKey key, Chunk& chunk) const
+{
+    static const int kPadded = kChunkSize + 2;
+
+    // mines of the chunk plus a one cell border taken from its neighbours
+    std::array<uint8_t, kPadded * kPadded> mines;
+
+    uint64_t chunkSeed = ChunkSeed(key);
+    int64_t originX = key.X * kChunkSize;
+    int64_t originY = key.Y * kChunkSize;
+
+    for (int py = 0; py < kPadded; py++)
+    {
+        for (int px = 0; px < kPadded; px++)
+        {
+            int lx = px - 1;
+            int ly = py - 1;
+            bool inside = lx >= 0 && lx < kChunkSize && ly >= 0 && ly < kChunkSize;
+
+            mines[py * kPadded + px] = inside ? IsMineInChunk(chunkSeed, ly * kChunkSize + lx)
+                                              : IsMine(originX + lx, originY + ly);
+        }
+    }
+
+    for (int ly = 0; ly < kChunkSize; ly++)
+    {
+        for (int lx = 0; lx < kChunkSize; lx++)
+        {
+            const uint8_t* above = &mines[ly * kPadded + lx];
+            const uint8_t* middle = above + kPadded;
+            const uint8_t* below = middle + kPadded;
+
+            int count = above[0] + above[1] + above[2]
+                      + middle[0]            + middle[2]
+                      + below[0] + below[1] + below[2];
+
+            chunk.Cells[ly * kChunkSize + lx] = (uint8_t) count | (middle[1] ? kMineBit : 0);
+        }
+    }
+
+    // restore what the player did here before the chunk was packed away
+    auto compactIt = mCompactChunks.find(key);
+    if (compactIt != mCompactChunks.end())
+    {
+        const CompactChunk& compact = compactIt->second;
+        for (int i = 0; i < kChunkCells; i++)
+        {
+            uint8_t nibble = (compact.Nibbles[i / 2] >> ((i % 2) * 4)) & 0x0F;
+            if (nibble == kFlaggedNibble)
+            {
+                chunk.Cells[i] |= kFlaggedBits;
+            }
+            else if (nibble != kUntouchedNibble)
+            {
+                chunk.Cells[i] |= kUncoveredBits;
+            }
+        }
+        chunk.Touched = true;
+    }
+}
+
+ChunkedMinefield::Chunk& ChunkedMinefield::GetChunk(ChunkKey key)
+{
+    if (mpLastChunk && mLastKey == key)
+    {
+        return *mpLastChunk;
+    }
+
+    std::unique_ptr<Chunk>& pChunk = mLoadedChunks[key];
+    if (!pChunk)
+    {
+        pChunk.reset(new Chunk());
+        GenerateChunk(key, *pChunk);
+        mCompactChunks.erase(key);
+    }
+
+    mLastKey = key;
+    mpLastChunk = pChunk.get();
+    return *pChunk;
+}
+
+MoundState ChunkedMinefield::GetState(int64_t x, int64_t y) const
+{
+    ChunkKey key = { x >> kChunkShift, y >> kChunkShift };
+    int localIndex = (int) ((y & (kChunkSize - 1)) * kChunkSize + (x & (kChunkSize - 1)));
+
+    auto loadedIt = mLoadedChunks.find(key);
+    if (loadedIt != mLoadedChunks.end())
+    {
+        return (MoundState) ((loadedIt->second->Cells[localIndex] & kStateMask) >> kStateShift);
+    }
+
+    auto compactIt = mCompactChunks.find(key);
+    if (compactIt != mCompactChunks.end())
+    {
+        uint8_t nibble = (compactIt->second.Nibbles[localIndex / 2] >> ((localIndex % 2) * 4)) & 0x0F;
+        return nibble == kUntouchedNibble ? MoundState::Untouched
+             : nibble == kFlaggedNibble   ? MoundState::Flagged
+                                          : MoundState::Uncovered;
+    }
+
+    return MoundState::Untouched;
+}
+
+int ChunkedMinefield::GetAdjacentMineCount(int64_t x, int64_t y)
+{
+    ChunkKey key = { x >> kChunkShift, y >> kChunkShift };
+    int localIndex = (int) ((y & (kChunkSize - 1)) * kChunkSize + (x & (kChunkSize - 1)));
+    return GetChunk(key).Cells[localIndex] & kCountMask;
+}
+
+void ChunkedMinefield::ToggleFlag(int64_t x, int64_t y)
+{
+    ChunkKey key = { x >> kChunkShift, y >> kChunkShift };
+    int localIndex = (int) ((y & (kChunkSize - 1)) * kChunkSize + (x & (kChunkSize - 1)));
+
+    Chunk& chunk = GetChunk(key);
+    uint8_t& cell = chunk.Cells[localIndex];
+
+    if ((cell & kStateMask) == 0)
+    {
+        cell |= kFlaggedBits;
+        chunk.Touched = true;
+    }
+    else if ((cell & kStateMask) == kFlaggedBits)
+    {
+        cell &= ~kStateMask;
+    }
+}
+
+RevealResult ChunkedMinefield::Reveal(int64_t x, int64_t y, std::vector<CellCoord>& changedCells)
+{
+    changedCells.clear();
+
+    ChunkKey key = { x >> kChunkShift, y >> kChunkShift };
+    int localIndex = (int) ((y & (kChunkSize - 1)) * kChunkSize + (x & (kChunkSize - 1)));
+
+    Chunk& chunk = GetChunk(key);
+    uint8_t& cell = chunk.Cells[localIndex];
+
+    if ((cell & kStateMask) == kFlaggedBits)
+    {
+        return RevealResult::Ignored;
+    }
+
+    if ((cell & kStateMask) == kUncoveredBits)
+    {
+        // an uncovered empty cell may sit on the edge of a reveal that was cut short.
+        if ((cell & kCountMask) != 0)
+        {
+            return RevealResult::Ignored;
+        }
+    }
+    else
+    {
+        if (cell & kMineBit)
+        {
+            return RevealResult::HitMine;
+        }
+
+        cell |= kUncoveredBits;
+        chunk.Touched = true;
+        CellCoord clicked = { x, y };
+        changedCells.push_back(clicked);
+
+        if ((cell & kCountMask) != 0)
+        {
+            return RevealResult::Revealed;
+        }
+    }
+
+    // Depth-first flood fill. The Uncovered state doubles as the visited mark,
+    // so no per-reveal mask over an unbounded board is needed.
+    mFloodStack.clear();
+    CellCoord start = { x, y };
+    mFloodStack.push_back(start);
+
+    while (!mFloodStack.empty())
+    {
+        CellCoord current = mFloodStack.back();
+        mFloodStack.pop_back();
+
+        for (int64_t ny = current.Y - 1; ny <= current.Y + 1; ny++)
+        {
+            for (int64_t nx = current.X - 1; nx <= current.X + 1; nx++)
+            {
+                ChunkKey neighborKey = { nx >> kChunkShift, ny >> kChunkShift };
+                int neighborLocal = (int) ((ny & (kChunkSize - 1)) * kChunkSize + (nx & (kChunkSize - 1)));
+
+                Chunk& neighborChunk = GetChunk(neighborKey);
+                uint8_t& neighbor = neighborChunk.Cells[neighborLocal];
+
+                // neighbours of an empty cell are never mines, so only the state needs checking.
+                if ((neighbor & kStateMask) != 0)
+                {
+                    continue;
+                }
+
+                neighbor |= kUncoveredBits;
+                neighborChunk.Touched = true;
+                CellCoord neighborCoord = { nx, ny };
+                changedCells.push_back(neighborCoord);
+
+                if ((neighbor & kCountMask) == 0 && changedCells.size() < mMaxRevealCells)
+                {
+                    mFloodStack.push_back(neighborCoord);
+                }
+            }
+        }
+    }
+
+    return RevealResult::Revealed;
+}
+
+void ChunkedMinefield::EvictFarChunks(int64_t x, int64_t y, int keepRadius)
+{
+    int64_t focusX = x >> kChunkShift;
+    int64_t focusY = y >> kChunkShift;
+
+    for (auto it = mLoadedChunks.begin(); it != mLoadedChunks.end(); )
+    {
+        const ChunkKey& key = it->first;
+        int64_t distance = std::max(std::abs(key.X - focusX), std::abs(key.Y - focusY));
+        if (distance <= keepRadius)
+        {
+            ++it;
+            continue;
+        }
+
+        const Chunk& chunk = *it->second;
+        if (chunk.Touched)
+        {
+            CompactChunk& compact = mCompactChunks[key];
+            for (int i = 0; i < kChunkCells; i += 2)
+            {
+                uint8_t nibbles[2];
+                for (int half = 0; half < 2; half++)
+                {
+                    uint8_t cell = chunk.Cells[i + half];
+                    uint8_t state = cell & kStateMask;
+                    nibbles[half] = state == kUncoveredBits ? (cell & kCountMask)
+                                  : state == kFlaggedBits   ? kFlaggedNibble
+                                                            : kUntouchedNibble;
+                }
+                compact.Nibbles[i / 2] = nibbles[0] | (nibbles[1] << 4);
+            }
+        }
+
+        it = mLoadedChunks.erase(it);
+    }
+
+    mpLastChunk = nullptr;
+}
+
+size_t ChunkedMinefield::GetMemoryUsage() const
+{
+    return mLoadedChunks.size() * (sizeof(Chunk) + sizeof(ChunkKey) + sizeof(void*) * 2)
+         + mCompactChunks.size() * (sizeof(CompactChunk) + sizeof(ChunkKey) + sizeof(void*))
+         + mFloodStack.capacity() * sizeof(CellCoord);
+}
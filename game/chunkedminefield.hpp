@@ -0,0 +1,109 @@
+#ifndef CHUNKEDMINEFIELD_HPP
+#define CHUNKEDMINEFIELD_HPP
+
+#include "minefield.hpp"
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+struct CellCoord
+{
+    int64_t X;
+    int64_t Y;
+};
+
+// Unbounded minesweeper board, generated lazily in 64x64 chunks.
+// A chunk's mines are derived from a hash of the seed and the chunk coordinate,
+// so any chunk can be rebuilt on demand and neighbour counts across chunk borders
+// only need the mines along the edge of the adjacent chunks, not the chunks themselves.
+// Chunks that are never touched cost nothing. Touched chunks far from the focus are
+// packed down to 4 bits per cell, so memory grows with the explored area only.
+class ChunkedMinefield
+{
+public:
+    static const int kChunkShift = 6;
+    static const int kChunkSize = 1 << kChunkShift;
+    static const int kChunkCells = kChunkSize * kChunkSize;
+
+private:
+    struct ChunkKey
+    {
+        int64_t X;
+        int64_t Y;
+
+        bool operator==(const ChunkKey& other) const { return X == other.X && Y == other.Y; }
+    };
+
+    struct ChunkKeyHash
+    {
+        size_t operator()(const ChunkKey& key) const;
+    };
+
+    // Same byte layout as Minefield: count, mine bit, state.
+    struct Chunk
+    {
+        std::array<uint8_t, kChunkCells> Cells;
+        bool Touched = false;
+    };
+
+    // One nibble per cell: 0-8 is an uncovered cell's count, then untouched and flagged.
+    // Mines and counts of covered cells are rebuilt from the hash when the chunk is loaded again.
+    struct CompactChunk
+    {
+        std::array<uint8_t, kChunkCells / 2> Nibbles;
+    };
+
+    uint64_t mSeed;
+    uint64_t mMineThreshold;
+    size_t mMaxRevealCells;
+
+    std::unordered_map<ChunkKey, std::unique_ptr<Chunk>, ChunkKeyHash> mLoadedChunks;
+    std::unordered_map<ChunkKey, CompactChunk, ChunkKeyHash> mCompactChunks;
+
+    // most recently used chunk, since flood fills and queries are very local
+    ChunkKey mLastKey;
+    Chunk* mpLastChunk = nullptr;
+
+    std::vector<CellCoord> mFloodStack;
+
+    uint64_t ChunkSeed(ChunkKey key) const;
+    bool IsMineInChunk(uint64_t chunkSeed, int localIndex) const;
+
+    Chunk& GetChunk(ChunkKey key);
+    void GenerateChunk(ChunkKey key, Chunk& chunk) const;
+
+    uint8_t& GetCell(int64_t x, int64_t y);
+
+public:
+    // mineDensity is the chance of each cell holding a mine.
+    // Reveals stop spreading after maxRevealCells cells; clicking an uncovered empty cell
+    // on the edge of a cut-off reveal carries it on.
+    ChunkedMinefield(uint64_t seed, float mineDensity, size_t maxRevealCells = 1 << 20);
+
+    // Doesn't need the chunk to be loaded.
+    bool IsMine(int64_t x, int64_t y) const;
+    // Doesn't load any chunk. Cells of chunks never touched are Untouched.
+    MoundState GetState(int64_t x, int64_t y) const;
+
+    int GetAdjacentMineCount(int64_t x, int64_t y);
+
+    void ToggleFlag(int64_t x, int64_t y);
+
+    // Same rules as Minefield::Reveal, across chunk borders.
+    RevealResult Reveal(int64_t x, int64_t y, std::vector<CellCoord>& changedCells);
+
+    // Packs touched chunks more than keepRadius chunks away from the given cell,
+    // and drops untouched ones since they can be regenerated.
+    void EvictFarChunks(int64_t x, int64_t y, int keepRadius);
+
+    size_t GetLoadedChunkCount() const { return mLoadedChunks.size(); }
+    size_t GetCompactChunkCount() const { return mCompactChunks.size(); }
+
+    // Approximate bytes held by chunk storage.
+    size_t GetMemoryUsage() const;
+};
+
+#endif // CHUNKEDMINEFIELD_HPP
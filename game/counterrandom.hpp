@@ -0,0 +1,44 @@
+#ifndef COUNTERRANDOM_HPP
+#define COUNTERRANDOM_HPP
+
+#include <cstdint>
+
+// splitmix64 finalizer
+inline uint64_t Mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Counter-based random numbers: the n-th value of a stream is a pure function of
+// the stream's key and n, so any thread can produce any part of a stream and get
+// the same numbers as every other split of the work.
+class CounterRandom
+{
+    uint64_t mKey;
+
+public:
+    CounterRandom(uint64_t seed, uint64_t stream)
+        : mKey(Mix64(Mix64(seed) ^ (stream * 0x9E3779B97F4A7C15ull)))
+    { }
+
+    // Independent stream derived from this one.
+    CounterRandom Substream(uint64_t stream) const
+    {
+        return CounterRandom(mKey, stream);
+    }
+
+    uint64_t operator()(uint64_t counter) const
+    {
+        return Mix64(mKey + counter * 0x9E3779B97F4A7C15ull);
+    }
+
+    // Value in [0, bound), by multiply-shift rather than modulo. The bias is at most bound / 2^32.
+    uint32_t Below(uint64_t counter, uint32_t bound) const
+    {
+        return (uint32_t) (((*this)(counter) >> 32) * bound >> 32);
+    }
+};
+
+#endif // COUNTERRANDOM_HPP
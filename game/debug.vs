@@ -3,8 +3,12 @@
 in vec4 position;
 in vec4 tint;
 
-uniform mat4 modelview;
-uniform mat4 projection;
+// shared by every program, written once a frame. CameraBlock in worldscene.hpp must match.
+layout(std140) uniform Camera
+{
+    mat4 projection;
+    mat4 modelview;
+};
 
 out vec4 ftint;
 
@@ -18,6 +18,14 @@ void DebugDraw::AddLine(glm::vec3 start, glm::vec3 end, glm::vec4 tint)
     mIsDirty = true;
 }
 
+void DebugDraw::Clear()
+{
+    mLines.clear();
+    mTints.clear();
+
+    mIsDirty = true;
+}
+
 void DebugDraw::RebuildBuffers()
 {
     std::shared_ptr<GLplus::Buffer> newPositions(new GLplus::Buffer());
@@ -36,6 +44,10 @@ void DebugDraw::RebuildBuffers()
     mPositionBuffer = std::move(newPositions);
     mTintBuffer = std::move(newTints);
 
+    mVertexArrays.Clear();
+    mVertexArrays.AddAttribute({ "position", mPositionBuffer, 3, GL_FLOAT, GL_FALSE, 0, 0, 0 });
+    mVertexArrays.AddAttribute({ "tint", mTintBuffer, 4, GL_FLOAT, GL_FALSE, 0, 0, 0 });
+
     mIsDirty = false;
 }
 
@@ -46,21 +58,7 @@ void DebugDraw::Render(GLplus::Program& program)
         RebuildBuffers();
     }
 
-    GLplus::VertexArray vao;
-    GLplus::ScopedVertexArrayBinding scopedVAO(vao);
-    GLplus::VertexArrayBinding& vaoBinding = scopedVAO.GetBinding();
-
-    GLint positionLoc;
-    if (program.TryGetAttributeLocation("position", positionLoc))
-    {
-        vaoBinding.SetAttribute(positionLoc, mPositionBuffer, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    }
-
-    GLint tintLoc;
-    if (program.TryGetAttributeLocation("tint", tintLoc))
-    {
-        vaoBinding.SetAttribute(tintLoc, mTintBuffer, 4, GL_FLOAT, GL_FALSE, 0, 0);
-    }
+    GLplus::ScopedVertexArrayBinding scopedVAO(mVertexArrays.Get(program));
 
     glLineWidth(mLineWidth);
 
@@ -15,6 +15,8 @@ class DebugDraw
     std::shared_ptr<GLplus::Buffer> mPositionBuffer;
     std::shared_ptr<GLplus::Buffer> mTintBuffer;
 
+    GLplus::VertexArrayCache mVertexArrays;
+
     float mLineWidth = 1.0f;
 
     bool mIsDirty = true;
@@ -23,6 +25,7 @@ public:
     void SetLineWidth(float width);
 
     void AddLine(glm::vec3 start, glm::vec3 end, glm::vec4 tint);
+    void Clear();
 
     void RebuildBuffers();
 
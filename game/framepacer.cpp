@@ -0,0 +1,140 @@
+#include "framepacer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+// the last stretch of a precise wait spins instead of sleeping, since sleeps may overshoot by a millisecond or more.
+static const double kSpinSeconds = 0.002;
+
+FramePacer::FramePacer(const FramePacerOptions& options, unsigned int millisecondsPerUpdate)
+    : mOptions(options)
+{
+    if (millisecondsPerUpdate == 0)
+    {
+        throw std::invalid_argument("Updates need a nonzero step");
+    }
+
+    if (mOptions.TargetFramesPerSecond < 0.0)
+    {
+        throw std::invalid_argument("Target frame rate can't be negative");
+    }
+
+    mOptions.MaxCatchUpUpdates = std::max(mOptions.MaxCatchUpUpdates, 1);
+
+    mFrequency = SDL_GetPerformanceFrequency();
+    mUpdateTicks = mFrequency * millisecondsPerUpdate / 1000;
+    mFrameTicks = mOptions.VSync || mOptions.TargetFramesPerSecond == 0.0
+                ? 0 : (Uint64) (mFrequency / mOptions.TargetFramesPerSecond);
+
+    mLastTime = SDL_GetPerformanceCounter();
+    mNextFrameDeadline = mLastTime;
+    mStatsStart = mLastTime;
+}
+
+int FramePacer::BeginFrame()
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    mFrameStart = now;
+    mLag += now - mLastTime;
+    mLastTime = now;
+
+    Uint64 maxLag = mUpdateTicks * mOptions.MaxCatchUpUpdates;
+    if (mLag > maxLag)
+    {
+        mStats.UpdatesDropped += (mLag - maxLag) / mUpdateTicks;
+        mLag = maxLag + mLag % mUpdateTicks;
+    }
+
+    int updates = (int) (mLag / mUpdateTicks);
+    mLag -= updates * mUpdateTicks;
+    mStats.UpdatesRun += updates;
+    return updates;
+}
+
+float FramePacer::GetPartialUpdatePercentage() const
+{
+    return (float) mLag / mUpdateTicks;
+}
+
+void FramePacer::EndFrame(bool rendered)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    mStats.BusySeconds += (double) (now - mFrameStart) / mFrequency;
+
+    if (!rendered)
+    {
+        mStats.FramesSkipped++;
+        return;
+    }
+
+    if (mStats.FramesRendered > 0)
+    {
+        mStats.MaxFrameSeconds = std::max(mStats.MaxFrameSeconds, (double) (now - mLastRenderedFrame) / mFrequency);
+    }
+    mStats.FramesRendered++;
+    mLastRenderedFrame = now;
+
+    // keep to the schedule, unless a whole frame has been missed. then start a new one from here.
+    mNextFrameDeadline += mFrameTicks;
+    if (mNextFrameDeadline + mFrameTicks < now)
+    {
+        mNextFrameDeadline = now + mFrameTicks;
+    }
+}
+
+bool FramePacer::IsFrameDue() const
+{
+    return mFrameTicks == 0 || SDL_GetPerformanceCounter() >= mNextFrameDeadline;
+}
+
+void FramePacer::WaitForNextFrame(bool idle)
+{
+    if (idle)
+    {
+        // nothing to draw, so the only thing due is the next update. Sleeping a millisecond at a time
+        // keeps the CPU near idle, and input as quick to handle as when drawing.
+        WaitUntil(mLastTime + (mUpdateTicks - mLag), false);
+    }
+    else if (mFrameTicks != 0)
+    {
+        WaitUntil(mNextFrameDeadline, true);
+    }
+}
+
+void FramePacer::WaitUntil(Uint64 deadline, bool precise)
+{
+    Uint64 spinTicks = precise ? (Uint64) (kSpinSeconds * mFrequency) : 0;
+
+    while (true)
+    {
+        SDL_PumpEvents();
+        if (SDL_HasEvents(SDL_FIRSTEVENT, SDL_LASTEVENT))
+        {
+            return;
+        }
+
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now >= deadline)
+        {
+            return;
+        }
+
+        // SDL_WaitEventTimeout sleeps 10ms between polls, too coarse for input, so poll every millisecond.
+        if (deadline - now > spinTicks)
+        {
+            SDL_Delay(1);
+        }
+    }
+}
+
+const FrameTimeStats& FramePacer::GetStats()
+{
+    mStats.ElapsedSeconds = (double) (SDL_GetPerformanceCounter() - mStatsStart) / mFrequency;
+    return mStats;
+}
+
+void FramePacer::ResetStats()
+{
+    mStats = FrameTimeStats();
+    mStatsStart = SDL_GetPerformanceCounter();
+}
@@ -0,0 +1,87 @@
+#ifndef FRAMEPACER_HPP
+#define FRAMEPACER_HPP
+
+#include <SDL.h>
+
+struct FramePacerOptions
+{
+    // rendered frames per second when not using vsync. 0 renders as fast as possible.
+    double TargetFramesPerSecond = 60.0;
+
+    // let the buffer swap pace rendering instead of the timer
+    bool VSync = false;
+
+    // skip rendering and sleep while the scene has nothing new to show
+    bool IdleWhenUnchanged = true;
+
+    // updates run at most this far behind real time. Any more lag is dropped,
+    // so a long stall doesn't turn into a burst of catch-up updates.
+    int MaxCatchUpUpdates = 5;
+};
+
+// Counted since the last ResetStats.
+struct FrameTimeStats
+{
+    size_t FramesRendered = 0;
+    size_t FramesSkipped = 0;
+    size_t UpdatesRun = 0;
+    size_t UpdatesDropped = 0;
+
+    double ElapsedSeconds = 0.0;
+    // time spent between the start and end of frames, i.e. not waiting
+    double BusySeconds = 0.0;
+    // longest time between two rendered frames
+    double MaxFrameSeconds = 0.0;
+};
+
+// Decides when the main loop updates, renders and sleeps.
+// Updates have a fixed step and are caught up from a lag, as before, but the lag is capped.
+// Rendered frames are spaced by the target rate, and in between the loop sleeps,
+// waking early for input so that handling it isn't delayed by the sleep.
+// Input handled early doesn't bring the next frame forward: that waits for IsFrameDue.
+// Times come from SDL_GetPerformanceCounter, not the millisecond SDL_GetTicks.
+class FramePacer
+{
+    FramePacerOptions mOptions;
+
+    Uint64 mFrequency;
+    Uint64 mUpdateTicks;
+    Uint64 mFrameTicks; // 0 when rendering isn't paced by the timer
+
+    Uint64 mLastTime;
+    Uint64 mLag = 0;
+    Uint64 mFrameStart = 0;
+    Uint64 mNextFrameDeadline;
+    Uint64 mLastRenderedFrame = 0;
+
+    Uint64 mStatsStart;
+    FrameTimeStats mStats;
+
+    void WaitUntil(Uint64 deadline, bool precise);
+
+public:
+    // vsync must already be set up on the window, if it is asked for.
+    FramePacer(const FramePacerOptions& options, unsigned int millisecondsPerUpdate);
+
+    const FramePacerOptions& GetOptions() const { return mOptions; }
+
+    // Starts a frame and returns how many fixed updates to run in it.
+    int BeginFrame();
+
+    // How far real time is into the next update, from 0 to 1.
+    float GetPartialUpdatePercentage() const;
+
+    // Whether the target rate allows rendering now. Always true when vsync or nothing paces it.
+    bool IsFrameDue() const;
+
+    void EndFrame(bool rendered);
+
+    // Sleeps until the next frame is due, or until input arrives.
+    // An idle loop only needs to wake for the next update, and does so less precisely.
+    void WaitForNextFrame(bool idle);
+
+    const FrameTimeStats& GetStats();
+    void ResetStats();
+};
+
+#endif // FRAMEPACER_HPP
@@ -1,13 +1,163 @@
 #include "gamecontext.hpp"
 
 #include "worldscene.hpp"
+#include "headlessscene.hpp"
+
+#include <Profiler.hpp>
+
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+static const char* kUsage =
+    "usage: game [options]\n"
+    "  --headless               run the board logic without a window or GL\n"
+    "  --infinite               play on an unbounded board, explored with the arrow keys\n"
+    "  --fps <N>                frames rendered per second, 0 for unlimited (default: 60)\n"
+    "  --vsync                  pace rendering with the display instead of --fps\n"
+    "  --no-idle                render every frame, even when nothing changed\n"
+    "  --max-catch-up <N>       most updates run in one frame to catch up after a stall (default: 5)\n"
+    "  --frame-stats            print frame time and GL call statistics every second\n"
+    "  --trace <file>           write profiler zones as a Chrome trace on exit (F12 writes one any time)\n"
+    "  --gl-errors <mode>       every-call, per-frame, debug-callback or off (default: the build's)\n"
+    "  --board-size <N | WxH>   board dimensions in mounds (headless)\n"
+    "  --mines <N>              number of mines (headless)\n"
+    "  --seed <N>               seed for mine placement and random clicks (headless)\n"
+    "  --frames <N>             number of updates to simulate (headless)\n"
+    "  --clicks-per-frame <N>   random clicks issued each update (headless)\n"
+    "  --script <file>          take clicks from a script instead (headless)\n";
+
+static GameOptions ParseGameOptions(int argc, char* argv[])
+{
+    GameOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        auto nextValue = [&]() -> const char* {
+            if (i + 1 >= argc)
+            {
+                throw std::runtime_error(std::string("Missing value for ") + arg);
+            }
+            return argv[++i];
+        };
+
+        if (!strcmp(arg, "--headless"))
+        {
+            options.Headless = true;
+        }
+        else if (!strcmp(arg, "--infinite"))
+        {
+            options.Infinite = true;
+        }
+        else if (!strcmp(arg, "--fps"))
+        {
+            options.Pacing.TargetFramesPerSecond = std::stod(nextValue());
+        }
+        else if (!strcmp(arg, "--vsync"))
+        {
+            options.Pacing.VSync = true;
+        }
+        else if (!strcmp(arg, "--no-idle"))
+        {
+            options.Pacing.IdleWhenUnchanged = false;
+        }
+        else if (!strcmp(arg, "--max-catch-up"))
+        {
+            options.Pacing.MaxCatchUpUpdates = std::stoi(nextValue());
+        }
+        else if (!strcmp(arg, "--frame-stats"))
+        {
+            options.PrintFrameStats = true;
+        }
+        else if (!strcmp(arg, "--trace"))
+        {
+            options.TraceFile = nextValue();
+        }
+        else if (!strcmp(arg, "--gl-errors"))
+        {
+            options.GLErrorCheckMode = nextValue();
+            GLplus::ErrorCheckModeFromString(options.GLErrorCheckMode.c_str());
+        }
+        else if (!strcmp(arg, "--board-size"))
+        {
+            std::string value = nextValue();
+            size_t separator = value.find('x');
+            options.BoardWidth = std::stoi(value.substr(0, separator));
+            options.BoardHeight = separator == std::string::npos ? options.BoardWidth
+                                                                 : std::stoi(value.substr(separator + 1));
+        }
+        else if (!strcmp(arg, "--mines"))
+        {
+            options.MineCount = std::stoi(nextValue());
+        }
+        else if (!strcmp(arg, "--seed"))
+        {
+            options.Seed = std::stoul(nextValue());
+        }
+        else if (!strcmp(arg, "--frames"))
+        {
+            options.Frames = std::stoul(nextValue());
+        }
+        else if (!strcmp(arg, "--clicks-per-frame"))
+        {
+            options.ClicksPerFrame = std::stoi(nextValue());
+        }
+        else if (!strcmp(arg, "--script"))
+        {
+            options.ScriptFile = nextValue();
+        }
+        else if (!strcmp(arg, "--help"))
+        {
+            printf("%s", kUsage);
+            exit(0);
+        }
+        else
+        {
+            fprintf(stderr, "%s", kUsage);
+            throw std::runtime_error(std::string("Unknown argument: ") + arg);
+        }
+    }
+
+    return options;
+}
 
 GameContext::GameContext(int argc, char* argv[])
+    : mOptions(ParseGameOptions(argc, argv))
 {
+    Profiler::SetThreadName("Main");
+
+    mMillisecondsPerUpdate = 1000/60;
+
+    if (mOptions.Headless)
+    {
+        // only the timer is needed, so this works on machines without a display.
+        mpSDL.reset(new SDL2plus::LibSDL(SDL_INIT_TIMER));
+
+        HeadlessScene* pHeadlessScene = new HeadlessScene(
+                    mOptions.BoardWidth, mOptions.BoardHeight, mOptions.MineCount,
+                    mOptions.Seed, mOptions.ClicksPerFrame);
+        mpCurrentScene.reset(pHeadlessScene);
+        mpHeadlessScene = pHeadlessScene;
+
+        if (!mOptions.ScriptFile.empty())
+        {
+            mpHeadlessScene->LoadScript(mOptions.ScriptFile.c_str());
+        }
+
+        return;
+    }
+
     mpSDL.reset(new SDL2plus::LibSDL(SDL_INIT_VIDEO));
     mpSDL->SetGLAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    mpSDL->SetGLAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    mpSDL->SetGLAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     mpSDL->SetGLAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    if (mOptions.GLErrorCheckMode == "debug-callback")
+    {
+        mpSDL->SetGLAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+    }
 
     mpWindow.reset(new SDL2plus::WindowGL(
                       "Beneath the Surface",
@@ -15,6 +165,20 @@ GameContext::GameContext(int argc, char* argv[])
                       SDL_WINDOWPOS_UNDEFINED,
                       640, 480, SDL_WINDOW_OPENGL));
 
+    if (!mOptions.GLErrorCheckMode.empty())
+    {
+        GLplus::SetErrorCheckMode(GLplus::ErrorCheckModeFromString(mOptions.GLErrorCheckMode.c_str()));
+    }
+
+    // printed with the frame times
+    GLplus::FrameStats::SetCollecting(mOptions.PrintFrameStats);
+
+    if (mOptions.Pacing.VSync && SDL_GL_SetSwapInterval(1) != 0)
+    {
+        fprintf(stderr, "vsync not available, pacing frames with the timer instead\n");
+        mOptions.Pacing.VSync = false;
+    }
+
     mpWindowFrameBuffer.reset(new GLplus::FrameBuffer(GLplus::DefaultFrameBuffer()));
 
     Viewport viewport(glm::ivec2(0), glm::ivec2(mpWindow->GetWidth(), mpWindow->GetHeight()));
@@ -22,22 +186,28 @@ GameContext::GameContext(int argc, char* argv[])
     mpRenderContext->CurrentFrameBuffer = mpWindowFrameBuffer;
     mpRenderContext->CurrentViewport = viewport;
 
-    mpCurrentScene.reset(new WorldScene());
-
-    mMillisecondsPerUpdate = 1000/60;
+    mpCurrentScene.reset(new WorldScene(mOptions.Infinite));
 }
 
 void GameContext::MainLoop()
 {
-    Uint32 lastTime = SDL_GetTicks();
-    Uint32 timeLag = 0;
+    if (mpHeadlessScene)
+    {
+        HeadlessMainLoop();
+        if (!mOptions.TraceFile.empty())
+        {
+            WriteTrace(mOptions.TraceFile);
+        }
+        return;
+    }
+
+    FramePacer pacer(mOptions.Pacing, mMillisecondsPerUpdate);
 
     while (true)
     {
-        Uint32 currentTime = SDL_GetTicks();
-        Uint32 deltaTime = currentTime - lastTime;
-        lastTime = currentTime;
-        timeLag += deltaTime;
+        PROFILE_FRAME();
+
+        int numUpdates = pacer.BeginFrame();
 
         SDL_Event event;
         while (SDL_PollEvent(&event))
@@ -48,21 +218,97 @@ void GameContext::MainLoop()
             }
             else
             {
+                if (event.type == SDL_WINDOWEVENT)
+                {
+                    mIsRedrawForced = true;
+                }
+                else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F12)
+                {
+                    WriteTrace(mOptions.TraceFile.empty() ? "trace.json" : mOptions.TraceFile);
+                }
                 HandleEvent(event);
             }
         }
 
-        while (timeLag >= mMillisecondsPerUpdate)
+        for (int i = 0; i < numUpdates; i++)
         {
             Update(mMillisecondsPerUpdate);
-            timeLag -= mMillisecondsPerUpdate;
         }
 
-        float partialUpdatePercentage = (float) timeLag / mMillisecondsPerUpdate;
-        Render(*mpRenderContext, partialUpdatePercentage);
+        // input can wake the loop between frames. It's handled at once, but drawn when the frame is due.
+        bool rendering = IsRedrawNeeded() && pacer.IsFrameDue();
+        if (rendering)
+        {
+            Render(*mpRenderContext, pacer.GetPartialUpdatePercentage());
+            mIsRedrawForced = false;
+            mLastFrameGLStats = GLplus::FrameStats::EndFrame();
+        }
+        pacer.EndFrame(rendering);
+
+        if (mOptions.PrintFrameStats && pacer.GetStats().ElapsedSeconds >= 1.0)
+        {
+            PrintFrameStats(pacer.GetStats());
+            pacer.ResetStats();
+        }
+
+        PROFILE_ZONE("Wait");
+        pacer.WaitForNextFrame(!IsRedrawNeeded());
     }
 
     MainLoopEnd:;
+
+    if (!mOptions.TraceFile.empty())
+    {
+        WriteTrace(mOptions.TraceFile);
+    }
+}
+
+void GameContext::WriteTrace(const std::string& filename) const
+{
+    size_t numZones = Profiler::WriteChromeTrace(filename.c_str());
+    printf("Wrote %zu profiler zones to %s%s\n", numZones, filename.c_str(),
+           PROFILER_ENABLED ? "" : " (profiler compiled out)");
+    fflush(stdout);
+}
+
+bool GameContext::IsRedrawNeeded() const
+{
+    return !mOptions.Pacing.IdleWhenUnchanged || mIsRedrawForced
+        || (mpCurrentScene && mpCurrentScene->IsRedrawNeeded());
+}
+
+void GameContext::PrintFrameStats(const FrameTimeStats& stats) const
+{
+    printf("%5.1f fps, %6.2f ms max frame, %5.1f%% busy, %zu idle frames, %zu updates (%zu dropped)\n",
+           stats.FramesRendered / stats.ElapsedSeconds,
+           stats.MaxFrameSeconds * 1000.0,
+           100.0 * stats.BusySeconds / stats.ElapsedSeconds,
+           stats.FramesSkipped,
+           stats.UpdatesRun, stats.UpdatesDropped);
+    if (mLastFrameGLStats.IsCollected)
+    {
+        printf("  last frame: %zu GL calls, %zu draws, %zu binds, %zu queries, %zu buffer bytes uploaded\n",
+               mLastFrameGLStats.Calls, mLastFrameGLStats.DrawCalls, mLastFrameGLStats.Binds,
+               mLastFrameGLStats.Queries, mLastFrameGLStats.BufferBytesUploaded);
+    }
+    fflush(stdout);
+}
+
+void GameContext::HeadlessMainLoop()
+{
+    // No rendering or real time here: every frame is a single fixed-size update, run back to back.
+    Uint64 startCount = SDL_GetPerformanceCounter();
+
+    for (unsigned int frame = 0; frame < mOptions.Frames; frame++)
+    {
+        PROFILE_FRAME();
+        Update(mMillisecondsPerUpdate);
+    }
+
+    Uint64 endCount = SDL_GetPerformanceCounter();
+    double elapsedSeconds = (double) (endCount - startCount) / SDL_GetPerformanceFrequency();
+
+    mpHeadlessScene->PrintReport(elapsedSeconds);
 }
 
 bool GameContext::HandleEvent(const SDL_Event& event)
@@ -75,6 +321,8 @@ bool GameContext::HandleEvent(const SDL_Event& event)
 
 void GameContext::Update(unsigned int deltaTimeMS)
 {
+    PROFILE_ZONE("Update");
+
     if (mpCurrentScene)
     {
         mpCurrentScene->Update(deltaTimeMS);
@@ -83,6 +331,8 @@ void GameContext::Update(unsigned int deltaTimeMS)
 
 void GameContext::Render(RenderContext& renderContext, float partialUpdatePercentage)
 {
+    PROFILE_ZONE("Render");
+
     glClearColor(1.0f,1.0f,1.0f,1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     GLplus::CheckGLErrors();
@@ -93,4 +343,5 @@ void GameContext::Render(RenderContext& renderContext, float partialUpdatePercen
     }
 
     mpWindow->SwapBuffers();
+    GLplus::CheckFrameErrors();
 }
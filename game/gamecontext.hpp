@@ -6,24 +6,74 @@
 
 #include "rendercontext.hpp"
 #include "scene.hpp"
+#include "framepacer.hpp"
+
+#include <string>
+
+class HeadlessScene;
+
+struct GameOptions
+{
+    // run the board logic only, with no window or GL context
+    bool Headless = false;
+
+    // play on an unbounded board instead of a fixed 10x10 one
+    bool Infinite = false;
+
+    int BoardWidth = 10;
+    int BoardHeight = 10;
+    int MineCount = 10;
+    unsigned int Seed = 0;
+
+    FramePacerOptions Pacing;
+
+    // print frame time and GL call statistics every second
+    bool PrintFrameStats = false;
+
+    // profiler zones are written here on exit, if set, and on F12 (to trace.json if not set)
+    std::string TraceFile;
+
+    // GLplus::ErrorCheckModeFromString names, empty for the build's default
+    std::string GLErrorCheckMode;
+
+    // headless only
+    unsigned int Frames = 600;
+    int ClicksPerFrame = 1;
+    std::string ScriptFile;
+};
 
 class GameContext
 {
+    GameOptions mOptions;
+
     std::unique_ptr<SDL2plus::LibSDL> mpSDL;
     std::unique_ptr<SDL2plus::WindowGL> mpWindow;
     std::shared_ptr<GLplus::FrameBuffer> mpWindowFrameBuffer;
     std::unique_ptr<RenderContext> mpRenderContext;
 
     std::unique_ptr<Scene> mpCurrentScene;
+    HeadlessScene* mpHeadlessScene = nullptr;
 
     Uint32 mMillisecondsPerUpdate;
 
+    // set by window events, since the scene can't know its window was exposed or resized.
+    bool mIsRedrawForced = true;
+
+    // GLplus calls of the last rendered frame, for --frame-stats
+    GLplus::FrameStats mLastFrameGLStats;
+
 public:
     GameContext(int argc, char* argv[]);
 
     void MainLoop();
 
 private:
+    void HeadlessMainLoop();
+
+    bool IsRedrawNeeded() const;
+    void PrintFrameStats(const FrameTimeStats& stats) const;
+    void WriteTrace(const std::string& filename) const;
+
     bool HandleEvent(const SDL_Event& event);
 
     void Update(unsigned int deltaTimeMS);
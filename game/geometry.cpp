@@ -1,5 +1,26 @@
 #include "geometry.hpp"
 
+#include <stdexcept>
+#include <climits>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GEOMETRY_SSE2
+#endif
+
+BillboardBasis ComputeBillboardBasis(glm::vec3 cameraView, glm::vec3 cameraUp)
+{
+    glm::vec3 unitView = glm::normalize(cameraView);
+
+    BillboardBasis basis;
+    basis.Side = glm::cross(unitView, glm::normalize(cameraUp));
+    basis.Up = glm::cross(basis.Side, unitView);
+    return basis;
+}
+
 bool RayParallelogramIntersect(glm::vec3 origin, glm::vec3 direction,
                                glm::vec3 corner, glm::vec3 across, glm::vec3 upward,
                                float& t)
@@ -28,3 +49,289 @@ bool RayParallelogramIntersect(glm::vec3 origin, glm::vec3 direction,
     t = tt;
     return true;
 }
+
+void ParallelogramBatch::Clear()
+{
+    mCount = 0;
+
+    for (std::vector<float>* pArray : { &mCornerX, &mCornerY, &mCornerZ,
+                                        &mNormalX, &mNormalY, &mNormalZ,
+                                        &mAcrossX, &mAcrossY, &mAcrossZ,
+                                        &mUpwardX, &mUpwardY, &mUpwardZ })
+    {
+        pArray->clear();
+    }
+}
+
+void ParallelogramBatch::Reserve(size_t count)
+{
+    for (std::vector<float>* pArray : { &mCornerX, &mCornerY, &mCornerZ,
+                                        &mNormalX, &mNormalY, &mNormalZ,
+                                        &mAcrossX, &mAcrossY, &mAcrossZ,
+                                        &mUpwardX, &mUpwardY, &mUpwardZ })
+    {
+        pArray->reserve(count + kPadding);
+    }
+}
+
+size_t ParallelogramBatch::Add(glm::vec3 corner, glm::vec3 across, glm::vec3 upward)
+{
+    // the SIMD paths keep indices in 32 bit lanes
+    if (mCount >= INT_MAX - kPadding)
+    {
+        throw std::length_error("Too many parallelograms in batch");
+    }
+
+    glm::vec3 n = glm::cross(across, upward);
+    glm::vec3 scaledAcross = across / glm::dot(across, across);
+    glm::vec3 scaledUpward = upward / glm::dot(upward, upward);
+
+    // grow a whole SIMD block at a time. The padding has a zero normal,
+    // so the ray is always parallel to it.
+    if (mCount % kPadding == 0)
+    {
+        for (std::vector<float>* pArray : { &mCornerX, &mCornerY, &mCornerZ,
+                                            &mNormalX, &mNormalY, &mNormalZ,
+                                            &mAcrossX, &mAcrossY, &mAcrossZ,
+                                            &mUpwardX, &mUpwardY, &mUpwardZ })
+        {
+            pArray->resize(mCount + kPadding, 0.0f);
+        }
+    }
+
+    mCornerX[mCount] = corner.x; mCornerY[mCount] = corner.y; mCornerZ[mCount] = corner.z;
+    mNormalX[mCount] = n.x; mNormalY[mCount] = n.y; mNormalZ[mCount] = n.z;
+    mAcrossX[mCount] = scaledAcross.x; mAcrossY[mCount] = scaledAcross.y; mAcrossZ[mCount] = scaledAcross.z;
+    mUpwardX[mCount] = scaledUpward.x; mUpwardY[mCount] = scaledUpward.y; mUpwardZ[mCount] = scaledUpward.z;
+
+    return mCount++;
+}
+
+size_t RayParallelogramBatchIntersectScalar(glm::vec3 origin, glm::vec3 direction,
+                                            const ParallelogramBatch& batch,
+                                            float& t)
+{
+    size_t closest = kNoParallelogram;
+    float closestT = INFINITY;
+
+    for (size_t i = 0; i < batch.mCount; i++)
+    {
+        glm::vec3 n(batch.mNormalX[i], batch.mNormalY[i], batch.mNormalZ[i]);
+        glm::vec3 corner(batch.mCornerX[i], batch.mCornerY[i], batch.mCornerZ[i]);
+
+        float denom = glm::dot(direction, n);
+        if (glm::abs(denom) < 1e-6f) continue;
+
+        float tt = glm::dot(corner - origin, n) / denom;
+        if (!(tt >= 0.0f && tt < closestT)) continue;
+
+        glm::vec3 offset = origin + tt * direction - corner;
+
+        float u = glm::dot(glm::vec3(batch.mAcrossX[i], batch.mAcrossY[i], batch.mAcrossZ[i]), offset);
+        if (u < 0 || u > 1) continue;
+
+        float v = glm::dot(glm::vec3(batch.mUpwardX[i], batch.mUpwardY[i], batch.mUpwardZ[i]), offset);
+        if (v < 0 || v > 1) continue;
+
+        closest = i;
+        closestT = tt;
+    }
+
+    if (closest != kNoParallelogram)
+    {
+        t = closestT;
+    }
+    return closest;
+}
+
+#if defined(__AVX__)
+
+size_t RayParallelogramBatchIntersect(glm::vec3 origin, glm::vec3 direction,
+                                      const ParallelogramBatch& batch,
+                                      float& t)
+{
+    const __m256 ox = _mm256_set1_ps(origin.x), oy = _mm256_set1_ps(origin.y), oz = _mm256_set1_ps(origin.z);
+    const __m256 dx = _mm256_set1_ps(direction.x), dy = _mm256_set1_ps(direction.y), dz = _mm256_set1_ps(direction.z);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 epsilon = _mm256_set1_ps(1e-6f);
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+
+    // per lane: nearest t so far, and the index it came from (as int bits)
+    __m256 bestT = _mm256_set1_ps(INFINITY);
+    __m256 bestIndex = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+    for (size_t i = 0; i < batch.mCount; i += 8)
+    {
+        __m256 nx = _mm256_loadu_ps(&batch.mNormalX[i]);
+        __m256 ny = _mm256_loadu_ps(&batch.mNormalY[i]);
+        __m256 nz = _mm256_loadu_ps(&batch.mNormalZ[i]);
+
+        __m256 denom = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, nx), _mm256_mul_ps(dy, ny)), _mm256_mul_ps(dz, nz));
+
+        __m256 cx = _mm256_sub_ps(_mm256_loadu_ps(&batch.mCornerX[i]), ox);
+        __m256 cy = _mm256_sub_ps(_mm256_loadu_ps(&batch.mCornerY[i]), oy);
+        __m256 cz = _mm256_sub_ps(_mm256_loadu_ps(&batch.mCornerZ[i]), oz);
+
+        __m256 numer = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, nx), _mm256_mul_ps(cy, ny)), _mm256_mul_ps(cz, nz));
+        __m256 tt = _mm256_div_ps(numer, denom);
+
+        // offset from the corner to the hit point
+        __m256 hx = _mm256_sub_ps(_mm256_mul_ps(tt, dx), cx);
+        __m256 hy = _mm256_sub_ps(_mm256_mul_ps(tt, dy), cy);
+        __m256 hz = _mm256_sub_ps(_mm256_mul_ps(tt, dz), cz);
+
+        __m256 u = _mm256_add_ps(_mm256_add_ps(
+                       _mm256_mul_ps(hx, _mm256_loadu_ps(&batch.mAcrossX[i])),
+                       _mm256_mul_ps(hy, _mm256_loadu_ps(&batch.mAcrossY[i]))),
+                       _mm256_mul_ps(hz, _mm256_loadu_ps(&batch.mAcrossZ[i])));
+        __m256 v = _mm256_add_ps(_mm256_add_ps(
+                       _mm256_mul_ps(hx, _mm256_loadu_ps(&batch.mUpwardX[i])),
+                       _mm256_mul_ps(hy, _mm256_loadu_ps(&batch.mUpwardY[i]))),
+                       _mm256_mul_ps(hz, _mm256_loadu_ps(&batch.mUpwardZ[i])));
+
+        // ordered compares are false for the NaNs of the padding, so it never hits.
+        __m256 hit = _mm256_cmp_ps(_mm256_and_ps(denom, absMask), epsilon, _CMP_GE_OQ);
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(tt, zero, _CMP_GE_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(tt, bestT, _CMP_LT_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(u, one, _CMP_LE_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(v, one, _CMP_LE_OQ));
+
+        if (_mm256_movemask_ps(hit))
+        {
+            int first = (int) i;
+            __m256 index = _mm256_castsi256_ps(_mm256_setr_epi32(first, first + 1, first + 2, first + 3,
+                                                                 first + 4, first + 5, first + 6, first + 7));
+            bestT = _mm256_blendv_ps(bestT, tt, hit);
+            bestIndex = _mm256_blendv_ps(bestIndex, index, hit);
+        }
+    }
+
+    alignas(32) float laneT[8];
+    alignas(32) int laneIndex[8];
+    _mm256_store_ps(laneT, bestT);
+    _mm256_store_ps((float*) laneIndex, bestIndex);
+
+    size_t closest = kNoParallelogram;
+    float closestT = INFINITY;
+    for (int lane = 0; lane < 8; lane++)
+    {
+        // ties go to the lower index, like the scalar loop
+        if (laneIndex[lane] >= 0 && (laneT[lane] < closestT ||
+                                     (laneT[lane] == closestT && (size_t) laneIndex[lane] < closest)))
+        {
+            closest = laneIndex[lane];
+            closestT = laneT[lane];
+        }
+    }
+
+    if (closest != kNoParallelogram)
+    {
+        t = closestT;
+    }
+    return closest;
+}
+
+#elif defined(GEOMETRY_SSE2)
+
+// SSE2 has no blendv
+static inline __m128 Select(__m128 mask, __m128 ifTrue, __m128 ifFalse)
+{
+    return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+}
+
+size_t RayParallelogramBatchIntersect(glm::vec3 origin, glm::vec3 direction,
+                                      const ParallelogramBatch& batch,
+                                      float& t)
+{
+    const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+    const __m128 dx = _mm_set1_ps(direction.x), dy = _mm_set1_ps(direction.y), dz = _mm_set1_ps(direction.z);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 epsilon = _mm_set1_ps(1e-6f);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+    __m128 bestT = _mm_set1_ps(INFINITY);
+    __m128 bestIndex = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+    for (size_t i = 0; i < batch.mCount; i += 4)
+    {
+        __m128 nx = _mm_loadu_ps(&batch.mNormalX[i]);
+        __m128 ny = _mm_loadu_ps(&batch.mNormalY[i]);
+        __m128 nz = _mm_loadu_ps(&batch.mNormalZ[i]);
+
+        __m128 denom = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, nx), _mm_mul_ps(dy, ny)), _mm_mul_ps(dz, nz));
+
+        __m128 cx = _mm_sub_ps(_mm_loadu_ps(&batch.mCornerX[i]), ox);
+        __m128 cy = _mm_sub_ps(_mm_loadu_ps(&batch.mCornerY[i]), oy);
+        __m128 cz = _mm_sub_ps(_mm_loadu_ps(&batch.mCornerZ[i]), oz);
+
+        __m128 numer = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, nx), _mm_mul_ps(cy, ny)), _mm_mul_ps(cz, nz));
+        __m128 tt = _mm_div_ps(numer, denom);
+
+        __m128 hx = _mm_sub_ps(_mm_mul_ps(tt, dx), cx);
+        __m128 hy = _mm_sub_ps(_mm_mul_ps(tt, dy), cy);
+        __m128 hz = _mm_sub_ps(_mm_mul_ps(tt, dz), cz);
+
+        __m128 u = _mm_add_ps(_mm_add_ps(
+                       _mm_mul_ps(hx, _mm_loadu_ps(&batch.mAcrossX[i])),
+                       _mm_mul_ps(hy, _mm_loadu_ps(&batch.mAcrossY[i]))),
+                       _mm_mul_ps(hz, _mm_loadu_ps(&batch.mAcrossZ[i])));
+        __m128 v = _mm_add_ps(_mm_add_ps(
+                       _mm_mul_ps(hx, _mm_loadu_ps(&batch.mUpwardX[i])),
+                       _mm_mul_ps(hy, _mm_loadu_ps(&batch.mUpwardY[i]))),
+                       _mm_mul_ps(hz, _mm_loadu_ps(&batch.mUpwardZ[i])));
+
+        __m128 hit = _mm_cmpge_ps(_mm_and_ps(denom, absMask), epsilon);
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(tt, zero));
+        hit = _mm_and_ps(hit, _mm_cmplt_ps(tt, bestT));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(u, one));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(v, one));
+
+        if (_mm_movemask_ps(hit))
+        {
+            int first = (int) i;
+            __m128 index = _mm_castsi128_ps(_mm_setr_epi32(first, first + 1, first + 2, first + 3));
+            bestT = Select(hit, tt, bestT);
+            bestIndex = Select(hit, index, bestIndex);
+        }
+    }
+
+    alignas(16) float laneT[4];
+    alignas(16) int laneIndex[4];
+    _mm_store_ps(laneT, bestT);
+    _mm_store_ps((float*) laneIndex, bestIndex);
+
+    size_t closest = kNoParallelogram;
+    float closestT = INFINITY;
+    for (int lane = 0; lane < 4; lane++)
+    {
+        if (laneIndex[lane] >= 0 && (laneT[lane] < closestT ||
+                                     (laneT[lane] == closestT && (size_t) laneIndex[lane] < closest)))
+        {
+            closest = laneIndex[lane];
+            closestT = laneT[lane];
+        }
+    }
+
+    if (closest != kNoParallelogram)
+    {
+        t = closestT;
+    }
+    return closest;
+}
+
+#else
+
+size_t RayParallelogramBatchIntersect(glm::vec3 origin, glm::vec3 direction,
+                                      const ParallelogramBatch& batch,
+                                      float& t)
+{
+    return RayParallelogramBatchIntersectScalar(origin, direction, batch, t);
+}
+
+#endif
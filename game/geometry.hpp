@@ -3,8 +3,64 @@
 
 #include <glm/glm.hpp>
 
+#include <vector>
+#include <cstddef>
+
+// Plane every billboard lies in, for a camera looking along view with the given up.
+// Same for all billboards, so it is worked out once per frame.
+// Side and up are only unit length when looking level, and billboards shrink with them.
+struct BillboardBasis
+{
+    glm::vec3 Side;
+    glm::vec3 Up;
+};
+
+BillboardBasis ComputeBillboardBasis(glm::vec3 cameraView, glm::vec3 cameraUp);
+
 bool RayParallelogramIntersect(glm::vec3 origin, glm::vec3 direction,
                                glm::vec3 corner, glm::vec3 across, glm::vec3 upward,
                                float& t);
 
+// Parallelograms kept as structure-of-arrays, so one ray can be tested against
+// several of them at once. Add() precomputes what RayParallelogramIntersect works out
+// on every call (normal, scaled edges), and the arrays are padded with parallelograms
+// that can't be hit up to the widest SIMD width.
+class ParallelogramBatch
+{
+    friend size_t RayParallelogramBatchIntersect(glm::vec3, glm::vec3, const ParallelogramBatch&, float&);
+    friend size_t RayParallelogramBatchIntersectScalar(glm::vec3, glm::vec3, const ParallelogramBatch&, float&);
+
+    size_t mCount = 0;
+
+    std::vector<float> mCornerX, mCornerY, mCornerZ;
+    std::vector<float> mNormalX, mNormalY, mNormalZ;
+    // edges divided by their squared length, so a dot product gives the fraction along them.
+    std::vector<float> mAcrossX, mAcrossY, mAcrossZ;
+    std::vector<float> mUpwardX, mUpwardY, mUpwardZ;
+
+public:
+    static const size_t kPadding = 8;
+
+    void Clear();
+    void Reserve(size_t count);
+
+    // Same arguments as RayParallelogramIntersect. Returns the parallelogram's index.
+    size_t Add(glm::vec3 corner, glm::vec3 across, glm::vec3 upward);
+
+    size_t GetCount() const { return mCount; }
+};
+
+static const size_t kNoParallelogram = (size_t) -1;
+
+// Nearest parallelogram of the batch hit by the ray, or kNoParallelogram.
+// Hits behind the origin are ignored. Uses AVX or SSE when the build targets them.
+size_t RayParallelogramBatchIntersect(glm::vec3 origin, glm::vec3 direction,
+                                      const ParallelogramBatch& batch,
+                                      float& t);
+
+// Same as above one parallelogram at a time, for targets without SIMD and for checking.
+size_t RayParallelogramBatchIntersectScalar(glm::vec3 origin, glm::vec3 direction,
+                                            const ParallelogramBatch& batch,
+                                            float& t);
+
 #endif // GEOMETRY_HPP
@@ -0,0 +1,155 @@
+#include "headlessscene.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstdio>
+
+HeadlessScene::HeadlessScene(int width, int height, int mineCount, unsigned int seed, int clicksPerFrame)
+    : mBoard(width, height, mineCount, seed)
+    , mClickEngine(seed ^ 0x9E3779B9u)
+    , mClicksPerFrame(clicksPerFrame)
+{ }
+
+void HeadlessScene::LoadScript(const char* filename)
+{
+    std::ifstream scriptFile(filename);
+    if (!scriptFile)
+    {
+        throw std::runtime_error("Couldn't open click script");
+    }
+
+    const Minefield& minefield = mBoard.GetMinefield();
+
+    std::vector<ScriptedClick> script;
+    std::string line;
+    while (std::getline(scriptFile, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream lineStream(line);
+        ScriptedClick click;
+        if (!(lineStream >> click.Frame >> click.X >> click.Y))
+        {
+            throw std::runtime_error("Malformed click script line: " + line);
+        }
+
+        if (click.X < 0 || click.X >= minefield.GetWidth() ||
+            click.Y < 0 || click.Y >= minefield.GetHeight())
+        {
+            throw std::out_of_range("Scripted click outside of board: " + line);
+        }
+
+        script.push_back(click);
+    }
+
+    std::stable_sort(script.begin(), script.end(),
+                     [](const ScriptedClick& a, const ScriptedClick& b) { return a.Frame < b.Frame; });
+
+    mScript = std::move(script);
+    mNextScriptedClick = 0;
+}
+
+size_t HeadlessScene::PickRandomMound()
+{
+    const Minefield& minefield = mBoard.GetMinefield();
+    std::uniform_int_distribution<size_t> uniformDist(0, minefield.GetCellCount() - 1);
+
+    // walk forward from a random mound to the next one that can still be clicked
+    size_t start = uniformDist(mClickEngine);
+    for (size_t i = 0; i < minefield.GetCellCount(); i++)
+    {
+        size_t candidate = (start + i) % minefield.GetCellCount();
+        if (minefield.GetState(candidate) == MoundState::Untouched)
+        {
+            return candidate;
+        }
+    }
+
+    return start;
+}
+
+void HeadlessScene::Click(size_t cellIndex)
+{
+    auto clickStart = std::chrono::steady_clock::now();
+    RevealResult result = mBoard.Click(cellIndex, mChangedCells);
+    auto clickEnd = std::chrono::steady_clock::now();
+
+    mClickLatencies.push_back(std::chrono::duration<double, std::micro>(clickEnd - clickStart).count());
+
+    if (result == RevealResult::HitMine)
+    {
+        mBoardsLost++;
+        mBoard.Reset();
+    }
+    else if (result == RevealResult::Revealed && mBoard.IsCleared())
+    {
+        mBoardsWon++;
+        mBoard.Reset();
+    }
+}
+
+bool HeadlessScene::HandleEvent(const SDL_Event& event)
+{
+    return false;
+}
+
+void HeadlessScene::Update(unsigned int deltaTimeMS)
+{
+    if (!mScript.empty())
+    {
+        int width = mBoard.GetMinefield().GetWidth();
+        while (mNextScriptedClick < mScript.size() && mScript[mNextScriptedClick].Frame <= mFrame)
+        {
+            const ScriptedClick& click = mScript[mNextScriptedClick];
+            Click((size_t) click.Y * width + click.X);
+            mNextScriptedClick++;
+        }
+    }
+    else
+    {
+        for (int i = 0; i < mClicksPerFrame; i++)
+        {
+            Click(PickRandomMound());
+        }
+    }
+
+    mFrame++;
+}
+
+void HeadlessScene::Render(RenderContext& renderContext, float partialUpdatePercentage)
+{
+}
+
+static double Percentile(const std::vector<double>& sorted, double percent)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+
+    size_t rank = (size_t) (percent / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[rank];
+}
+
+void HeadlessScene::PrintReport(double elapsedSeconds) const
+{
+    std::vector<double> latencies = mClickLatencies;
+    std::sort(latencies.begin(), latencies.end());
+
+    size_t boards = mBoardsWon + mBoardsLost;
+
+    printf("frames: %u, clicks: %zu\n", mFrame, latencies.size());
+    printf("boards: %zu (won %zu, lost %zu)\n", boards, mBoardsWon, mBoardsLost);
+    printf("elapsed: %.6f s, %.1f boards/s\n",
+           elapsedSeconds, elapsedSeconds > 0.0 ? boards / elapsedSeconds : 0.0);
+    printf("click latency (us): p50 %.3f, p90 %.3f, p99 %.3f, max %.3f\n",
+           Percentile(latencies, 50.0), Percentile(latencies, 90.0),
+           Percentile(latencies, 99.0), latencies.empty() ? 0.0 : latencies.back());
+    fflush(stdout);
+}
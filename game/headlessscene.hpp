@@ -0,0 +1,56 @@
+#ifndef HEADLESSSCENE_HPP
+#define HEADLESSSCENE_HPP
+
+#include "scene.hpp"
+#include "board.hpp"
+
+#include <random>
+#include <vector>
+
+struct ScriptedClick
+{
+    unsigned int Frame;
+    int X;
+    int Y;
+};
+
+// Plays the board with no window or GL context.
+// Clicks come from a script if one is loaded, otherwise from a seeded random generator.
+// Used to benchmark the board logic on machines without a display.
+class HeadlessScene : public Scene
+{
+    Board mBoard;
+
+    std::vector<ScriptedClick> mScript;
+    size_t mNextScriptedClick = 0;
+
+    std::default_random_engine mClickEngine;
+    int mClicksPerFrame;
+
+    unsigned int mFrame = 0;
+
+    std::vector<uint32_t> mChangedCells;
+
+    size_t mBoardsWon = 0;
+    size_t mBoardsLost = 0;
+
+    // microseconds spent in each Board::Click
+    std::vector<double> mClickLatencies;
+
+    void Click(size_t cellIndex);
+    size_t PickRandomMound();
+
+public:
+    HeadlessScene(int width, int height, int mineCount, unsigned int seed, int clicksPerFrame);
+
+    // Script files hold one click per line: "<frame> <x> <y>". Lines starting with # are ignored.
+    void LoadScript(const char* filename);
+
+    bool HandleEvent(const SDL_Event& event) override;
+    void Update(unsigned int deltaTimeMS) override;
+    void Render(RenderContext& renderContext, float partialUpdatePercentage) override;
+
+    void PrintReport(double elapsedSeconds) const;
+};
+
+#endif // HEADLESSSCENE_HPP
@@ -1,4 +1,5 @@
 #include "gamecontext.hpp"
+#include <cstdio>
 
 int main(int argc, char* argv[])
 {
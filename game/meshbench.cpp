@@ -0,0 +1,281 @@
+// Mesh loading benchmark: parses an OBJ with tinyobj, then runs GLmesh's load-time stages
+// on each shape and reports what they cost and what they gain. Needs no window or GL.
+// Without --obj, it writes and loads a grid big enough to need 32 bit indices.
+// Then it compares loading the OBJ with loading the same meshes from a .glmesh file.
+
+#include <MeshData.hpp>
+#include <MeshFile.hpp>
+#include <MeshOptimizer.hpp>
+#include <MeshSimplifier.hpp>
+#include <VertexFormat.hpp>
+
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct MeshBenchOptions
+{
+    std::string ObjFile;
+    std::string MeshFile = "meshbench.glmesh";
+    int GridSize = 512;
+    size_t CacheSize = 16;
+};
+
+static const char* kUsage =
+    "usage: game_meshbench [options]\n"
+    "  --obj <file>      OBJ file to load. Without one, a generated grid is loaded.\n"
+    "  --grid <N>        the generated grid is N x N quads\n"
+    "  --cache <N>       FIFO size the ACMR is measured with\n"
+    "  --glmesh <file>   where to write the .glmesh file to compare with. It's removed afterwards.\n";
+
+static MeshBenchOptions ParseMeshBenchOptions(int argc, char* argv[])
+{
+    MeshBenchOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        auto nextValue = [&]() -> const char* {
+            if (i + 1 >= argc)
+            {
+                throw std::runtime_error(std::string("Missing value for ") + arg);
+            }
+            return argv[++i];
+        };
+
+        if (!strcmp(arg, "--obj"))
+        {
+            options.ObjFile = nextValue();
+        }
+        else if (!strcmp(arg, "--grid"))
+        {
+            options.GridSize = std::max(std::stoi(nextValue()), 1);
+        }
+        else if (!strcmp(arg, "--glmesh"))
+        {
+            options.MeshFile = nextValue();
+        }
+        else if (!strcmp(arg, "--cache"))
+        {
+            options.CacheSize = std::max<size_t>(std::stoull(nextValue()), 3);
+        }
+        else if (!strcmp(arg, "--help"))
+        {
+            printf("%s", kUsage);
+            exit(0);
+        }
+        else
+        {
+            fprintf(stderr, "%s", kUsage);
+            throw std::runtime_error(std::string("Unknown argument: ") + arg);
+        }
+    }
+
+    return options;
+}
+
+// An n x n grid of quads over rolling hills, in rows, the way modelling tools tend to export them.
+static void WriteGridObj(const char* filename, int n)
+{
+    std::ofstream out(filename);
+    if (!out)
+    {
+        throw std::runtime_error(std::string("Failed to open ") + filename + " for writing");
+    }
+
+    for (int z = 0; z <= n; z++)
+    {
+        for (int x = 0; x <= n; x++)
+        {
+            float height = 4.0f * std::sin(x * 0.05f) * std::cos(z * 0.07f);
+            out << "v " << x << " " << height << " " << z << "\n";
+            out << "vt " << (float) x / n << " " << (float) z / n << "\n";
+            out << "vn 0 1 0\n";
+        }
+    }
+
+    for (int z = 0; z < n; z++)
+    {
+        for (int x = 0; x < n; x++)
+        {
+            int corners[4] = {
+                z * (n + 1) + x + 1,
+                z * (n + 1) + x + 2,
+                (z + 1) * (n + 1) + x + 2,
+                (z + 1) * (n + 1) + x + 1
+            };
+            out << "f";
+            for (int corner : corners)
+            {
+                out << " " << corner << "/" << corner << "/" << corner;
+            }
+            out << "\n";
+        }
+    }
+
+    if (!out)
+    {
+        throw std::runtime_error(std::string("Failed to write ") + filename);
+    }
+}
+
+// reads every byte, as uploading it would
+static uint64_t SumWords(const void* data, size_t bytes)
+{
+    const unsigned char* bytePointer = (const unsigned char*) data;
+    uint64_t sum = 0;
+    for (size_t i = 0; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, bytePointer + i, sizeof(word));
+        sum += word;
+    }
+    return sum;
+}
+
+static volatile uint64_t gSink;
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        MeshBenchOptions options = ParseMeshBenchOptions(argc, argv);
+
+        std::string objFile = options.ObjFile;
+        bool isGenerated = objFile.empty();
+        if (isGenerated)
+        {
+            objFile = "meshbench_grid.obj";
+            WriteGridObj(objFile.c_str(), options.GridSize);
+        }
+
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        auto parseStart = std::chrono::steady_clock::now();
+        tinyobj::LoadObj(shapes, materials, objFile.c_str(), NULL, 0);
+        double parseMillis = MillisecondsSince(parseStart);
+
+        if (isGenerated)
+        {
+            remove(objFile.c_str());
+        }
+
+        printf("%s: %zu shapes, parsed in %.1f ms\n", objFile.c_str(), shapes.size(), parseMillis);
+
+        for (const tinyobj::shape_t& shape : shapes)
+        {
+            const tinyobj::mesh_t& mesh = shape.mesh;
+            size_t vertexCount = mesh.positions.size() / 3;
+            size_t triangleCount = mesh.indices.size() / 3;
+
+            printf("\nshape \"%s\": %zu vertices, %zu triangles\n", shape.name.c_str(), vertexCount, triangleCount);
+
+            auto interleaveStart = std::chrono::steady_clock::now();
+            GLmesh::InterleavedVertices vertices = GLmesh::InterleaveVertices(
+                        mesh.positions, mesh.normals, mesh.texcoords, GLmesh::VertexFormat());
+            double interleaveMillis = MillisecondsSince(interleaveStart);
+
+            std::vector<uint32_t> indices(mesh.indices.begin(), mesh.indices.end());
+
+            auto cacheStart = std::chrono::steady_clock::now();
+            std::vector<uint32_t> optimized = GLmesh::OptimizeVertexCache(indices, vertexCount);
+            double cacheMillis = MillisecondsSince(cacheStart);
+
+            auto fetchStart = std::chrono::steady_clock::now();
+            std::vector<uint32_t> order = GLmesh::OptimizeVertexFetch(optimized, vertexCount);
+            std::vector<unsigned char> remapped = GLmesh::RemapVertices(vertices.Data, vertices.Layout.Stride, order);
+            double fetchMillis = MillisecondsSince(fetchStart);
+
+            GLenum indexType = GLmesh::ChooseIndexType(order.size());
+            std::vector<unsigned char> packed = GLmesh::PackIndices(optimized, indexType);
+
+            size_t floatVertexBytes = (mesh.positions.size() + mesh.normals.size() + mesh.texcoords.size()) * sizeof(float);
+
+            printf("%-28s %10s %10s\n", "", "before", "after");
+            printf("%-28s %10.3f %10.3f\n", ("ACMR, FIFO of " + std::to_string(options.CacheSize)).c_str(),
+                   GLmesh::ComputeACMR(indices, vertexCount, options.CacheSize),
+                   GLmesh::ComputeACMR(optimized, order.size(), options.CacheSize));
+            printf("%-28s %10.3f %10.3f\n", "ACMR, FIFO of 32",
+                   GLmesh::ComputeACMR(indices, vertexCount, 32),
+                   GLmesh::ComputeACMR(optimized, order.size(), 32));
+            printf("%-28s %10zu %10zu\n", "index bytes", indices.size() * sizeof(uint32_t), packed.size());
+            printf("%-28s %10zu %10zu\n", "vertex bytes", floatVertexBytes, remapped.size());
+            printf("%-28s %10s %10s\n", "index type", "uint", indexType == GL_UNSIGNED_SHORT ? "ushort" : "uint");
+
+            printf("%-28s %10.2f\n", "interleave ms", interleaveMillis);
+            printf("%-28s %10.2f\n", "vertex cache order ms", cacheMillis);
+            printf("%-28s %10.2f\n", "vertex fetch order ms", fetchMillis);
+
+            auto lodStart = std::chrono::steady_clock::now();
+            std::vector<GLmesh::MeshLevel> levels = GLmesh::BuildLevelsOfDetail(indices, mesh.positions);
+            double lodMillis = MillisecondsSince(lodStart);
+
+            printf("%-28s %10.2f\n", "levels of detail ms", lodMillis);
+            printf("%-28s %10s %10s\n", "level", "triangles", "error");
+            for (size_t level = 0; level < levels.size(); level++)
+            {
+                printf("%-28zu %10zu %10.4f\n", level, levels[level].Indices.size() / 3, levels[level].Error);
+            }
+        }
+
+        // what StaticMesh::LoadShape does to every shape, done once ahead of time by obj_to_glmesh
+        auto buildStart = std::chrono::steady_clock::now();
+        std::vector<GLmesh::MeshData> meshes;
+        std::vector<GLmesh::MeshDataView> views;
+        meshes.reserve(shapes.size());
+        for (const tinyobj::shape_t& shape : shapes)
+        {
+            meshes.push_back(GLmesh::BuildMeshData(shape, materials));
+            views.push_back(meshes.back().GetView());
+        }
+        double buildMillis = MillisecondsSince(buildStart);
+
+        GLmesh::WriteMeshFile(options.MeshFile.c_str(), views);
+
+        auto mapStart = std::chrono::steady_clock::now();
+        size_t meshFileBytes;
+        {
+            GLmesh::MeshFile meshFile(options.MeshFile.c_str());
+            meshFileBytes = meshFile.GetFileSize();
+
+            uint64_t sum = 0;
+            for (size_t m = 0; m < meshFile.GetMeshCount(); m++)
+            {
+                const GLmesh::MeshDataView& view = meshFile.GetMesh(m);
+                sum += SumWords(view.pVertices, view.VertexBytes) + SumWords(view.pIndices, view.IndexBytes);
+            }
+            gSink = sum;
+        }
+        double mapMillis = MillisecondsSince(mapStart);
+
+        remove(options.MeshFile.c_str());
+
+        printf("\n%-28s %10s\n", "until ready to upload", "ms");
+        printf("%-28s %10.1f\n", "OBJ, parsed", parseMillis);
+        printf("%-28s %10.1f\n", "OBJ, parsed and built", parseMillis + buildMillis);
+        printf("%-28s %10.1f\n", ".glmesh, mapped and read", mapMillis);
+        printf("%-28s %10zu\n", ".glmesh bytes", meshFileBytes);
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Fatal exception: %s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,360 @@
+#include "minefield.hpp"
+#include "counterrandom.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+// cell byte layout: [0..3] adjacent mine count, [4] mine, [5..6] MoundState
+static const uint8_t kCountMask = 0x0F;
+static const uint8_t kMineBit = 0x10;
+static const int kStateShift = 5;
+static const uint8_t kStateMask = 0x60;
+
+Minefield::Minefield(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+    {
+        throw std::invalid_argument("Minefield dimensions must be positive");
+    }
+
+    if ((uint64_t) width * height > UINT32_MAX)
+    {
+        throw std::length_error("Minefield too large");
+    }
+
+    mWidth = width;
+    mHeight = height;
+    mCells.assign((size_t) width * height, 0);
+    mVisited.assign((mCells.size() + 63) / 64, 0);
+}
+
+void Minefield::Clear()
+{
+    std::fill(mCells.begin(), mCells.end(), 0);
+}
+
+void Minefield::PlaceMine(size_t cellIndex)
+{
+    if (cellIndex >= mCells.size()) throw std::out_of_range("cellIndex");
+
+    if (mCells[cellIndex] & kMineBit)
+    {
+        return;
+    }
+
+    mCells[cellIndex] |= kMineBit;
+
+    int cy = cellIndex / mWidth;
+    int cx = cellIndex - (size_t) cy * mWidth;
+
+    for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, mHeight - 1); y++)
+    {
+        for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, mWidth - 1); x++)
+        {
+            if (!(x == cx && y == cy))
+            {
+                mCells[(size_t) y * mWidth + x]++;
+            }
+        }
+    }
+}
+
+// Runs task(i) for every i in [0, count), spread over numThreads threads.
+template<class Task>
+static void ParallelFor(size_t count, unsigned int numThreads, Task task)
+{
+    if (numThreads <= 1 || count <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < numThreads; t++)
+    {
+        threads.emplace_back([=]() {
+            for (size_t i = t; i < count; i += numThreads)
+            {
+                task(i);
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+// Clears a stripe and samples its mines with Floyd's algorithm,
+// using the mine bits themselves as the membership set.
+static void SampleStripeMines(uint8_t* stripeData, size_t stripeCells, size_t mineCount, const CounterRandom& random)
+{
+    std::fill(stripeData, stripeData + stripeCells, 0);
+
+    for (size_t j = stripeCells - mineCount; j < stripeCells; j++)
+    {
+        size_t t = random.Below(j, (uint32_t) (j + 1));
+        stripeData[(stripeData[t] & kMineBit) ? j : t] |= kMineBit;
+    }
+}
+
+// Adjacent counts from the mine bits for rows [firstRow, lastRow), a row at a time. above and below
+// are the rows just outside them, null at the board's edges. columnSums has room for width + 2.
+// Column sums of three rows are built first, then summed across three columns.
+static void CountStripeMines(uint8_t* cells, int width, int firstRow, int lastRow,
+                             const uint8_t* aboveFirst, const uint8_t* belowLast, uint8_t* columnSums)
+{
+    columnSums[0] = 0;
+    columnSums[width + 1] = 0;
+
+    for (int y = firstRow; y < lastRow; y++)
+    {
+        const uint8_t* row = cells + (size_t) y * width;
+
+        const uint8_t* above = y == firstRow    ? aboveFirst : row - width;
+        const uint8_t* below = y == lastRow - 1 ? belowLast  : row + width;
+
+        for (int x = 0; x < width; x++)
+        {
+            columnSums[x + 1] = (uint8_t) (((row[x] & kMineBit) >> 4)
+                              + (above ? (above[x] & kMineBit) >> 4 : 0)
+                              + (below ? (below[x] & kMineBit) >> 4 : 0));
+        }
+
+        uint8_t* outRow = cells + (size_t) y * width;
+        for (int x = 0; x < width; x++)
+        {
+            int self = (outRow[x] & kMineBit) >> 4;
+            int count = columnSums[x] + columnSums[x + 1] + columnSums[x + 2] - self;
+            outRow[x] = (uint8_t) ((outRow[x] & kMineBit) | count);
+        }
+    }
+}
+
+void Minefield::GenerateMines(size_t mineCount, uint64_t seed, uint64_t boardId, unsigned int numThreads)
+{
+    // the stripe size is fixed so the layout doesn't depend on how many threads there are.
+    static const size_t kCellsPerStripe = 1 << 18;
+    static const size_t kCellsPerThread = 1 << 20;
+
+    // asking costs a few microseconds, a good part of a small game, so it's only asked once.
+    static const unsigned int kHardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    size_t numCells = mCells.size();
+    if (mineCount > numCells)
+    {
+        throw std::invalid_argument("mineCount");
+    }
+
+    int rowsPerStripe = (int) std::max<size_t>(kCellsPerStripe / mWidth, 1);
+    size_t numStripes = (mHeight + rowsPerStripe - 1) / rowsPerStripe;
+    size_t cellsPerStripe = (size_t) rowsPerStripe * mWidth;
+
+    CounterRandom boardRandom(seed, boardId);
+
+    uint8_t* cells = mCells.data();
+    int width = mWidth;
+    int height = mHeight;
+
+    // a lone stripe gets every mine, and has no other stripe's rows to read.
+    if (numStripes == 1)
+    {
+        mColumnSums.resize(width + 2);
+        SampleStripeMines(cells, numCells, mineCount, boardRandom.Substream(1));
+        CountStripeMines(cells, width, 0, height, nullptr, nullptr, mColumnSums.data());
+        return;
+    }
+
+    if (numThreads == 0)
+    {
+        numThreads = (unsigned int) std::min<size_t>(kHardwareThreads, numCells / kCellsPerThread + 1);
+    }
+
+    // Each stripe gets floor(mineCount * its share of the cells),
+    // and the leftover mines go one each to stripes sampled from the board stream.
+    mStripeMines.assign(numStripes, 0);
+    size_t assigned = 0;
+    for (size_t stripe = 0; stripe < numStripes; stripe++)
+    {
+        size_t stripeCells = std::min(cellsPerStripe, numCells - stripe * cellsPerStripe);
+        mStripeMines[stripe] = (uint32_t) ((uint64_t) mineCount * stripeCells / numCells);
+        assigned += mStripeMines[stripe];
+    }
+
+    // Floyd's sampling over the stripes: O(leftover) draws, no retries.
+    mHasExtraMine.assign(numStripes, 0);
+    size_t leftover = mineCount - assigned;
+    for (size_t j = numStripes - leftover; j < numStripes; j++)
+    {
+        size_t t = boardRandom.Below(j, (uint32_t) (j + 1));
+        size_t chosen = mHasExtraMine[t] ? j : t;
+        mHasExtraMine[chosen] = 1;
+        mStripeMines[chosen]++;
+    }
+
+    const uint32_t* pStripeMines = mStripeMines.data();
+
+    // copies of each stripe's first and last row, so pass 2 never reads a row another thread writes.
+    mEdgeRows.resize(numStripes * 2 * width);
+    uint8_t* pEdgeRows = mEdgeRows.data();
+
+    // and a row of column sums for each stripe.
+    mColumnSums.resize(numStripes * (width + 2));
+    uint8_t* pColumnSums = mColumnSums.data();
+
+    // Pass 1: each stripe samples its own mines.
+    ParallelFor(numStripes, numThreads, [=](size_t stripe) {
+        size_t begin = stripe * cellsPerStripe;
+        size_t stripeCells = std::min(cellsPerStripe, numCells - begin);
+        uint8_t* stripeData = cells + begin;
+
+        SampleStripeMines(stripeData, stripeCells, pStripeMines[stripe], boardRandom.Substream(stripe + 1));
+
+        std::copy(stripeData, stripeData + width, pEdgeRows + stripe * 2 * width);
+        std::copy(stripeData + stripeCells - width, stripeData + stripeCells, pEdgeRows + (stripe * 2 + 1) * width);
+    });
+
+    // Pass 2: adjacent counts, reading the neighbouring stripes' rows from the copies.
+    ParallelFor(numStripes, numThreads, [=](size_t stripe) {
+        int firstRow = (int) (stripe * rowsPerStripe);
+        int lastRow = std::min(firstRow + rowsPerStripe, height);
+
+        const uint8_t* aboveFirst = stripe == 0 ? nullptr : pEdgeRows + ((stripe - 1) * 2 + 1) * width;
+        const uint8_t* belowLast = stripe == numStripes - 1 ? nullptr : pEdgeRows + (stripe + 1) * 2 * width;
+
+        CountStripeMines(cells, width, firstRow, lastRow, aboveFirst, belowLast,
+                         pColumnSums + stripe * (width + 2));
+    });
+}
+
+bool Minefield::IsMine(size_t cellIndex) const
+{
+    return (mCells.at(cellIndex) & kMineBit) != 0;
+}
+
+int Minefield::GetAdjacentMineCount(size_t cellIndex) const
+{
+    return mCells.at(cellIndex) & kCountMask;
+}
+
+MoundState Minefield::GetState(size_t cellIndex) const
+{
+    return (MoundState) ((mCells.at(cellIndex) & kStateMask) >> kStateShift);
+}
+
+void Minefield::SetState(size_t cellIndex, MoundState state)
+{
+    mCells[cellIndex] = (mCells[cellIndex] & ~kStateMask) | ((uint8_t) state << kStateShift);
+}
+
+void Minefield::ToggleFlag(size_t cellIndex)
+{
+    MoundState state = GetState(cellIndex);
+    if (state == MoundState::Untouched)
+    {
+        SetState(cellIndex, MoundState::Flagged);
+    }
+    else if (state == MoundState::Flagged)
+    {
+        SetState(cellIndex, MoundState::Untouched);
+    }
+}
+
+RevealResult Minefield::Reveal(size_t cellIndex, std::vector<uint32_t>& changedCells)
+{
+    changedCells.clear();
+
+    if (GetState(cellIndex) != MoundState::Untouched)
+    {
+        return RevealResult::Ignored;
+    }
+
+    if (IsMine(cellIndex))
+    {
+        return RevealResult::HitMine;
+    }
+
+    if ((mCells[cellIndex] & kCountMask) != 0)
+    {
+        SetState(cellIndex, MoundState::Uncovered);
+        changedCells.push_back(cellIndex);
+        return RevealResult::Revealed;
+    }
+
+    // Scanline flood fill over the zero cells.
+    // Each popped seed grows into a horizontal run of untouched zeros, which is uncovered
+    // along with its 8-connected border. Zeros in the rows above and below become new seeds,
+    // one per run. Seeds are marked in the visited mask when pushed so none is pushed twice.
+    mFloodStack.clear();
+    mFloodStack.push_back(cellIndex);
+    SetVisited(cellIndex);
+
+    while (!mFloodStack.empty())
+    {
+        size_t seed = mFloodStack.back();
+        mFloodStack.pop_back();
+
+        if ((mCells[seed] & kStateMask) != 0)
+        {
+            // already uncovered as part of another run
+            continue;
+        }
+
+        int y = seed / mWidth;
+        size_t row = (size_t) y * mWidth;
+        int x0 = seed - row;
+        int x1 = x0;
+
+        while (x0 > 0 && mCells[row + x0 - 1] == 0) x0--;
+        while (x1 < mWidth - 1 && mCells[row + x1 + 1] == 0) x1++;
+
+        int bx0 = std::max(x0 - 1, 0);
+        int bx1 = std::min(x1 + 1, mWidth - 1);
+
+        for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, mHeight - 1); ny++)
+        {
+            size_t neighborRow = (size_t) ny * mWidth;
+            bool inZeroRun = false;
+
+            for (int nx = bx0; nx <= bx1; nx++)
+            {
+                size_t neighbor = neighborRow + nx;
+                uint8_t cell = mCells[neighbor];
+
+                // a cell byte of zero is an untouched, mine-free cell with no adjacent mines.
+                // neighbours of a zero are never mines, so the rest only need their state checked.
+                if (cell == 0 && ny != y)
+                {
+                    if (!inZeroRun && !IsVisited(neighbor))
+                    {
+                        SetVisited(neighbor);
+                        mFloodStack.push_back(neighbor);
+                    }
+                    inZeroRun = true;
+                    continue;
+                }
+
+                inZeroRun = false;
+
+                if ((cell & kStateMask) == 0)
+                {
+                    SetState(neighbor, MoundState::Uncovered);
+                    changedCells.push_back(neighbor);
+                }
+            }
+        }
+    }
+
+    // only seeds were marked, and every seed ends up uncovered.
+    for (uint32_t changed : changedCells)
+    {
+        ClearVisited(changed);
+    }
+
+    return RevealResult::Revealed;
+}
@@ -0,0 +1,94 @@
+#ifndef MINEFIELD_HPP
+#define MINEFIELD_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+enum class MoundState
+{
+    Untouched,
+    Uncovered,
+    Flagged
+};
+
+enum class RevealResult
+{
+    Ignored,
+    Revealed,
+    HitMine
+};
+
+// Dense rectangular minesweeper board.
+// Each cell is packed into a single byte holding its adjacent mine count,
+// whether it is a mine, and its MoundState, so a 10000x10000 board fits in ~100MB.
+// Cells are indexed row-major: index = y * width + x.
+class Minefield
+{
+    int mWidth = 0;
+    int mHeight = 0;
+
+    std::vector<uint8_t> mCells;
+
+    // scratch state for Reveal, kept around so flood fills don't allocate.
+    std::vector<uint64_t> mVisited;
+    std::vector<uint32_t> mFloodStack;
+
+    // scratch state for GenerateMines, kept around so generating the next board doesn't allocate.
+    std::vector<uint32_t> mStripeMines;
+    std::vector<uint8_t> mHasExtraMine;
+    std::vector<uint8_t> mEdgeRows;
+    std::vector<uint8_t> mColumnSums;
+
+    bool IsVisited(size_t cellIndex) const
+    {
+        return (mVisited[cellIndex / 64] >> (cellIndex % 64)) & 1;
+    }
+
+    void SetVisited(size_t cellIndex)
+    {
+        mVisited[cellIndex / 64] |= uint64_t(1) << (cellIndex % 64);
+    }
+
+    void ClearVisited(size_t cellIndex)
+    {
+        mVisited[cellIndex / 64] &= ~(uint64_t(1) << (cellIndex % 64));
+    }
+
+    void SetState(size_t cellIndex, MoundState state);
+
+public:
+    Minefield(int width, int height);
+
+    int GetWidth() const { return mWidth; }
+    int GetHeight() const { return mHeight; }
+    size_t GetCellCount() const { return mCells.size(); }
+
+    // Removes all mines and covers every cell.
+    void Clear();
+
+    // Marks a cell as a mine and bumps the adjacent mine count of its neighbours.
+    // Placing a mine on a cell that already holds one does nothing.
+    void PlaceMine(size_t cellIndex);
+
+    // Clears the board, then places exactly mineCount mines and computes every adjacent count.
+    // The layout depends only on (seed, boardId), not on numThreads, which is picked from the
+    // board size when 0. Large boards are split into fixed row stripes that each get their
+    // proportional share of the mines, sampled uniformly within the stripe.
+    void GenerateMines(size_t mineCount, uint64_t seed, uint64_t boardId, unsigned int numThreads = 0);
+
+    bool IsMine(size_t cellIndex) const;
+    int GetAdjacentMineCount(size_t cellIndex) const;
+    MoundState GetState(size_t cellIndex) const;
+
+    void ToggleFlag(size_t cellIndex);
+
+    // Uncovers a cell. If it has no adjacent mines, the surrounding zero region
+    // and its border are uncovered as well.
+    // changedCells is overwritten with every cell whose state went to Uncovered.
+    // Nothing is uncovered if the cell is a mine.
+    // Doesn't allocate once the scratch buffers and changedCells have grown to fit the reveal.
+    RevealResult Reveal(size_t cellIndex, std::vector<uint32_t>& changedCells);
+};
+
+#endif // MINEFIELD_HPP
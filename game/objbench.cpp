@@ -0,0 +1,489 @@
+// OBJ parsing benchmark: checks tinyobj::ParseFloat against strtof, then times tinyobj
+// loading an OBJ on 1, 2, 4... threads, checking each gives the same shapes. It prints a
+// hash of them, so two builds of the loader can be checked for giving the same shapes too.
+// Without --obj, it writes and loads a grid of about 100 MB, with floats printed the way
+// modelling tools export them. With --stream, the shapes are hashed as tinyobj hands them
+// over and then dropped, instead of being collected, and the peak memory shows the difference.
+// Needs no window or GL.
+
+#include "counterrandom.hpp"
+
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+struct ObjBenchOptions
+{
+    std::string ObjFile;
+    int GridSize = 750;
+    int Groups = 4;
+    bool Relative = false;
+    bool Stream = false;
+    unsigned int Threads = std::max(std::thread::hardware_concurrency(), 1u);
+    size_t Repeat = 3;
+    size_t FloatSamples = 1 << 22;
+};
+
+static const char* kUsage =
+    "usage: game_objbench [options]\n"
+    "  --obj <file>            OBJ file to load. Without one, a generated grid is loaded.\n"
+    "  --grid <N>              the generated grid is N x N quads\n"
+    "  --groups <N>            the generated grid is split into N groups, each with its own material\n"
+    "  --relative              the generated grid's faces use relative indices, and its vertices come\n"
+    "                          a row at a time, just before the faces that need them\n"
+    "  --threads <N>           most threads to load with\n"
+    "  --stream                hash and drop each shape as it's loaded, instead of collecting them\n"
+    "  --repeat <N>            loads to time per thread count. The fastest is reported.\n"
+    "  --float-samples <N>     strings ParseFloat is checked against strtof with, per kind of string\n";
+
+static ObjBenchOptions ParseObjBenchOptions(int argc, char* argv[])
+{
+    ObjBenchOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        auto nextValue = [&]() -> const char* {
+            if (i + 1 >= argc)
+            {
+                throw std::runtime_error(std::string("Missing value for ") + arg);
+            }
+            return argv[++i];
+        };
+
+        if (!strcmp(arg, "--obj"))
+        {
+            options.ObjFile = nextValue();
+        }
+        else if (!strcmp(arg, "--grid"))
+        {
+            options.GridSize = std::max(std::stoi(nextValue()), 1);
+        }
+        else if (!strcmp(arg, "--groups"))
+        {
+            options.Groups = std::max(std::stoi(nextValue()), 1);
+        }
+        else if (!strcmp(arg, "--relative"))
+        {
+            options.Relative = true;
+        }
+        else if (!strcmp(arg, "--stream"))
+        {
+            options.Stream = true;
+        }
+        else if (!strcmp(arg, "--threads"))
+        {
+            options.Threads = std::max(std::stoi(nextValue()), 1);
+        }
+        else if (!strcmp(arg, "--repeat"))
+        {
+            options.Repeat = std::max<size_t>(std::stoull(nextValue()), 1);
+        }
+        else if (!strcmp(arg, "--float-samples"))
+        {
+            options.FloatSamples = std::stoull(nextValue());
+        }
+        else if (!strcmp(arg, "--help"))
+        {
+            printf("%s", kUsage);
+            exit(0);
+        }
+        else
+        {
+            fprintf(stderr, "%s", kUsage);
+            throw std::runtime_error(std::string("Unknown argument: ") + arg);
+        }
+    }
+
+    return options;
+}
+
+static uint32_t FloatBits(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static float BitsFloat(uint32_t bits)
+{
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// Returns whether ParseFloat read the string exactly as strtof does: same bits, same end.
+static bool MatchesStrtof(const char* text)
+{
+    char* expectedEnd;
+    float expected = strtof(text, &expectedEnd);
+
+    float actual;
+    const char* actualEnd = tinyobj::ParseFloat(text, text + strlen(text), actual);
+
+    return FloatBits(actual) == FloatBits(expected) && actualEnd == expectedEnd;
+}
+
+// Checks ParseFloat against strtof on random floats printed by printf, and on random decimals
+// with more digits and wider exponents than floats need. Returns the number of mismatches.
+static size_t CheckParseFloat(size_t samples)
+{
+    CounterRandom random(1, 0);
+    const char* formats[] = { "%.9g", "%.6f", "%.7e", "%g" };
+    size_t mismatches = 0;
+    size_t checked = 0;
+    char text[128];
+
+    auto check = [&](const char* kind) {
+        checked++;
+        if (!MatchesStrtof(text))
+        {
+            if (mismatches++ < 10)
+            {
+                printf("  mismatch (%s): \"%s\"\n", kind, text);
+            }
+        }
+    };
+
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+    {
+        const char* format = formats[f];
+        CounterRandom formatRandom = random.Substream(f);
+        for (size_t i = 0; i < samples; i++)
+        {
+            snprintf(text, sizeof(text), format, BitsFloat((uint32_t) formatRandom(i)));
+            check(format);
+        }
+    }
+
+    CounterRandom digitRandom = random.Substream(1000);
+    for (size_t i = 0; i < samples; i++)
+    {
+        uint64_t r = digitRandom(2 * i);
+        uint64_t digitBits = digitRandom(2 * i + 1);
+
+        char* p = text;
+        if (r & 1)
+        {
+            *p++ = '-';
+        }
+        int digits = 1 + (int) ((r >> 1) % 25);
+        int point = (int) ((r >> 8) % (digits + 1));
+        for (int d = 0; d < digits; d++)
+        {
+            if (d == point)
+            {
+                *p++ = '.';
+            }
+            *p++ = (char) ('0' + (digitBits >> (d * 2 % 60)) % 10);
+        }
+        if (r & (1 << 16))
+        {
+            p += sprintf(p, "e%d", (int) ((r >> 20) % 91) - 45);
+        }
+        *p = '\0';
+        check("decimal");
+    }
+
+    const char* specials[] = {
+        "0", "-0", "+1", ".5", "5.", ".", "-", "", " 1", "1e", "1e+", "1.5e-3x", "0x1p3",
+        "inf", "-infinity", "nan", "1e39", "1e-46", "3.4028235e38", "1.17549435e-38",
+        "1.000000000000000000000000000001", "0.000000000000000000000000000000000000000000001"
+    };
+    for (const char* special : specials)
+    {
+        snprintf(text, sizeof(text), "%s", special);
+        check("special");
+    }
+
+    printf("ParseFloat vs strtof: %zu strings, %zu mismatches\n", checked, mismatches);
+    return mismatches;
+}
+
+static void WriteGridRow(FILE* out, int n, int z)
+{
+    CounterRandom jitter(2, z);
+    for (int x = 0; x <= n; x++)
+    {
+        float dx = (jitter(x) >> 40) / (float) (1 << 24) - 0.5f;
+        float height = 4.0f * std::sin(x * 0.05f) * std::cos(z * 0.07f);
+        float nx = -0.2f * std::cos(x * 0.05f) * std::cos(z * 0.07f);
+        float nz = 0.28f * std::sin(x * 0.05f) * std::sin(z * 0.07f);
+        float length = std::sqrt(nx * nx + 1.0f + nz * nz);
+        fprintf(out, "v %.6f %.6f %.6f\n", x + 0.25f * dx - n * 0.5f, height, z - n * 0.5f);
+        fprintf(out, "vt %.6f %.6f\n", (float) x / n, (float) z / n);
+        fprintf(out, "vn %.4f %.4f %.4f\n", nx / length, 1.0f / length, nz / length);
+    }
+}
+
+// An n x n grid of quads, in row bands that each have a group and a material.
+static void WriteGridObj(const char* filename, int n, int groups, bool relative)
+{
+    FILE* out = fopen(filename, "w");
+    if (!out)
+    {
+        throw std::runtime_error(std::string("Failed to open ") + filename + " for writing");
+    }
+
+    int rowsWritten = 0;
+    if (!relative)
+    {
+        for (; rowsWritten <= n; rowsWritten++)
+        {
+            WriteGridRow(out, n, rowsWritten);
+        }
+    }
+
+    int rowsPerGroup = (n + groups - 1) / groups;
+    for (int z = 0; z < n; z++)
+    {
+        for (; rowsWritten <= z + 1; rowsWritten++)
+        {
+            WriteGridRow(out, n, rowsWritten);
+        }
+        if (z % rowsPerGroup == 0)
+        {
+            fprintf(out, "g band%d\nusemtl band%d\n", z / rowsPerGroup, z / rowsPerGroup);
+        }
+        for (int x = 0; x < n; x++)
+        {
+            int corners[4] = {
+                z * (n + 1) + x + 1,
+                z * (n + 1) + x + 2,
+                (z + 1) * (n + 1) + x + 2,
+                (z + 1) * (n + 1) + x + 1
+            };
+            if (relative)
+            {
+                for (int& corner : corners)
+                {
+                    corner -= rowsWritten * (n + 1) + 1;
+                }
+            }
+            fprintf(out, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
+                    corners[0], corners[0], corners[0], corners[1], corners[1], corners[1],
+                    corners[2], corners[2], corners[2], corners[3], corners[3], corners[3]);
+        }
+    }
+
+    bool failed = ferror(out) != 0;
+    if (fclose(out) != 0 || failed)
+    {
+        throw std::runtime_error(std::string("Failed to write ") + filename);
+    }
+}
+
+static size_t FileSize(const char* filename)
+{
+    FILE* f = fopen(filename, "rb");
+    if (!f)
+    {
+        throw std::runtime_error(std::string("Failed to open ") + filename);
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return (size_t) std::max(size, 0L);
+}
+
+// FNV-1a
+static void HashBytes(uint64_t& hash, const void* data, size_t bytes)
+{
+    const unsigned char* bytePointer = (const unsigned char*) data;
+    for (size_t i = 0; i < bytes; i++)
+    {
+        hash = (hash ^ bytePointer[i]) * 0x100000001B3ull;
+    }
+}
+
+template<class T>
+static void HashVector(uint64_t& hash, const std::vector<T>& values)
+{
+    size_t count = values.size();
+    HashBytes(hash, &count, sizeof(count));
+    HashBytes(hash, values.data(), values.size() * sizeof(T));
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct LoadedShapes
+{
+    uint64_t Hash = 0xCBF29CE484222325ull;
+    size_t ShapeCount = 0;
+    size_t VertexCount = 0;
+    size_t TriangleCount = 0;
+    // loading them, not counting hashing them
+    double Milliseconds = 0.0;
+
+    void Add(const tinyobj::shape_t& shape, const std::vector<tinyobj::material_t>& materials)
+    {
+        static const tinyobj::material_t kNoMaterial = tinyobj::material_t();
+        const tinyobj::material_t& material = shape.material_id >= 0 ? materials.at(shape.material_id) : kNoMaterial;
+
+        HashBytes(Hash, shape.name.c_str(), shape.name.size() + 1);
+        HashBytes(Hash, material.name.c_str(), material.name.size() + 1);
+        HashBytes(Hash, material.diffuse_texname.c_str(), material.diffuse_texname.size() + 1);
+        HashVector(Hash, shape.mesh.positions);
+        HashVector(Hash, shape.mesh.normals);
+        HashVector(Hash, shape.mesh.texcoords);
+        HashVector(Hash, shape.mesh.indices);
+
+        ShapeCount++;
+        VertexCount += shape.mesh.positions.size() / 3;
+        TriangleCount += shape.mesh.indices.size() / 3;
+    }
+};
+
+// hashes each shape as it's loaded, and lets tinyobj free it
+class ShapeHasher : public tinyobj::shape_visitor
+{
+    std::vector<tinyobj::material_t> mMaterials;
+
+public:
+    LoadedShapes Loaded;
+
+    void visit_materials(std::vector<tinyobj::material_t>& materials) override
+    {
+        mMaterials.swap(materials);
+    }
+
+    void visit_shape(tinyobj::shape_t& shape) override
+    {
+        auto hashStart = std::chrono::steady_clock::now();
+        Loaded.Add(shape, mMaterials);
+        Loaded.Milliseconds -= MillisecondsSince(hashStart);
+    }
+};
+
+static LoadedShapes LoadShapes(const std::string& objFile, unsigned int threads, bool stream)
+{
+    auto loadStart = std::chrono::steady_clock::now();
+    if (stream)
+    {
+        ShapeHasher hasher;
+        tinyobj::LoadObj(hasher, objFile.c_str(), NULL, threads);
+        hasher.Loaded.Milliseconds += MillisecondsSince(loadStart);
+        return hasher.Loaded;
+    }
+
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    tinyobj::LoadObj(shapes, materials, objFile.c_str(), NULL, threads);
+
+    LoadedShapes loaded;
+    loaded.Milliseconds = MillisecondsSince(loadStart);
+    for (const tinyobj::shape_t& shape : shapes)
+    {
+        loaded.Add(shape, materials);
+    }
+    return loaded;
+}
+
+// the most memory the process has had resident so far, 0 where that isn't known
+static size_t PeakResidentBytes()
+{
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#ifdef __APPLE__
+        return (size_t) usage.ru_maxrss;
+#else
+        return (size_t) usage.ru_maxrss * 1024;
+#endif
+    }
+#endif
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        ObjBenchOptions options = ParseObjBenchOptions(argc, argv);
+
+        size_t mismatches = CheckParseFloat(options.FloatSamples);
+
+        std::string objFile = options.ObjFile;
+        bool isGenerated = objFile.empty();
+        if (isGenerated)
+        {
+            objFile = "objbench_grid.obj";
+            WriteGridObj(objFile.c_str(), options.GridSize, options.Groups, options.Relative);
+        }
+        size_t fileBytes = FileSize(objFile.c_str());
+
+        // 1, 2, 4... threads, and the most asked for
+        std::vector<unsigned int> threadCounts;
+        for (unsigned int threads = 1; threads < options.Threads; threads *= 2)
+        {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(options.Threads);
+
+        LoadedShapes loaded;
+        std::vector<double> bestMillis;
+        bool hashesMatch = true;
+        for (unsigned int threads : threadCounts)
+        {
+            double best = 0.0;
+            LoadedShapes threadsLoaded;
+            for (size_t run = 0; run < options.Repeat; run++)
+            {
+                threadsLoaded = LoadShapes(objFile, threads, options.Stream);
+                best = run == 0 ? threadsLoaded.Milliseconds : std::min(best, threadsLoaded.Milliseconds);
+            }
+            bestMillis.push_back(best);
+
+            if (threads == 1)
+            {
+                loaded = threadsLoaded;
+            }
+            else if (threadsLoaded.Hash != loaded.Hash)
+            {
+                printf("  %u threads loaded different shapes than 1 thread\n", threads);
+                hashesMatch = false;
+            }
+        }
+
+        if (isGenerated)
+        {
+            remove(objFile.c_str());
+        }
+
+        printf("%s: %.1f MB, %zu shapes, %zu vertices, %zu triangles\n", objFile.c_str(), fileBytes / 1e6,
+               loaded.ShapeCount, loaded.VertexCount, loaded.TriangleCount);
+        printf("%-10s %10s %10s %10s\n", "threads", "best ms", "MB/s", "speedup");
+        for (size_t t = 0; t < threadCounts.size(); t++)
+        {
+            printf("%-10u %10.1f %10.1f %10.2f\n", threadCounts[t], bestMillis[t],
+                   fileBytes / 1e3 / bestMillis[t], bestMillis[0] / bestMillis[t]);
+        }
+        printf("%-10s %016llx\n", "hash", (unsigned long long) loaded.Hash);
+        printf("%-10s %.1f MB\n", "peak RSS", PeakResidentBytes() / 1e6);
+
+        return mismatches == 0 && hashesMatch ? 0 : 1;
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Fatal exception: %s\n", e.what());
+        return 1;
+    }
+}
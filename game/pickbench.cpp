@@ -0,0 +1,237 @@
+// Micro-benchmark for mouse picking: one ray against a board of mound billboards,
+// tested one at a time, as a SIMD batch, and through the picking grid.
+
+#include "geometry.hpp"
+#include "pickinggrid.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct PickBenchOptions
+{
+    int MoundsPerRow = 1000;
+    size_t Rays = 200;
+    size_t Cameras = 4;
+};
+
+struct Ray
+{
+    glm::vec3 Origin;
+    glm::vec3 Direction;
+    glm::vec3 CameraView;
+    size_t Camera;
+};
+
+static const char* kUsage =
+    "usage: game_pickbench [options]\n"
+    "  --mounds-per-row <N>   board is N x N mounds\n"
+    "  --rays <N>             rays to pick with per method\n"
+    "  --cameras <N>          cameras the rays are spread over\n";
+
+static PickBenchOptions ParsePickBenchOptions(int argc, char* argv[])
+{
+    PickBenchOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        auto nextValue = [&]() -> const char* {
+            if (i + 1 >= argc)
+            {
+                throw std::runtime_error(std::string("Missing value for ") + arg);
+            }
+            return argv[++i];
+        };
+
+        if (!strcmp(arg, "--mounds-per-row"))
+        {
+            options.MoundsPerRow = std::stoi(nextValue());
+        }
+        else if (!strcmp(arg, "--rays"))
+        {
+            options.Rays = std::stoull(nextValue());
+        }
+        else if (!strcmp(arg, "--cameras"))
+        {
+            options.Cameras = std::max<size_t>(std::stoull(nextValue()), 1);
+        }
+        else if (!strcmp(arg, "--help"))
+        {
+            printf("%s", kUsage);
+            exit(0);
+        }
+        else
+        {
+            fprintf(stderr, "%s", kUsage);
+            throw std::runtime_error(std::string("Unknown argument: ") + arg);
+        }
+    }
+
+    return options;
+}
+
+// Runs pick on every ray, returns microseconds per ray. Results go in hits.
+template<class PickFunction>
+static double TimePicks(const std::vector<Ray>& rays, std::vector<size_t>& hits, PickFunction pick)
+{
+    hits.resize(rays.size());
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rays.size(); i++)
+    {
+        hits[i] = pick(rays[i]);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::micro>(end - start).count() / std::max<size_t>(rays.size(), 1);
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        PickBenchOptions options = ParsePickBenchOptions(argc, argv);
+
+        int n = options.MoundsPerRow;
+        glm::vec2 dimensions(0.7f, 0.7f);
+        glm::vec3 cameraUp(0.0f, 1.0f, 0.0f);
+
+        std::vector<glm::vec3> centers;
+        PickingGrid grid;
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                // same layout as WorldScene's mounds
+                centers.push_back(glm::vec3(i - n / 2.0f + 0.5f, dimensions.y / 2.0f, j - n / 2.0f + 0.5f));
+                grid.AddItem(centers.back(), dimensions);
+            }
+        }
+        grid.Rebuild();
+
+        // cameras looking down at random spots of the board, with rays clicking around those spots.
+        std::default_random_engine engine(0);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::vector<glm::vec3> cameraTargets, cameraEyes;
+        for (size_t i = 0; i < options.Cameras; i++)
+        {
+            cameraTargets.push_back(glm::vec3(unit(engine) * n / 2.0f, 0.0f, unit(engine) * n / 2.0f));
+            cameraEyes.push_back(cameraTargets.back() + glm::vec3(unit(engine) * 7.0f, 10.0f, unit(engine) * 7.0f));
+        }
+
+        std::vector<Ray> rays;
+        for (size_t i = 0; i < options.Rays; i++)
+        {
+            size_t camera = i % options.Cameras;
+            glm::vec3 eye = cameraEyes[camera];
+            glm::vec3 aim = cameraTargets[camera] + glm::vec3(unit(engine), 0.0f, unit(engine)) * 3.0f;
+
+            Ray ray = { eye, (aim - eye) * 100.0f, cameraTargets[camera] - eye, camera };
+            rays.push_back(ray);
+        }
+
+        printf("%d x %d mounds, %zu rays from %zu cameras\n", n, n, rays.size(), options.Cameras);
+        printf("%-28s %14s %10s\n", "method", "us per ray", "speedup");
+
+        // the planes depend on the camera, so the one at a time loop rebuilds them for every ray
+        // like WorldScene did, and the batches are built once per camera.
+        std::vector<size_t> expected;
+        double baseline = TimePicks(rays, expected, [&](const Ray& ray) {
+            glm::vec3 unitView = glm::normalize(ray.CameraView);
+            size_t closest = kNoParallelogram;
+            float closestT = INFINITY;
+            for (size_t m = 0; m < centers.size(); m++)
+            {
+                // what the old per-billboard renderer did for each billboard
+                glm::vec3 unitSide = glm::cross(unitView, glm::normalize(cameraUp));
+                glm::vec3 unitUp = glm::cross(unitSide, unitView);
+                glm::vec3 bottomLeft = centers[m] - unitSide / 2.0f * dimensions.x - unitUp / 2.0f * dimensions.y;
+
+                float t;
+                if (RayParallelogramIntersect(ray.Origin, ray.Direction, bottomLeft,
+                                              unitSide * dimensions.x, unitUp * dimensions.y, t)
+                    && t >= 0.0f && t < closestT)
+                {
+                    closest = m;
+                    closestT = t;
+                }
+            }
+            return closest;
+        });
+        printf("%-28s %14.2f %9.2fx\n", "one at a time", baseline, 1.0);
+
+        std::vector<ParallelogramBatch> batches(options.Cameras);
+        auto buildStart = std::chrono::steady_clock::now();
+        for (size_t camera = 0; camera < options.Cameras; camera++)
+        {
+            glm::vec3 unitView = glm::normalize(cameraTargets[camera] - cameraEyes[camera]);
+            glm::vec3 unitSide = glm::cross(unitView, glm::normalize(cameraUp));
+            glm::vec3 unitUp = glm::cross(unitSide, unitView);
+
+            batches[camera].Reserve(centers.size());
+            for (const glm::vec3& center : centers)
+            {
+                glm::vec3 bottomLeft = center - unitSide / 2.0f * dimensions.x - unitUp / 2.0f * dimensions.y;
+                batches[camera].Add(bottomLeft, unitSide * dimensions.x, unitUp * dimensions.y);
+            }
+        }
+        auto buildEnd = std::chrono::steady_clock::now();
+        double buildMicros = std::chrono::duration<double, std::micro>(buildEnd - buildStart).count() / options.Cameras;
+        printf("%-28s %14.2f %10s\n", "batch build (per camera)", buildMicros, "");
+
+        struct Method
+        {
+            const char* Name;
+            size_t (*Intersect)(glm::vec3, glm::vec3, const ParallelogramBatch&, float&);
+        };
+
+        const Method methods[] = {
+            { "batch, scalar", RayParallelogramBatchIntersectScalar },
+#if defined(__AVX__)
+            { "batch, AVX (8 wide)", RayParallelogramBatchIntersect },
+#elif defined(__SSE2__) || defined(_M_X64)
+            { "batch, SSE2 (4 wide)", RayParallelogramBatchIntersect },
+#endif
+        };
+
+        size_t mismatches = 0;
+        std::vector<size_t> hits;
+
+        for (const Method& method : methods)
+        {
+            double micros = TimePicks(rays, hits, [&](const Ray& ray) {
+                float t;
+                return method.Intersect(ray.Origin, ray.Direction, batches[ray.Camera], t);
+            });
+            printf("%-28s %14.2f %9.2fx\n", method.Name, micros, baseline / micros);
+            for (size_t i = 0; i < hits.size(); i++) mismatches += hits[i] != expected[i];
+        }
+
+        double gridMicros = TimePicks(rays, hits, [&](const Ray& ray) {
+            float t;
+            uint32_t item = grid.Pick(ray.Origin, ray.Direction, ComputeBillboardBasis(ray.CameraView, cameraUp), t);
+            return item == PickingGrid::kNoItem ? kNoParallelogram : (size_t) item;
+        });
+        printf("%-28s %14.2f %9.2fx\n", "picking grid", gridMicros, baseline / gridMicros);
+        for (size_t i = 0; i < hits.size(); i++) mismatches += hits[i] != expected[i];
+
+        size_t hitCount = 0;
+        for (size_t hit : expected) hitCount += hit != kNoParallelogram;
+        printf("%zu of %zu rays hit a mound, %zu mismatched picks\n", hitCount, rays.size(), mismatches);
+
+        return mismatches == 0 ? 0 : 1;
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Fatal exception: %s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,285 @@
+#include "pickinggrid.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+PickingGrid::PickingGrid(float cellSize)
+    : mCellSize(cellSize)
+{
+    if (!(cellSize > 0.0f))
+    {
+        throw std::invalid_argument("cellSize must be positive");
+    }
+}
+
+void PickingGrid::Clear()
+{
+    mItems.clear();
+    mIsDirty = true;
+}
+
+uint32_t PickingGrid::AddItem(glm::vec3 centerPosition, glm::vec2 dimensions)
+{
+    if (mItems.size() >= kNoItem)
+    {
+        throw std::length_error("Too many items in picking grid");
+    }
+
+    Item item = { centerPosition, dimensions };
+    mItems.push_back(item);
+    mIsDirty = true;
+    return (uint32_t) mItems.size() - 1;
+}
+
+void PickingGrid::SetItem(uint32_t item, glm::vec3 centerPosition, glm::vec2 dimensions)
+{
+    Item& changed = mItems.at(item);
+    changed.Center = centerPosition;
+    changed.Dimensions = dimensions;
+    mIsDirty = true;
+}
+
+float PickingGrid::GetBoundingRadius(const Item& item) const
+{
+    // a billboard turns to face the camera and tilts with it,
+    // so any point of it is within half its diagonal of the center.
+    return glm::length(item.Dimensions) / 2.0f;
+}
+
+void PickingGrid::Rebuild()
+{
+    mIsDirty = false;
+
+    if (mItems.empty())
+    {
+        mOrigin = glm::ivec2(0);
+        mSize = glm::ivec2(0);
+        mCellStarts.assign(1, 0);
+        mCellItems.clear();
+        return;
+    }
+
+    glm::vec2 minXZ(INFINITY);
+    glm::vec2 maxXZ(-INFINITY);
+    mMinY = INFINITY;
+    mMaxY = -INFINITY;
+    for (const Item& item : mItems)
+    {
+        float radius = GetBoundingRadius(item);
+        glm::vec2 centerXZ(item.Center.x, item.Center.z);
+        minXZ = glm::min(minXZ, centerXZ - radius);
+        maxXZ = glm::max(maxXZ, centerXZ + radius);
+        mMinY = std::min(mMinY, item.Center.y - radius);
+        mMaxY = std::max(mMaxY, item.Center.y + radius);
+    }
+
+    mOrigin = glm::ivec2(glm::floor(minXZ / mCellSize));
+    mSize = glm::ivec2(glm::floor(maxXZ / mCellSize)) - mOrigin + 1;
+
+    size_t numCells = (size_t) mSize.x * mSize.y;
+    if (numCells >= kNoItem)
+    {
+        throw std::length_error("Picking grid too large for its cell size");
+    }
+
+    // counting sort of items into cells: count, prefix sum, fill.
+    mCellStarts.assign(numCells + 1, 0);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (pass == 1)
+        {
+            for (size_t cell = 0; cell < numCells; cell++)
+            {
+                mCellStarts[cell + 1] += mCellStarts[cell];
+            }
+            mCellItems.resize(mCellStarts[numCells]);
+        }
+
+        for (size_t itemIndex = 0; itemIndex < mItems.size(); itemIndex++)
+        {
+            const Item& item = mItems[itemIndex];
+            float radius = GetBoundingRadius(item);
+            glm::ivec2 first = glm::ivec2(glm::floor((glm::vec2(item.Center.x, item.Center.z) - radius) / mCellSize)) - mOrigin;
+            glm::ivec2 last = glm::ivec2(glm::floor((glm::vec2(item.Center.x, item.Center.z) + radius) / mCellSize)) - mOrigin;
+
+            for (int z = first.y; z <= last.y; z++)
+            {
+                for (int x = first.x; x <= last.x; x++)
+                {
+                    size_t cell = (size_t) z * mSize.x + x;
+                    if (pass == 0)
+                    {
+                        mCellStarts[cell + 1]++;
+                    }
+                    else
+                    {
+                        // mCellStarts[cell] is used as the fill cursor, then shifted back below.
+                        mCellItems[mCellStarts[cell]++] = (uint32_t) itemIndex;
+                    }
+                }
+            }
+        }
+    }
+
+    // every cursor now sits at the start of the next cell
+    for (size_t cell = numCells; cell > 0; cell--)
+    {
+        mCellStarts[cell] = mCellStarts[cell - 1];
+    }
+    mCellStarts[0] = 0;
+}
+
+uint32_t PickingGrid::Pick(glm::vec3 origin, glm::vec3 direction,
+                           const BillboardBasis& basis,
+                           float& t)
+{
+    if (mIsDirty)
+    {
+        Rebuild();
+    }
+
+    if (mItems.empty())
+    {
+        return kNoItem;
+    }
+
+    // clip the ray to the band of heights the billboards cover
+    float tStart = 0.0f;
+    float tEnd = INFINITY;
+    if (glm::abs(direction.y) < 1e-6f)
+    {
+        if (origin.y < mMinY || origin.y > mMaxY)
+        {
+            return kNoItem;
+        }
+    }
+    else
+    {
+        float t0 = (mMinY - origin.y) / direction.y;
+        float t1 = (mMaxY - origin.y) / direction.y;
+        tStart = std::max(tStart, std::min(t0, t1));
+        tEnd = std::min(tEnd, std::max(t0, t1));
+    }
+
+    // and to the grid's footprint on the ground
+    glm::vec2 gridMin = glm::vec2(mOrigin) * mCellSize;
+    glm::vec2 gridMax = glm::vec2(mOrigin + mSize) * mCellSize;
+    glm::vec2 originXZ(origin.x, origin.z);
+    glm::vec2 directionXZ(direction.x, direction.z);
+    for (int axis = 0; axis < 2; axis++)
+    {
+        if (glm::abs(directionXZ[axis]) < 1e-12f)
+        {
+            if (originXZ[axis] < gridMin[axis] || originXZ[axis] > gridMax[axis])
+            {
+                return kNoItem;
+            }
+            continue;
+        }
+
+        float t0 = (gridMin[axis] - originXZ[axis]) / directionXZ[axis];
+        float t1 = (gridMax[axis] - originXZ[axis]) / directionXZ[axis];
+        tStart = std::max(tStart, std::min(t0, t1));
+        tEnd = std::min(tEnd, std::max(t0, t1));
+    }
+
+    if (!(tStart <= tEnd))
+    {
+        return kNoItem;
+    }
+
+    // side and up aren't unit length, hence the squared lengths below.
+    glm::vec3 side = basis.Side;
+    glm::vec3 up = basis.Up;
+    glm::vec3 normal = glm::cross(side, up);
+    float sideLengthSq = glm::dot(side, side);
+    float upLengthSq = glm::dot(up, up);
+
+    float denom = glm::dot(direction, normal);
+    if (glm::abs(denom) < 1e-6f)
+    {
+        return kNoItem;
+    }
+
+    // DDA over the cells under the clipped ray
+    glm::vec2 startXZ = originXZ + directionXZ * tStart;
+    glm::ivec2 cell = glm::clamp(glm::ivec2(glm::floor(startXZ / mCellSize)) - mOrigin,
+                                 glm::ivec2(0), mSize - 1);
+
+    glm::ivec2 step;
+    glm::vec2 tNextBoundary;
+    glm::vec2 tPerCell;
+    for (int axis = 0; axis < 2; axis++)
+    {
+        if (glm::abs(directionXZ[axis]) < 1e-12f)
+        {
+            step[axis] = 0;
+            tNextBoundary[axis] = INFINITY;
+            tPerCell[axis] = INFINITY;
+            continue;
+        }
+
+        step[axis] = directionXZ[axis] > 0.0f ? 1 : -1;
+        float boundary = (mOrigin[axis] + cell[axis] + (step[axis] > 0 ? 1 : 0)) * mCellSize;
+        tNextBoundary[axis] = (boundary - originXZ[axis]) / directionXZ[axis];
+        tPerCell[axis] = mCellSize / glm::abs(directionXZ[axis]);
+    }
+
+    uint32_t closestItem = kNoItem;
+    float closestT = INFINITY;
+
+    while (true)
+    {
+        size_t cellIndex = (size_t) cell.y * mSize.x + cell.x;
+        for (uint32_t i = mCellStarts[cellIndex]; i < mCellStarts[cellIndex + 1]; i++)
+        {
+            uint32_t itemIndex = mCellItems[i];
+            const Item& item = mItems[itemIndex];
+
+            glm::vec3 bottomLeft = item.Center
+                                 - side * (item.Dimensions.x / 2.0f)
+                                 - up * (item.Dimensions.y / 2.0f);
+
+            float tt = glm::dot(bottomLeft - origin, normal) / denom;
+            if (tt < 0.0f || tt >= closestT)
+            {
+                continue;
+            }
+
+            // fractions across and up the billboard
+            glm::vec3 offset = origin + tt * direction - bottomLeft;
+            float u = glm::dot(side, offset) / (sideLengthSq * item.Dimensions.x);
+            float v = glm::dot(up, offset) / (upLengthSq * item.Dimensions.y);
+            if (u < 0.0f || u > 1.0f || v < 0.0f || v > 1.0f)
+            {
+                continue;
+            }
+
+            closestItem = itemIndex;
+            closestT = tt;
+        }
+
+        // a hit point lies in a cell the ray has reached by then,
+        // so nothing in a later cell can be closer than a hit before this cell's exit.
+        float tExit = std::min(tNextBoundary.x, tNextBoundary.y);
+        if (closestT <= tExit || tExit > tEnd)
+        {
+            break;
+        }
+
+        int axis = tNextBoundary.x < tNextBoundary.y ? 0 : 1;
+        cell[axis] += step[axis];
+        if (cell[axis] < 0 || cell[axis] >= mSize[axis])
+        {
+            break;
+        }
+        tNextBoundary[axis] += tPerCell[axis];
+    }
+
+    if (closestItem != kNoItem)
+    {
+        t = closestT;
+    }
+    return closestItem;
+}
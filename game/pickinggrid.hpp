@@ -0,0 +1,66 @@
+#ifndef PICKINGGRID_HPP
+#define PICKINGGRID_HPP
+
+#include "geometry.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+// Uniform grid over the ground (the xz plane) to find which billboard is under the mouse
+// without testing all of them. Each billboard is registered in every cell its bounding
+// circle overlaps. A pick clips the ray to the height band the billboards live in,
+// walks the cells under that stretch of ray front to back, and stops at the first cell
+// that ends beyond the closest hit so far.
+//
+// All billboards face the same camera, so they share the plane basis passed to Pick.
+class PickingGrid
+{
+    struct Item
+    {
+        glm::vec3 Center;
+        glm::vec2 Dimensions;
+    };
+
+    float mCellSize;
+
+    std::vector<Item> mItems;
+
+    // cell of the grid's first column and row, and the grid's size in cells
+    glm::ivec2 mOrigin;
+    glm::ivec2 mSize;
+
+    // items of cell c are mCellItems[mCellStarts[c]] up to mCellItems[mCellStarts[c + 1]]
+    std::vector<uint32_t> mCellStarts;
+    std::vector<uint32_t> mCellItems;
+
+    float mMinY;
+    float mMaxY;
+
+    bool mIsDirty = true;
+
+    float GetBoundingRadius(const Item& item) const;
+
+public:
+    static const uint32_t kNoItem = UINT32_MAX;
+
+    PickingGrid(float cellSize = 1.0f);
+
+    // Items are identified by their index, in the order they were added.
+    void Clear();
+    uint32_t AddItem(glm::vec3 centerPosition, glm::vec2 dimensions);
+    void SetItem(uint32_t item, glm::vec3 centerPosition, glm::vec2 dimensions);
+    size_t GetItemCount() const { return mItems.size(); }
+
+    // Builds the cells from the items. Called by Pick if items changed since the last build.
+    void Rebuild();
+
+    // Returns the item hit closest to the ray's origin, or kNoItem.
+    // t is in units of direction, like RayParallelogramIntersect.
+    uint32_t Pick(glm::vec3 origin, glm::vec3 direction,
+                  const BillboardBasis& basis,
+                  float& t);
+};
+
+#endif // PICKINGGRID_HPP
@@ -0,0 +1,350 @@
+// Renders the world scene offscreen and reports what each frame asked of GL.
+// Uses a surfaceless EGL context, so it runs without a display, for example on Mesa's llvmpipe:
+//   EGL_PLATFORM=surfaceless LIBGL_ALWAYS_SOFTWARE=1 ./game_renderbench
+
+#include "worldscene.hpp"
+#include "rendercontext.hpp"
+
+#include <Profiler.hpp>
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct RenderBenchOptions
+{
+    bool Infinite = false;
+    int MoundsPerRow = 0;
+    unsigned int Frames = 300;
+    // one random mound clicked every this many frames, 0 for none
+    unsigned int ClickInterval = 30;
+    int Width = 640;
+    int Height = 480;
+    std::string ScreenshotFile;
+    std::string TraceFile;
+    // GLplus::ErrorCheckModeFromString names, empty for the build's default
+    std::string GLErrorCheckMode;
+};
+
+static const char* kUsage =
+    "usage: game_renderbench [options]\n"
+    "  --infinite               render the unbounded board's window\n"
+    "  --mounds-per-row <N>     board is N x N mounds\n"
+    "  --frames <N>             frames to render, orbiting the camera\n"
+    "  --click-interval <N>     click a random mound every N frames (0: never)\n"
+    "  --size <WxH>             framebuffer size\n"
+    "  --screenshot <file>      write the last frame as a binary PPM\n"
+    "  --trace <file>           write profiler zones as a Chrome trace\n"
+    "  --gl-errors <mode>       every-call, per-frame, debug-callback or off (default: the build's)\n";
+
+static RenderBenchOptions ParseRenderBenchOptions(int argc, char* argv[])
+{
+    RenderBenchOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        auto nextValue = [&]() -> const char* {
+            if (i + 1 >= argc)
+            {
+                throw std::runtime_error(std::string("Missing value for ") + arg);
+            }
+            return argv[++i];
+        };
+
+        if (!strcmp(arg, "--infinite"))
+        {
+            options.Infinite = true;
+        }
+        else if (!strcmp(arg, "--mounds-per-row"))
+        {
+            options.MoundsPerRow = std::stoi(nextValue());
+        }
+        else if (!strcmp(arg, "--frames"))
+        {
+            options.Frames = std::stoul(nextValue());
+        }
+        else if (!strcmp(arg, "--click-interval"))
+        {
+            options.ClickInterval = std::stoul(nextValue());
+        }
+        else if (!strcmp(arg, "--size"))
+        {
+            std::string value = nextValue();
+            size_t separator = value.find('x');
+            if (separator == std::string::npos)
+            {
+                throw std::runtime_error("--size needs WxH");
+            }
+            options.Width = std::stoi(value.substr(0, separator));
+            options.Height = std::stoi(value.substr(separator + 1));
+        }
+        else if (!strcmp(arg, "--screenshot"))
+        {
+            options.ScreenshotFile = nextValue();
+        }
+        else if (!strcmp(arg, "--trace"))
+        {
+            options.TraceFile = nextValue();
+        }
+        else if (!strcmp(arg, "--gl-errors"))
+        {
+            options.GLErrorCheckMode = nextValue();
+            GLplus::ErrorCheckModeFromString(options.GLErrorCheckMode.c_str());
+        }
+        else if (!strcmp(arg, "--help"))
+        {
+            printf("%s", kUsage);
+            exit(0);
+        }
+        else
+        {
+            fprintf(stderr, "%s", kUsage);
+            throw std::runtime_error(std::string("Unknown argument: ") + arg);
+        }
+    }
+
+    return options;
+}
+
+static void WriteScreenshot(const char* filename, int width, int height)
+{
+    std::vector<unsigned char> pixels((size_t) width * height * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    GLplus::CheckGLErrors();
+
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        throw std::runtime_error(std::string("Couldn't open ") + filename);
+    }
+
+    // GL rows go bottom to top, PPM rows top to bottom.
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    for (int y = height - 1; y >= 0; y--)
+    {
+        fwrite(&pixels[(size_t) y * width * 3], 1, (size_t) width * 3, file);
+    }
+    fclose(file);
+}
+
+// GL 3.3 core context with no surface. Everything is drawn into a framebuffer object.
+class OffscreenContext
+{
+    EGLDisplay mDisplay = EGL_NO_DISPLAY;
+    EGLContext mContext = EGL_NO_CONTEXT;
+
+public:
+    // a debug context, so KHR_debug reports everything it can
+    OffscreenContext(bool debug)
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+                (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+        mDisplay = getPlatformDisplay ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL)
+                                      : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        EGLint major, minor;
+        if (mDisplay == EGL_NO_DISPLAY || !eglInitialize(mDisplay, &major, &minor))
+        {
+            throw std::runtime_error("Couldn't initialize EGL");
+        }
+
+        if (!eglBindAPI(EGL_OPENGL_API))
+        {
+            throw std::runtime_error("EGL has no desktop OpenGL");
+        }
+
+        EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLConfig config;
+        EGLint numConfigs = 0;
+        eglChooseConfig(mDisplay, configAttributes, &config, 1, &numConfigs);
+
+        EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_CONTEXT_OPENGL_DEBUG, debug ? EGL_TRUE : EGL_FALSE,
+            EGL_NONE
+        };
+        mContext = eglCreateContext(mDisplay, numConfigs ? config : (EGLConfig) 0, EGL_NO_CONTEXT, contextAttributes);
+        if (mContext == EGL_NO_CONTEXT || !eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, mContext))
+        {
+            eglTerminate(mDisplay);
+            throw std::runtime_error("Couldn't create a surfaceless GL 3.3 context");
+        }
+
+        glewExperimental = GL_TRUE;
+        GLenum glewError = glewInit();
+        if (glewError != GLEW_OK)
+        {
+            throw std::runtime_error((const char*) glewGetErrorString(glewError));
+        }
+
+        // same as SDL2plus: glewInit can leave a GL_INVALID_ENUM behind.
+        while (glGetError() != GL_NO_ERROR);
+    }
+
+    ~OffscreenContext()
+    {
+        eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(mDisplay, mContext);
+        eglTerminate(mDisplay);
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        RenderBenchOptions options = ParseRenderBenchOptions(argc, argv);
+
+        OffscreenContext context(options.GLErrorCheckMode == "debug-callback");
+        printf("renderer: %s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+
+        if (!options.GLErrorCheckMode.empty())
+        {
+            GLplus::SetErrorCheckMode(GLplus::ErrorCheckModeFromString(options.GLErrorCheckMode.c_str()));
+        }
+
+        GLplus::FrameStats::SetCollecting(true);
+
+        std::shared_ptr<GLplus::FrameBuffer> pFrameBuffer(new GLplus::FrameBuffer());
+        {
+            std::shared_ptr<GLplus::RenderBuffer> pColor(new GLplus::RenderBuffer());
+            std::shared_ptr<GLplus::RenderBuffer> pDepth(new GLplus::RenderBuffer());
+            GLplus::ScopedRenderBufferBinding(*pColor).GetBinding().CreateStorage(GL_RGBA8, options.Width, options.Height);
+            GLplus::ScopedRenderBufferBinding(*pDepth).GetBinding().CreateStorage(GL_DEPTH_COMPONENT24, options.Width, options.Height);
+
+            GLplus::ScopedFrameBufferBinding scopedFrameBuffer(*pFrameBuffer, GL_FRAMEBUFFER);
+            scopedFrameBuffer.GetBinding().Attach(GL_COLOR_ATTACHMENT0, pColor);
+            scopedFrameBuffer.GetBinding().Attach(GL_DEPTH_ATTACHMENT, pDepth);
+            scopedFrameBuffer.GetBinding().ValidateStatus();
+        }
+
+        RenderContext renderContext;
+        renderContext.CurrentFrameBuffer = pFrameBuffer;
+        renderContext.CurrentViewport = Viewport(glm::ivec2(0), glm::ivec2(options.Width, options.Height));
+
+        WorldScene scene(options.Infinite, options.MoundsPerRow);
+        std::default_random_engine clickEngine(0);
+
+        GLplus::ScopedFrameBufferBinding scopedFrameBuffer(*pFrameBuffer, GL_FRAMEBUFFER);
+        glViewport(0, 0, options.Width, options.Height);
+
+        GLplus::FrameStats setupGLStats = GLplus::FrameStats::EndFrame();
+        if (setupGLStats.IsCollected)
+        {
+            printf("setup: %zu GL calls, %zu buffer bytes, %zu texture bytes\n",
+                   setupGLStats.Calls, setupGLStats.BufferBytesUploaded, setupGLStats.TextureBytesLoaded);
+        }
+
+        GLplus::FrameStats totalGL;
+        GLplus::FrameStats lastFrameGL;
+
+        BillboardBatchStats total;
+        BillboardBatchStats maxPerFrame;
+        double totalMilliseconds = 0.0;
+
+        for (unsigned int frame = 0; frame < options.Frames; frame++)
+        {
+            PROFILE_FRAME();
+
+            if (options.ClickInterval && frame % options.ClickInterval == options.ClickInterval - 1)
+            {
+                std::uniform_int_distribution<size_t> moundDist(0, scene.GetMoundCount() - 1);
+                scene.ClickMound(moundDist(clickEngine));
+            }
+
+            scene.OrbitCamera(0.01f);
+
+            auto start = std::chrono::steady_clock::now();
+
+            glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            scene.Render(renderContext, 0.0f);
+            glFinish();
+            GLplus::CheckFrameErrors();
+
+            auto end = std::chrono::steady_clock::now();
+
+            lastFrameGL = GLplus::FrameStats::EndFrame();
+
+            // the first frame uploads every instance, so it's reported on its own.
+            BillboardBatchStats stats = scene.GetBillboardStats();
+            if (frame == 0)
+            {
+                printf("first frame: %zu draws, %zu uploads, %zu bytes\n",
+                       stats.DrawCalls, stats.BufferUploads, stats.BytesUploaded);
+                continue;
+            }
+
+            total += stats;
+            totalGL.Calls += lastFrameGL.Calls;
+            totalGL.DrawCalls += lastFrameGL.DrawCalls;
+            totalGL.Binds += lastFrameGL.Binds;
+            totalGL.Queries += lastFrameGL.Queries;
+            totalGL.ErrorChecks += lastFrameGL.ErrorChecks;
+            totalGL.UniformUploads += lastFrameGL.UniformUploads;
+            totalGL.BufferBytesUploaded += lastFrameGL.BufferBytesUploaded;
+            maxPerFrame.DrawCalls = std::max(maxPerFrame.DrawCalls, stats.DrawCalls);
+            maxPerFrame.TextureBinds = std::max(maxPerFrame.TextureBinds, stats.TextureBinds);
+            maxPerFrame.BufferUploads = std::max(maxPerFrame.BufferUploads, stats.BufferUploads);
+            maxPerFrame.BytesUploaded = std::max(maxPerFrame.BytesUploaded, stats.BytesUploaded);
+            totalMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+
+        if (!options.ScreenshotFile.empty())
+        {
+            WriteScreenshot(options.ScreenshotFile.c_str(), options.Width, options.Height);
+        }
+
+        if (!options.TraceFile.empty())
+        {
+            size_t numZones = Profiler::WriteChromeTrace(options.TraceFile.c_str());
+            printf("wrote %zu profiler zones to %s\n", numZones, options.TraceFile.c_str());
+        }
+
+        double frames = std::max(options.Frames, 2u) - 1;
+        printf("%u frames of %zu mounds\n", options.Frames, scene.GetMoundCount());
+        printf("%-24s %12s %12s\n", "billboard pass", "per frame", "max");
+        printf("%-24s %12.2f %12zu\n", "draw calls", total.DrawCalls / frames, maxPerFrame.DrawCalls);
+        printf("%-24s %12.2f %12s\n", "instances drawn", total.InstancesDrawn / frames, "");
+        printf("%-24s %12.2f %12zu\n", "texture binds", total.TextureBinds / frames, maxPerFrame.TextureBinds);
+        printf("%-24s %12.2f %12zu\n", "buffer uploads", total.BufferUploads / frames, maxPerFrame.BufferUploads);
+        printf("%-24s %12.2f %12zu\n", "bytes uploaded", total.BytesUploaded / frames, maxPerFrame.BytesUploaded);
+        printf("%-24s %12.3f\n", "ms per frame", totalMilliseconds / frames);
+
+        if (lastFrameGL.IsCollected)
+        {
+            printf("%-24s %12s\n", "GLplus", "per frame");
+            printf("%-24s %12.2f\n", "GL calls", totalGL.Calls / frames);
+            printf("%-24s %12.2f\n", "draws", totalGL.DrawCalls / frames);
+            printf("%-24s %12.2f\n", "binds", totalGL.Binds / frames);
+            printf("%-24s %12.2f\n", "queries", totalGL.Queries / frames);
+            printf("%-24s %12.2f\n", "error checks", totalGL.ErrorChecks / frames);
+            printf("%-24s %12.2f\n", "uniform uploads", totalGL.UniformUploads / frames);
+            printf("%-24s %12.2f\n", "buffer bytes uploaded", totalGL.BufferBytesUploaded / frames);
+            printf("last frame:\n");
+            fflush(stdout);
+            lastFrameGL.Dump(std::cout, 12);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Fatal exception: %s\n", e.what());
+        return 1;
+    }
+}
@@ -14,6 +14,9 @@ public:
     virtual void Update(unsigned int deltaTimeMS) = 0;
 
     virtual void Render(RenderContext& renderContext, float partialUpdatePercentage) = 0;
+
+    // Whether a Render now would show anything new. Lets the main loop sleep instead of redrawing.
+    virtual bool IsRedrawNeeded() const { return true; }
 };
 
 #endif // SCENE_HPP
@@ -0,0 +1,423 @@
+// Stress test for the board rules: an automatic player plays many games
+// on every core and reports throughput, win rate and how it scales with threads.
+
+#include "board.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct SelfPlayOptions
+{
+    int BoardWidth = 16;
+    int BoardHeight = 16;
+    int MineCount = 40;
+    unsigned int Seed = 0;
+    size_t Games = 100000;
+    unsigned int MaxThreads = 0; // 0 means one per hardware core
+};
+
+// Plays a single board with simple local deductions, guessing when it's stuck.
+// Owns its scratch buffers so games after the first don't allocate.
+class AutoPlayer
+{
+    Board& mBoard;
+    std::default_random_engine mGuessEngine;
+
+    std::vector<uint32_t> mChangedCells;
+    std::vector<uint32_t> mToExamine;
+
+    template<class Visitor>
+    void ForEachNeighbor(size_t cellIndex, Visitor visit) const
+    {
+        const Minefield& minefield = mBoard.GetMinefield();
+        int width = minefield.GetWidth();
+        int height = minefield.GetHeight();
+        int cy = cellIndex / width;
+        int cx = cellIndex - (size_t) cy * width;
+
+        for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, height - 1); y++)
+        {
+            for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, width - 1); x++)
+            {
+                if (!(x == cx && y == cy))
+                {
+                    visit((size_t) y * width + x);
+                }
+            }
+        }
+    }
+
+    // Queues the uncovered mounds around a change, since their deductions may have changed too.
+    void QueueAround(size_t cellIndex)
+    {
+        const Minefield& minefield = mBoard.GetMinefield();
+        ForEachNeighbor(cellIndex, [&](size_t neighbor) {
+            if (minefield.GetState(neighbor) == MoundState::Uncovered &&
+                minefield.GetAdjacentMineCount(neighbor) > 0)
+            {
+                mToExamine.push_back(neighbor);
+            }
+        });
+    }
+
+    // Returns false if the click hit a mine.
+    bool Click(size_t cellIndex)
+    {
+        if (mBoard.Click(cellIndex, mChangedCells) == RevealResult::HitMine)
+        {
+            return false;
+        }
+
+        for (uint32_t changed : mChangedCells)
+        {
+            mToExamine.push_back(changed);
+            QueueAround(changed);
+        }
+
+        return true;
+    }
+
+    size_t PickGuess()
+    {
+        const Minefield& minefield = mBoard.GetMinefield();
+        std::uniform_int_distribution<size_t> uniformDist(0, minefield.GetCellCount() - 1);
+
+        size_t start = uniformDist(mGuessEngine);
+        for (size_t i = 0; i < minefield.GetCellCount(); i++)
+        {
+            size_t candidate = (start + i) % minefield.GetCellCount();
+            if (minefield.GetState(candidate) == MoundState::Untouched)
+            {
+                return candidate;
+            }
+        }
+
+        throw std::logic_error("No mound left to guess");
+    }
+
+public:
+    AutoPlayer(Board& board)
+        : mBoard(board)
+    { }
+
+    // Plays the board from its current state until it is won or lost.
+    bool Play(unsigned int seed)
+    {
+        const Minefield& minefield = mBoard.GetMinefield();
+        mGuessEngine.seed(seed);
+        mToExamine.clear();
+
+        while (!mBoard.IsCleared())
+        {
+            if (mToExamine.empty())
+            {
+                if (!Click(PickGuess()))
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            size_t cell = mToExamine.back();
+            mToExamine.pop_back();
+
+            int untouched = 0;
+            int flagged = 0;
+            ForEachNeighbor(cell, [&](size_t neighbor) {
+                MoundState state = minefield.GetState(neighbor);
+                if (state == MoundState::Untouched) untouched++;
+                else if (state == MoundState::Flagged) flagged++;
+            });
+
+            if (untouched == 0)
+            {
+                continue;
+            }
+
+            int mines = minefield.GetAdjacentMineCount(cell);
+
+            if (flagged == mines)
+            {
+                // every mine around here is found, so the rest are safe.
+                bool alive = true;
+                ForEachNeighbor(cell, [&](size_t neighbor) {
+                    if (alive && minefield.GetState(neighbor) == MoundState::Untouched)
+                    {
+                        alive = Click(neighbor);
+                    }
+                });
+
+                if (!alive)
+                {
+                    return false;
+                }
+            }
+            else if (flagged + untouched == mines)
+            {
+                // every covered mound around here must be a mine.
+                ForEachNeighbor(cell, [&](size_t neighbor) {
+                    if (minefield.GetState(neighbor) == MoundState::Untouched)
+                    {
+                        mBoard.ToggleFlag(neighbor);
+                        QueueAround(neighbor);
+                    }
+                });
+            }
+        }
+
+        return true;
+    }
+};
+
+struct GameRange
+{
+    size_t First;
+    size_t Count;
+};
+
+struct WorkerQueue
+{
+    std::mutex Mutex;
+    std::deque<GameRange> Ranges;
+};
+
+struct WorkerStats
+{
+    size_t GamesPlayed = 0;
+    size_t GamesWon = 0;
+    size_t RangesStolen = 0;
+};
+
+// Owners take ranges from the front of their own queue, thieves take from the back.
+static bool TakeRange(WorkerQueue& queue, bool steal, GameRange& range)
+{
+    std::lock_guard<std::mutex> lock(queue.Mutex);
+    if (queue.Ranges.empty())
+    {
+        return false;
+    }
+
+    if (steal)
+    {
+        range = queue.Ranges.back();
+        queue.Ranges.pop_back();
+    }
+    else
+    {
+        range = queue.Ranges.front();
+        queue.Ranges.pop_front();
+    }
+    return true;
+}
+
+static void RunWorker(const SelfPlayOptions& options,
+                      std::vector<WorkerQueue>& queues, size_t workerIndex,
+                      WorkerStats& result)
+{
+    // counted here and stored once at the end, so workers don't write to neighbouring
+    // counters, sharing cache lines, after every game.
+    WorkerStats stats;
+    // every worker already has a core of its own, so its boards are generated on it alone.
+    Board board(options.BoardWidth, options.BoardHeight, options.MineCount, options.Seed, 1);
+    AutoPlayer player(board);
+
+    while (true)
+    {
+        GameRange range;
+        bool found = TakeRange(queues[workerIndex], false, range);
+        for (size_t i = 1; !found && i < queues.size(); i++)
+        {
+            found = TakeRange(queues[(workerIndex + i) % queues.size()], true, range);
+            stats.RangesStolen += found;
+        }
+
+        if (!found)
+        {
+            result = stats;
+            return;
+        }
+
+        for (size_t game = range.First; game < range.First + range.Count; game++)
+        {
+            // every game's layout and guesses depend only on its id, not on which thread plays it.
+            board.Reset(game);
+            stats.GamesWon += player.Play(options.Seed + (unsigned int) game * 2654435761u);
+            stats.GamesPlayed++;
+        }
+    }
+}
+
+struct RunResult
+{
+    double Seconds;
+    size_t GamesPlayed;
+    size_t GamesWon;
+    size_t RangesStolen;
+};
+
+static RunResult RunSelfPlay(const SelfPlayOptions& options, unsigned int numThreads)
+{
+    static const size_t kGamesPerRange = 64;
+
+    std::vector<WorkerQueue> queues(numThreads);
+    size_t rangeIndex = 0;
+    for (size_t first = 0; first < options.Games; first += kGamesPerRange, rangeIndex++)
+    {
+        GameRange range;
+        range.First = first;
+        range.Count = std::min(kGamesPerRange, options.Games - first);
+        queues[rangeIndex % numThreads].Ranges.push_back(range);
+    }
+
+    std::vector<WorkerStats> stats(numThreads);
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned int i = 0; i < numThreads; i++)
+    {
+        workers.emplace_back(RunWorker, std::cref(options), std::ref(queues), i, std::ref(stats[i]));
+    }
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    RunResult result;
+    result.Seconds = std::chrono::duration<double>(end - start).count();
+    result.GamesPlayed = 0;
+    result.GamesWon = 0;
+    result.RangesStolen = 0;
+    for (const WorkerStats& workerStats : stats)
+    {
+        result.GamesPlayed += workerStats.GamesPlayed;
+        result.GamesWon += workerStats.GamesWon;
+        result.RangesStolen += workerStats.RangesStolen;
+    }
+    return result;
+}
+
+static const char* kUsage =
+    "usage: game_selfplay [options]\n"
+    "  --board-size <N | WxH>   board dimensions in mounds\n"
+    "  --mines <N>              number of mines\n"
+    "  --seed <N>               base seed for every game\n"
+    "  --games <N>              games to play for each thread count\n"
+    "  --threads <N>            highest thread count to measure (default: all cores)\n";
+
+static SelfPlayOptions ParseSelfPlayOptions(int argc, char* argv[])
+{
+    SelfPlayOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        auto nextValue = [&]() -> const char* {
+            if (i + 1 >= argc)
+            {
+                throw std::runtime_error(std::string("Missing value for ") + arg);
+            }
+            return argv[++i];
+        };
+
+        if (!strcmp(arg, "--board-size"))
+        {
+            std::string value = nextValue();
+            size_t separator = value.find('x');
+            options.BoardWidth = std::stoi(value.substr(0, separator));
+            options.BoardHeight = separator == std::string::npos ? options.BoardWidth
+                                                                 : std::stoi(value.substr(separator + 1));
+        }
+        else if (!strcmp(arg, "--mines"))
+        {
+            options.MineCount = std::stoi(nextValue());
+        }
+        else if (!strcmp(arg, "--seed"))
+        {
+            options.Seed = std::stoul(nextValue());
+        }
+        else if (!strcmp(arg, "--games"))
+        {
+            options.Games = std::stoull(nextValue());
+        }
+        else if (!strcmp(arg, "--threads"))
+        {
+            options.MaxThreads = std::stoul(nextValue());
+        }
+        else if (!strcmp(arg, "--help"))
+        {
+            printf("%s", kUsage);
+            exit(0);
+        }
+        else
+        {
+            fprintf(stderr, "%s", kUsage);
+            throw std::runtime_error(std::string("Unknown argument: ") + arg);
+        }
+    }
+
+    return options;
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        SelfPlayOptions options = ParseSelfPlayOptions(argc, argv);
+
+        unsigned int maxThreads = options.MaxThreads;
+        if (maxThreads == 0)
+        {
+            maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        // 1, 2, 4, ... up to and including the maximum
+        std::vector<unsigned int> threadCounts;
+        for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+        {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(maxThreads);
+
+        printf("board %dx%d, %d mines, %zu games per run\n",
+               options.BoardWidth, options.BoardHeight, options.MineCount, options.Games);
+        printf("%8s %14s %10s %9s %8s\n", "threads", "games/s", "win rate", "speedup", "steals");
+
+        double baseline = 0.0;
+        for (unsigned int threads : threadCounts)
+        {
+            RunResult result = RunSelfPlay(options, threads);
+
+            double gamesPerSecond = result.GamesPlayed / result.Seconds;
+            if (baseline == 0.0)
+            {
+                baseline = gamesPerSecond;
+            }
+
+            printf("%8u %14.1f %9.2f%% %8.2fx %8zu\n",
+                   threads, gamesPerSecond,
+                   100.0 * result.GamesWon / std::max<size_t>(result.GamesPlayed, 1),
+                   gamesPerSecond / baseline, result.RangesStolen);
+            fflush(stdout);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Fatal exception: %s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,176 @@
+#include "spriteatlas.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+
+static const char kMagic[4] = { 'S', 'P', 'A', 'T' };
+
+// byte by byte, so the file reads the same whatever the host's byte order.
+static void WriteU32(std::ostream& out, uint32_t value)
+{
+    char bytes[4];
+    for (int i = 0; i < 4; i++)
+    {
+        bytes[i] = (char) ((value >> (8 * i)) & 0xFF);
+    }
+    out.write(bytes, 4);
+}
+
+static void WriteF32(std::ostream& out, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    WriteU32(out, bits);
+}
+
+static uint32_t ReadU32(std::istream& in)
+{
+    unsigned char bytes[4];
+    if (!in.read((char*) bytes, 4))
+    {
+        throw std::runtime_error("Sprite atlas table is truncated");
+    }
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+static float ReadF32(std::istream& in)
+{
+    uint32_t bits = ReadU32(in);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+SpriteAtlas::SpriteAtlas(glm::ivec2 size)
+    : mSize(size)
+{ }
+
+SpriteAtlas SpriteAtlas::FromFile(const char* filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+    {
+        throw std::runtime_error(std::string("Failed to open ") + filename);
+    }
+
+    char magic[4];
+    if (!in.read(magic, 4) || memcmp(magic, kMagic, 4) != 0)
+    {
+        throw std::runtime_error(std::string(filename) + " is not a sprite atlas table");
+    }
+
+    uint32_t version = ReadU32(in);
+    if (version != kVersion)
+    {
+        throw std::runtime_error(std::string(filename) + " has an unsupported version, rebuild the atlas");
+    }
+
+    SpriteAtlas atlas;
+    atlas.mSize.x = (int) ReadU32(in);
+    atlas.mSize.y = (int) ReadU32(in);
+
+    uint32_t count = ReadU32(in);
+    atlas.mSprites.resize(count);
+    for (Sprite& sprite : atlas.mSprites)
+    {
+        char nameLength;
+        if (!in.get(nameLength))
+        {
+            throw std::runtime_error("Sprite atlas table is truncated");
+        }
+
+        sprite.Name.resize((unsigned char) nameLength);
+        if (!in.read(&sprite.Name[0], sprite.Name.size()))
+        {
+            throw std::runtime_error("Sprite atlas table is truncated");
+        }
+
+        sprite.Position.x = (int) ReadU32(in);
+        sprite.Position.y = (int) ReadU32(in);
+        sprite.Size.x = (int) ReadU32(in);
+        sprite.Size.y = (int) ReadU32(in);
+        for (int i = 0; i < 4; i++)
+        {
+            sprite.UVRect[i] = ReadF32(in);
+        }
+    }
+
+    return atlas;
+}
+
+void SpriteAtlas::WriteFile(const char* filename) const
+{
+    std::ofstream out(filename, std::ios::binary);
+    if (!out)
+    {
+        throw std::runtime_error(std::string("Failed to open ") + filename + " for writing");
+    }
+
+    out.write(kMagic, 4);
+    WriteU32(out, kVersion);
+    WriteU32(out, (uint32_t) mSize.x);
+    WriteU32(out, (uint32_t) mSize.y);
+    WriteU32(out, (uint32_t) mSprites.size());
+
+    for (const Sprite& sprite : mSprites)
+    {
+        out.put((char) sprite.Name.size());
+        out.write(sprite.Name.data(), sprite.Name.size());
+        WriteU32(out, (uint32_t) sprite.Position.x);
+        WriteU32(out, (uint32_t) sprite.Position.y);
+        WriteU32(out, (uint32_t) sprite.Size.x);
+        WriteU32(out, (uint32_t) sprite.Size.y);
+        for (int i = 0; i < 4; i++)
+        {
+            WriteF32(out, sprite.UVRect[i]);
+        }
+    }
+
+    if (!out)
+    {
+        throw std::runtime_error(std::string("Failed to write ") + filename);
+    }
+}
+
+size_t SpriteAtlas::AddSprite(const std::string& name, glm::ivec2 position, glm::ivec2 size)
+{
+    if (name.size() > 255)
+    {
+        throw std::invalid_argument("Sprite name too long: " + name);
+    }
+
+    if (position.x < 0 || position.y < 0 ||
+        position.x + size.x > mSize.x || position.y + size.y > mSize.y)
+    {
+        throw std::out_of_range("Sprite " + name + " is outside the atlas");
+    }
+
+    Sprite sprite;
+    sprite.Name = name;
+    sprite.Position = position;
+    sprite.Size = size;
+
+    // the atlas is loaded upside down, so the sprite's top row is its highest v.
+    glm::vec2 atlasSize(mSize);
+    sprite.UVRect = glm::vec4(position.x / atlasSize.x,
+                              1.0f - (position.y + size.y) / atlasSize.y,
+                              (position.x + size.x) / atlasSize.x,
+                              1.0f - position.y / atlasSize.y);
+
+    mSprites.push_back(sprite);
+    return mSprites.size() - 1;
+}
+
+size_t SpriteAtlas::GetSpriteIndex(const std::string& name) const
+{
+    for (size_t i = 0; i < mSprites.size(); i++)
+    {
+        if (mSprites[i].Name == name)
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("No sprite named " + name + " in atlas");
+}
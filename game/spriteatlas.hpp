@@ -0,0 +1,55 @@
+#ifndef SPRITEATLAS_HPP
+#define SPRITEATLAS_HPP
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Table of where each sprite sits in the atlas image made by atlas_packer.
+// Has no GL in it, so the packer writes the same table the game reads.
+//
+// File layout, all integers and floats little-endian:
+//   "SPAT", u32 version, u32 atlas width, u32 atlas height, u32 sprite count,
+//   then per sprite: u8 name length, the name's bytes,
+//                    u32 x, y, width, height in pixels from the image's top-left,
+//                    f32 u0, v0, u1, v1 texture coordinates of the sprite's corners.
+// The texture coordinates have v going up, for an atlas loaded with Texture2D::InvertY.
+class SpriteAtlas
+{
+public:
+    struct Sprite
+    {
+        std::string Name;
+        glm::ivec2 Position;
+        glm::ivec2 Size;
+        // bottom-left uv in xy, top-right uv in zw
+        glm::vec4 UVRect;
+    };
+
+private:
+    glm::ivec2 mSize;
+    std::vector<Sprite> mSprites;
+
+public:
+    static const uint32_t kVersion = 1;
+
+    static SpriteAtlas FromFile(const char* filename);
+
+    SpriteAtlas(glm::ivec2 size = glm::ivec2(0));
+
+    void WriteFile(const char* filename) const;
+
+    // Returns the new sprite's index. Position is the top-left pixel of the sprite in the atlas.
+    size_t AddSprite(const std::string& name, glm::ivec2 position, glm::ivec2 size);
+
+    glm::ivec2 GetSize() const { return mSize; }
+    size_t GetSpriteCount() const { return mSprites.size(); }
+    const Sprite& GetSprite(size_t index) const { return mSprites.at(index); }
+
+    // Throws if there's no sprite of that name.
+    size_t GetSpriteIndex(const std::string& name) const;
+};
+
+#endif // SPRITEATLAS_HPP
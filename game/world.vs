@@ -1,15 +1,53 @@
 #version 150
 
-in vec4 position;
+// models
+in vec3 position;
 in vec2 texcoord0;
 
-uniform mat4 modelview;
-uniform mat4 projection;
+// StaticMesh::Render sets these to undo position quantization
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+// billboards: one corner of the unit quad per vertex, the rest once per billboard
+in vec2 corner;
+in vec3 instanceCenter;
+in vec2 instanceDimensions;
+in float instanceSprite;
+
+// shared by every program, written once a frame. CameraBlock in worldscene.hpp must match.
+layout(std140) uniform Camera
+{
+    mat4 projection;
+    mat4 modelview;
+};
+
+// set by BillboardBatch::Render, which draws with the billboard attributes instead of the model ones.
+uniform bool billboardMode;
+
+// camera side and up, same for every billboard
+uniform vec3 billboardSide;
+uniform vec3 billboardUp;
+
+// uv rectangle of each sprite in the atlas: bottom-left in xy, top-right in zw.
+// BillboardBatch::kMaxSprites must match.
+uniform vec4 spriteRects[32];
 
 out vec2 ftexcoord0;
 
 void main()
 {
-    ftexcoord0 = texcoord0;
-    gl_Position = projection * modelview * position;
+    if (billboardMode)
+    {
+        vec2 offset = (corner - vec2(0.5)) * instanceDimensions;
+        vec3 center = instanceCenter + billboardSide * offset.x + billboardUp * offset.y;
+
+        vec4 rect = spriteRects[int(instanceSprite)];
+        ftexcoord0 = mix(rect.xy, rect.zw, corner);
+        gl_Position = projection * modelview * vec4(center, 1.0);
+    }
+    else
+    {
+        ftexcoord0 = texcoord0;
+        gl_Position = projection * modelview * vec4(position * positionScale + positionOffset, 1.0);
+    }
 }
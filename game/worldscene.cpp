@@ -1,99 +1,95 @@
 #include "worldscene.hpp"
 
 #include "rendercontext.hpp"
-#include "geometry.hpp"
 
 #include <SDL2plus.hpp>
+#include <Profiler.hpp>
 
-#include <tiny_obj_loader.h>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <random>
 #include <algorithm>
 #include <stdexcept>
-#include <set>
 
-WorldScene::WorldScene()
+WorldScene::WorldScene(bool infiniteBoard, int moundsPerRow)
 {
-    mpModelProgram.reset(new GLplus::Program(GLplus::Program::FromFiles("world.vs","world.fs")));
-    mpDebugProgram.reset(new GLplus::Program(GLplus::Program::FromFiles("debug.vs","debug.fs")));
+    PROFILE_ZONE("WorldScene::WorldScene");
 
-    std::vector<tinyobj::shape_t> worldShapes;
-    tinyobj::LoadObj(worldShapes, "floor.obj");
-    if (worldShapes.empty())
-    {
-        throw std::runtime_error("floor model not available");
-    }
+    mpWorldProgram.reset(new GLplus::Program(GLplus::Program::FromFiles("world.vs","world.fs")));
+    mpDebugProgram.reset(new GLplus::Program(GLplus::Program::FromFiles("debug.vs","debug.fs")));
+    mpCameraBuffer.reset(new GLplus::UniformBuffer("Camera", sizeof(CameraBlock)));
 
+    // converted from floor.obj at build time by obj_to_glmesh.
     mpWorldMesh.reset(new GLmesh::StaticMesh());
-    mpWorldMesh->LoadShape(worldShapes[0]);
+    mpWorldMesh->LoadFile("floor.glmesh");
 
-    mpPlayerTexture.reset(new GLplus::Texture2D());
-    float playerAspect;
-    {
-        GLplus::ScopedTexture2DBinding scopedTextureBind(*mpPlayerTexture);
-        GLplus::Texture2DBinding& textureBind = scopedTextureBind.GetBinding();
-
-        textureBind.LoadImage("player.png", GLplus::Texture2D::InvertY);
-        playerAspect = (float) textureBind.GetWidth() / textureBind.GetHeight();
-    }
+    // every sprite is in one atlas, packed at build time by atlas_packer.
+    SpriteAtlas spriteAtlas = SpriteAtlas::FromFile("sprites.atlas");
 
-    mpMoundTexture.reset(new GLplus::Texture2D());
-    float moundAspect;
+    std::shared_ptr<GLplus::Texture2D> pAtlasTexture(new GLplus::Texture2D());
     {
-        GLplus::ScopedTexture2DBinding scopedTextureBind(*mpMoundTexture);
-        GLplus::Texture2DBinding& textureBind = scopedTextureBind.GetBinding();
-
-        textureBind.LoadImage("mound.png", GLplus::Texture2D::InvertY);
-        moundAspect = (float) textureBind.GetWidth() / textureBind.GetHeight();
+        GLplus::ScopedTexture2DBinding scopedTextureBind(*pAtlasTexture);
+        scopedTextureBind.GetBinding().LoadImage("sprites.png", GLplus::Texture2D::InvertY);
     }
 
+    mpBillboardBatch.reset(new BillboardBatch(pAtlasTexture, spriteAtlas));
+
+    int playerSprite = (int) spriteAtlas.GetSpriteIndex("player");
+    mCoveredMoundSprite = (int) spriteAtlas.GetSpriteIndex("mound");
     for (int number = 0; number < 9; number++)
     {
-        mMoundNumberTextures.emplace_back(new GLplus::Texture2D());
-        GLplus::ScopedTexture2DBinding scopedTextureBind(*mMoundNumberTextures.back());
-        GLplus::Texture2DBinding& textureBind = scopedTextureBind.GetBinding();
-
-        std::string filename = "mound" + std::to_string(number) + ".png";
-        textureBind.LoadImage(filename.c_str(), GLplus::Texture2D::InvertY);
+        mNumberSprites[number] = (int) spriteAtlas.GetSpriteIndex("mound" + std::to_string(number));
     }
 
+    glm::vec2 playerSize(spriteAtlas.GetSprite(playerSprite).Size);
+    glm::vec2 moundSize(spriteAtlas.GetSprite(mCoveredMoundSprite).Size);
+    float playerAspect = playerSize.x / playerSize.y;
+    float moundAspect = moundSize.x / moundSize.y;
+
     // Add player
-    mBillboards.emplace_back(new Billboard());
-    mPlayer.BillboardID = mBillboards.size() - 1;
-    std::unique_ptr<Billboard>& playerSprite = mBillboards.back();
-    playerSprite->SetTexture(mpPlayerTexture);
-    playerSprite->SetDimensions(glm::vec2(playerAspect, 1.0f) * 2.0f);
-    playerSprite->SetCenterPosition(glm::vec3(0.0f, playerSprite->GetDimensions().y / 2.0f, 0.0f));
+    glm::vec2 playerDimensions = glm::vec2(playerAspect, 1.0f) * 2.0f;
+    mPlayer.BillboardID = mpBillboardBatch->AddInstance(glm::vec3(0.0f, playerDimensions.y / 2.0f, 0.0f),
+                                                        playerDimensions, playerSprite);
 
     // Add mounds
-    mMoundsPerRow = 10;
+    mMoundsPerRow = moundsPerRow > 0 ? moundsPerRow : infiniteBoard ? 24 : 10;
+    glm::vec2 moundDimensions = glm::vec2(moundAspect, 1.0f) * 0.7f;
     for (int i = 0; i < mMoundsPerRow; i++)
     {
         for (int j = 0; j < mMoundsPerRow; j++)
         {
-            mBillboards.emplace_back(new Billboard());
-            std::unique_ptr<Billboard>& moundSprite = mBillboards.back();
-            moundSprite->SetTexture(mpMoundTexture);
-            moundSprite->SetDimensions(glm::vec2(moundAspect, 1.0f) * 0.7f);
-            glm::vec3 uncenteredPosition = glm::vec3(i * 1.0f, moundSprite->GetDimensions().y / 2.0f, j * 1.0f);
-            moundSprite->SetCenterPosition(uncenteredPosition
-                                           - glm::vec3(mMoundsPerRow / 2.0f, 0.0f, mMoundsPerRow / 2.0f)
-                                           + glm::vec3(0.5f, 0.0f, 0.5f));
+            glm::vec3 uncenteredPosition = glm::vec3(i * 1.0f, moundDimensions.y / 2.0f, j * 1.0f);
+            glm::vec3 centerPosition = uncenteredPosition
+                                     - glm::vec3(mMoundsPerRow / 2.0f, 0.0f, mMoundsPerRow / 2.0f)
+                                     + glm::vec3(0.5f, 0.0f, 0.5f);
+
             mMounds.emplace_back();
             Mound& mound = mMounds.back();
-            mound.BillboardID = mBillboards.size() - 1;
-            mound.State = MoundState::Untouched;
+            mound.BillboardID = mpBillboardBatch->AddInstance(centerPosition, moundDimensions, mCoveredMoundSprite);
+            mMoundGrid.AddItem(centerPosition, moundDimensions);
         }
     }
 
-    ResetMounds();
+    std::random_device randomDevice;
+    if (infiniteBoard)
+    {
+        mInfiniteSeed = randomDevice();
+        mpInfiniteField.reset(new ChunkedMinefield(mInfiniteSeed, 0.15f));
+        RefreshMoundWindow();
+    }
+    else
+    {
+        // 10 mines on the usual 10x10 board, the same density on bigger ones.
+        int mineCount = std::max(1, mMoundsPerRow * mMoundsPerRow / 10);
+        mpBoard.reset(new Board(mMoundsPerRow, mMoundsPerRow, mineCount, randomDevice()));
+        ResetMounds();
+    }
 
     mViewport.TopLeft = glm::ivec2(0);
     mViewport.Size = glm::ivec2(1,1); // temporary until first render
 
     mCamera.EyePosition = glm::vec3(7.0f, 10.0f, 7.0f);
-    mCamera.TargetPosition = mBillboards[mPlayer.BillboardID]->GetCenterPosition();
+    mCamera.TargetPosition = mpBillboardBatch->GetCenterPosition(mPlayer.BillboardID);
     mCamera.UpVector = glm::vec3(0.0f,1.0f,0.0f);
 
     mPerspective.FovY = 70.0f;
@@ -113,143 +109,186 @@ void print(const char* name, glm::vec3 v)
 
 void WorldScene::ResetMounds()
 {
-    // reset state of mounds
+    // reset sprites of mounds to match the freshly reset board
     for (Mound& mound : mMounds)
     {
-        mound.State = MoundState::Untouched;
-        mound.IsMine = false;
-        mBillboards[mound.BillboardID]->SetTexture(mpMoundTexture);
+        mpBillboardBatch->SetSprite(mound.BillboardID, mCoveredMoundSprite);
     }
+}
 
-    // allocate mines
-    int numMines = 10;
+void WorldScene::ClickMound(size_t moundIndex)
+{
+    PROFILE_ZONE("WorldScene::ClickMound");
 
-    std::random_device randomDevice;
-    std::default_random_engine randomEngine(randomDevice());
-    std::uniform_int_distribution<int> uniformDist(0, mMounds.size() - 1);
+    mIsRedrawNeeded = true;
 
-    for (int minesLeft = numMines; minesLeft > 0 && numMines - minesLeft < mMounds.size(); minesLeft--)
+    if (mpInfiniteField)
     {
-        int chosen;
-retry:
-        chosen = uniformDist(randomEngine);
-        if (mMounds[chosen].IsMine)
+        CellCoord cell = GetMoundCell(moundIndex);
+        RevealResult result = mpInfiniteField->Reveal(cell.X, cell.Y, mChangedCells);
+
+        if (result == RevealResult::HitMine)
         {
-            goto retry;
+            printf("You died!\n"); fflush(stdout);
+            mpInfiniteField.reset(new ChunkedMinefield(++mInfiniteSeed, 0.15f));
+            RefreshMoundWindow();
         }
-
-        mMounds[chosen].IsMine = true;
+        else if (result == RevealResult::Revealed)
+        {
+            CellCoord windowOrigin = GetMoundCell(0);
+            for (const CellCoord& changed : mChangedCells)
+            {
+                int64_t i = changed.Y - windowOrigin.Y;
+                int64_t j = changed.X - windowOrigin.X;
+                if (i >= 0 && i < mMoundsPerRow && j >= 0 && j < mMoundsPerRow)
+                {
+                    int numNeighborMines = mpInfiniteField->GetAdjacentMineCount(changed.X, changed.Y);
+                    Mound& mound = mMounds[i * mMoundsPerRow + j];
+                    mpBillboardBatch->SetSprite(mound.BillboardID, mNumberSprites[numNeighborMines]);
+                }
+            }
+            printf("Uncovered %zu mounds\n", mChangedCells.size()); fflush(stdout);
+        }
+        return;
     }
-}
 
-void WorldScene::ClickMound(size_t moundIndex)
-{
-    if (mMounds.at(moundIndex).IsMine)
+    RevealResult result = mpBoard->Click(moundIndex, mChangedMounds);
+
+    if (result == RevealResult::HitMine)
     {
         printf("You died!\n"); fflush(stdout);
+        mpBoard->Reset();
         ResetMounds();
     }
-    else
+    else if (result == RevealResult::Revealed)
     {
-        std::set<size_t> zeroClosure = ZeroClosure(moundIndex);
-
-        // Now the neighbours too
-        std::set<size_t> toReveal{moundIndex};
-        for (size_t zero : zeroClosure)
+        for (uint32_t index : mChangedMounds)
         {
-            toReveal.insert(zero);
-            for (size_t neighbor : SurroundingMounds(zero))
-            {
-                toReveal.insert(neighbor);
-            }
+            int numNeighborMines = mpBoard->GetMinefield().GetAdjacentMineCount(index);
+            mpBillboardBatch->SetSprite(mMounds[index].BillboardID, mNumberSprites[numNeighborMines]);
         }
+        printf("Uncovered %zu mounds\n", mChangedMounds.size()); fflush(stdout);
+    }
+}
 
-        for (size_t index : toReveal)
-        {
-            printf("Uncovered %zu\n", index);
-            mMounds[index].State = MoundState::Uncovered;
-
-            int numNeighborMines = 0;
-            for (size_t neighbor : SurroundingMounds(index))
-            {
-                if (mMounds[neighbor].IsMine) numNeighborMines++;
-            }
+CellCoord WorldScene::GetMoundCell(size_t moundIndex) const
+{
+    // rows of mounds run along world x, columns along world z.
+    int64_t i = moundIndex / mMoundsPerRow;
+    int64_t j = moundIndex % mMoundsPerRow;
 
-            mBillboards[mMounds[index].BillboardID]->SetTexture(mMoundNumberTextures[numNeighborMines]);
-        }
-        fflush(stdout);
-    }
+    CellCoord cell = { mFocusX - mMoundsPerRow / 2 + j, mFocusY - mMoundsPerRow / 2 + i };
+    return cell;
 }
 
-std::set<size_t> WorldScene::ZeroClosure(size_t moundIndex)
+int WorldScene::GetMoundSprite(MoundState state, int numNeighborMines) const
 {
-    std::set<size_t> closure;
+    return state == MoundState::Uncovered ? mNumberSprites[numNeighborMines] : mCoveredMoundSprite;
+}
 
-    std::vector<size_t> toCheck{moundIndex};
-    while (!toCheck.empty())
+void WorldScene::RefreshMoundWindow()
+{
+    for (size_t moundIndex = 0; moundIndex < mMounds.size(); moundIndex++)
     {
-        if (std::find(closure.begin(), closure.end(), toCheck.back()) != closure.end())
-        {
-            toCheck.pop_back();
-        }
-        else if (mMounds[toCheck.back()].IsMine)
-        {
-            toCheck.pop_back();
-        }
-        else
-        {
-            std::set<size_t> surroundings = SurroundingMounds(toCheck.back());
-            int numSurroundingMines = 0;
-            for (size_t surrounding : surroundings)
-            {
-                if (mMounds[surrounding].IsMine)
-                {
-                    numSurroundingMines++;
-                }
-            }
+        CellCoord cell = GetMoundCell(moundIndex);
+        size_t instance = mMounds[moundIndex].BillboardID;
+        glm::vec2 dimensions = mpBillboardBatch->GetDimensions(instance);
 
-            if (numSurroundingMines == 0)
-            {
-                closure.insert(toCheck.back());
-                toCheck.pop_back();
-                toCheck.insert(toCheck.end(), surroundings.begin(), surroundings.end());
-            }
-            else
-            {
-                toCheck.pop_back();
-            }
-        }
+        glm::vec3 centerPosition(cell.Y + 0.5f, dimensions.y / 2.0f, cell.X + 0.5f);
+        mpBillboardBatch->SetCenterPosition(instance, centerPosition);
+        mMoundGrid.SetItem(moundIndex, centerPosition, dimensions);
+
+        MoundState state = mpInfiniteField->GetState(cell.X, cell.Y);
+        int numNeighborMines = state == MoundState::Uncovered ? mpInfiniteField->GetAdjacentMineCount(cell.X, cell.Y) : 0;
+        mpBillboardBatch->SetSprite(instance, GetMoundSprite(state, numNeighborMines));
     }
+}
 
-    return closure;
+void WorldScene::MoveFocus(int dx, int dy)
+{
+    mFocusX += dx;
+    mFocusY += dy;
+    mIsRedrawNeeded = true;
+
+    glm::vec3 worldDelta((float) dy, 0.0f, (float) dx);
+    mCamera.EyePosition += worldDelta;
+    mCamera.TargetPosition += worldDelta;
+
+    mpBillboardBatch->SetCenterPosition(mPlayer.BillboardID, mpBillboardBatch->GetCenterPosition(mPlayer.BillboardID) + worldDelta);
+
+    RefreshMoundWindow();
+    SetHoveredMound(PickingGrid::kNoItem);
+
+    // keep the chunks under the window and one ring around it, pack the rest away.
+    mpInfiniteField->EvictFarChunks(mFocusX, mFocusY, mMoundsPerRow / ChunkedMinefield::kChunkSize + 2);
 }
 
-std::set<size_t> WorldScene::SurroundingMounds(size_t moundIndex)
+uint32_t WorldScene::PickMound(SDL_Window* window, int mouseX, int mouseY)
 {
-    if (moundIndex >= mMounds.size()) throw std::out_of_range("moundIndex");
+    int windowWidth, windowHeight;
+    SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+
+    glm::vec3 rayStart = glm::unProject(
+                glm::vec3((float) mouseX, (float) windowHeight - mouseY, 0.0f),
+                mWorldViewMatrix, mProjectionMatrix,
+                glm::vec4(0.0f, 0.0f, (float) windowWidth, (float) windowHeight));
 
-    std::set<size_t> surroundingMounds;
+    glm::vec3 rayEnd = glm::unProject(
+                glm::vec3((float) mouseX, (float) windowHeight - mouseY, 1.0f),
+                mWorldViewMatrix, mProjectionMatrix,
+                glm::vec4(0.0f, 0.0f, (float) windowWidth, (float) windowHeight));
 
-    int cy = moundIndex / mMoundsPerRow;
-    int cx = moundIndex - cy * mMoundsPerRow;
+    float t;
+    return mMoundGrid.Pick(rayStart, rayEnd - rayStart, mBillboardBasis, t);
+}
 
-    for (int dy = -1; dy <= 1; dy++)
+void WorldScene::SetHoveredMound(uint32_t moundIndex)
+{
+    if (moundIndex == mHoveredMound)
     {
-        int y = cy + dy;
-        for (int dx = -1; dx <= 1; dx++)
-        {
-            if (!(dx == 0 && dy == 0))
-            {
-                int x = cx + dx;
-                if (x >= 0 && x < mMoundsPerRow && y >= 0 && y < mMoundsPerRow)
-                {
-                    surroundingMounds.insert(y * mMoundsPerRow + x);
-                }
-            }
-        }
+        return;
     }
 
-    return surroundingMounds;
+    mHoveredMound = moundIndex;
+    mDebugDraw.Clear();
+    mIsRedrawNeeded = true;
+
+    if (moundIndex == PickingGrid::kNoItem)
+    {
+        return;
+    }
+
+    // outline the ground cell under the hovered mound
+    glm::vec3 center = mpBillboardBatch->GetCenterPosition(mMounds[moundIndex].BillboardID);
+    glm::vec3 corners[4] = {
+        glm::vec3(center.x - 0.5f, 0.01f, center.z - 0.5f),
+        glm::vec3(center.x + 0.5f, 0.01f, center.z - 0.5f),
+        glm::vec3(center.x + 0.5f, 0.01f, center.z + 0.5f),
+        glm::vec3(center.x - 0.5f, 0.01f, center.z + 0.5f)
+    };
+
+    glm::vec4 tint(1.0f, 1.0f, 0.0f, 1.0f);
+    for (int i = 0; i < 4; i++)
+    {
+        mDebugDraw.AddLine(corners[i], corners[(i + 1) % 4], tint);
+    }
+}
+
+void WorldScene::OrbitCamera(float radians)
+{
+    float cs = glm::cos(radians);
+    float sn = glm::sin(radians);
+
+    // orbit around the target, which isn't at the origin once the focus has moved.
+    glm::vec3 toEye = mCamera.EyePosition - mCamera.TargetPosition;
+    glm::vec2 xz(toEye.x, toEye.z);
+    glm::vec2 newxz;
+    newxz.x = xz.x * cs - xz.y * sn;
+    newxz.y = xz.x * sn + xz.y * cs;
+
+    mCamera.EyePosition.x = mCamera.TargetPosition.x + newxz.x;
+    mCamera.EyePosition.z = mCamera.TargetPosition.z + newxz.y;
+    mIsRedrawNeeded = true;
 }
 
 bool WorldScene::HandleEvent(const SDL_Event& event)
@@ -264,41 +303,10 @@ bool WorldScene::HandleEvent(const SDL_Event& event)
 
         if (event.button.button == SDL_BUTTON_LEFT)
         {
-            int windowWidth, windowHeight;
-            SDL_GetWindowSize(clickedWindow, &windowWidth, &windowHeight);
-
-            glm::vec3 rayStart = glm::unProject(
-                        glm::vec3((float) event.button.x, (float) windowHeight - event.button.y, 0.0f),
-                        mWorldViewMatrix, mProjectionMatrix,
-                        glm::vec4(0.0f, 0.0f, (float) windowWidth, (float) windowHeight));
-
-            glm::vec3 rayEnd = glm::unProject(
-                        glm::vec3((float) event.button.x, (float) windowHeight - event.button.y, 1.0f),
-                        mWorldViewMatrix, mProjectionMatrix,
-                        glm::vec4(0.0f, 0.0f, (float) windowWidth, (float) windowHeight));
-
-            Mound* closestMound = nullptr;
-            float closest_t = INFINITY;
-            for (Mound& mound : mMounds)
-            {
-                std::unique_ptr<Billboard>& sprite = mBillboards[mound.BillboardID];
-                glm::vec3 bottomLeft, across, up;
-                sprite->GetPlane(bottomLeft, across, up);
-
-                float t;
-                if (RayParallelogramIntersect(rayStart, rayEnd - rayStart, bottomLeft, across, up, t))
-                {
-                    if (t < closest_t)
-                    {
-                        closestMound = &mound;
-                        closest_t = t;
-                    }
-                }
-            }
-
-            if (closestMound && closestMound->State == MoundState::Untouched)
+            uint32_t moundIndex = PickMound(clickedWindow, event.button.x, event.button.y);
+            if (moundIndex != PickingGrid::kNoItem)
             {
-                ClickMound(closestMound - mMounds.data());
+                ClickMound(moundIndex);
             }
 
             return true;
@@ -333,19 +341,23 @@ bool WorldScene::HandleEvent(const SDL_Event& event)
             float rotationPercent = (float) event.motion.xrel / windowWidth;
             float rotationRadians = 6.283185307 * rotationPercent;
 
-            float cs = glm::cos(rotationRadians);
-            float sn = glm::sin(rotationRadians);
-
-            glm::vec2 xz(mCamera.EyePosition.x, mCamera.EyePosition.z);
-            glm::vec2 newxz;
-            newxz.x = xz.x * cs - xz.y * sn;
-            newxz.y = xz.x * sn + xz.y * cs;
-
-            mCamera.EyePosition.x = newxz.x;
-            mCamera.EyePosition.z = newxz.y;
+            OrbitCamera(rotationRadians);
 
             return true;
         }
+
+        SetHoveredMound(PickMound(clickedWindow, event.motion.x, event.motion.y));
+    }
+    else if (event.type == SDL_KEYDOWN && mpInfiniteField)
+    {
+        switch (event.key.keysym.sym)
+        {
+        case SDLK_UP:    MoveFocus(0, -1); return true;
+        case SDLK_DOWN:  MoveFocus(0, 1);  return true;
+        case SDLK_LEFT:  MoveFocus(-1, 0); return true;
+        case SDLK_RIGHT: MoveFocus(1, 0);  return true;
+        default: break;
+        }
     }
     else if (event.type == SDL_MOUSEWHEEL)
     {
@@ -354,6 +366,7 @@ bool WorldScene::HandleEvent(const SDL_Event& event)
             glm::vec3 toEye = mCamera.EyePosition - mCamera.TargetPosition;
             toEye *= event.wheel.y > 0 ? 0.9f : 1.11f;
             mCamera.EyePosition = mCamera.TargetPosition + toEye;
+            mIsRedrawNeeded = true;
             return true;
         }
     }
@@ -368,6 +381,7 @@ void WorldScene::Update(unsigned int deltaTimeMS)
 void WorldScene::UpdateWorldView()
 {
     mWorldViewMatrix = glm::lookAt(mCamera.EyePosition, mCamera.TargetPosition, mCamera.UpVector);
+    mBillboardBasis = ComputeBillboardBasis(mCamera.TargetPosition - mCamera.EyePosition, mCamera.UpVector);
 }
 
 void WorldScene::UpdateProjection()
@@ -377,48 +391,47 @@ void WorldScene::UpdateProjection()
 
 void WorldScene::Render(RenderContext& renderContext, float partialUpdatePercentage)
 {
+    PROFILE_ZONE("WorldScene::Render");
+
     mViewport = renderContext.CurrentViewport;
     mPerspective.Aspect = (float) mViewport.Size.x / mViewport.Size.y;
 
     UpdateWorldView();
     UpdateProjection();
 
+    CameraBlock camera;
+    camera.Projection = mProjectionMatrix;
+    camera.ModelView = mWorldViewMatrix;
+    mpCameraBuffer->Update(&camera, sizeof(camera));
+
     {
-        GLplus::ScopedProgramBinding scopedProgramBinding(*mpModelProgram);
+        GLplus::ScopedProgramBinding scopedProgramBinding(*mpWorldProgram);
         GLplus::ProgramBinding& programBinding = scopedProgramBinding.GetBinding();
-        programBinding.UploadMatrix4("projection", GL_FALSE, &mProjectionMatrix[0][0]);
-        programBinding.UploadMatrix4("modelview", GL_FALSE, &mWorldViewMatrix[0][0]);
+        programBinding.UploadInt(mBillboardModeUniform.GetLocation(*mpWorldProgram), 0);
 
         glEnable(GL_DEPTH_TEST);
         GLplus::CheckGLErrors();
 
-        mpWorldMesh->Render(*mpModelProgram);
+        // pixels per world unit at a distance of 1
+        float projectionScale = mProjectionMatrix[1][1] * mViewport.Size.y / 2.0f;
+        float distance = mpWorldMesh->GetDistanceTo(&mCamera.EyePosition[0]);
+        mpWorldMesh->Render(*mpWorldProgram, mpWorldMesh->SelectLevel(distance, projectionScale));
 
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         GLplus::CheckGLErrors();
 
-        for (const std::unique_ptr<Billboard>& pBillboard : mBillboards)
-        {
-            if (!pBillboard)
-            {
-                continue;
-            }
-
-            pBillboard->SetCameraPosition(mCamera.EyePosition);
-            pBillboard->SetCameraViewDirection(mCamera.TargetPosition - mCamera.EyePosition);
-            pBillboard->SetCameraUp(mCamera.UpVector);
-            pBillboard->Render(*mpModelProgram);
-        }
+        mpBillboardBatch->ResetStats();
+        mpBillboardBatch->Render(*mpWorldProgram, mBillboardBasis);
     }
 
-    {
-        GLplus::ScopedProgramBinding scopedProgramBinding(*mpDebugProgram);
-        GLplus::ProgramBinding& programBinding = scopedProgramBinding.GetBinding();
-        programBinding.UploadMatrix4("projection", GL_FALSE, &mProjectionMatrix[0][0]);
-        programBinding.UploadMatrix4("modelview", GL_FALSE, &mWorldViewMatrix[0][0]);
+    mDebugDraw.SetLineWidth(2.0f);
+    mDebugDraw.Render(*mpDebugProgram);
 
-        mDebugDraw.SetLineWidth(2.0f);
-        mDebugDraw.Render(*mpDebugProgram);
-    }
+    mIsRedrawNeeded = false;
+}
+
+BillboardBatchStats WorldScene::GetBillboardStats() const
+{
+    return mpBillboardBatch->GetStats();
 }
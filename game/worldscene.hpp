@@ -2,14 +2,18 @@
 #define WORLDSCENE_HPP
 
 #include "scene.hpp"
-#include "billboard.hpp"
+#include "billboardbatch.hpp"
 
 #include "rendercontext.hpp"
 #include "debugdraw.hpp"
+#include "board.hpp"
+#include "chunkedminefield.hpp"
+#include "pickinggrid.hpp"
 
 #include <GLmesh.hpp>
 #include <vector>
-#include <set>
+
+struct SDL_Window;
 
 struct LookAtCamera
 {
@@ -18,6 +22,13 @@ struct LookAtCamera
     glm::vec3 UpVector;
 };
 
+// the Camera uniform block of world.vs and debug.vs, in its std140 layout
+struct CameraBlock
+{
+    glm::mat4 Projection;
+    glm::mat4 ModelView;
+};
+
 struct PerspectiveParams
 {
     float FovY;
@@ -26,40 +37,36 @@ struct PerspectiveParams
     float Far;
 };
 
+// BillboardIDs are instances of the billboard batch.
 struct Player
 {
     size_t BillboardID;
 };
 
-enum class MoundState
-{
-    Untouched,
-    Uncovered,
-    Flagged
-};
-
 struct Mound
 {
     size_t BillboardID;
-
-    MoundState State;
-
-    bool IsMine;
 };
 
 class WorldScene : public Scene
 {
-    std::unique_ptr<GLplus::Program> mpModelProgram;
+    // world.vs draws both the floor and the billboards
+    std::unique_ptr<GLplus::Program> mpWorldProgram;
     std::unique_ptr<GLplus::Program> mpDebugProgram;
 
-    std::unique_ptr<GLmesh::StaticMesh> mpWorldMesh;
+    GLplus::UniformHandle mBillboardModeUniform{"billboardMode"};
+
+    // written once a frame, read by both programs
+    std::unique_ptr<GLplus::UniformBuffer> mpCameraBuffer;
 
-    std::shared_ptr<GLplus::Texture2D> mpPlayerTexture;
+    std::unique_ptr<GLmesh::StaticMesh> mpWorldMesh;
 
-    std::shared_ptr<GLplus::Texture2D> mpMoundTexture;
-    std::vector<std::shared_ptr<GLplus::Texture2D>> mMoundNumberTextures;
+    // the player and every mound, in one draw from one atlas texture.
+    std::unique_ptr<BillboardBatch> mpBillboardBatch;
 
-    std::vector<std::unique_ptr<Billboard>> mBillboards;
+    // sprites of the atlas: the covered mound, and uncovered ones by neighbouring mine count.
+    int mCoveredMoundSprite;
+    int mNumberSprites[9];
 
     DebugDraw mDebugDraw;
 
@@ -67,6 +74,20 @@ class WorldScene : public Scene
 
     int mMoundsPerRow;
     std::vector<Mound> mMounds;
+    std::unique_ptr<Board> mpBoard;
+    std::vector<uint32_t> mChangedMounds;
+
+    // mounds are registered in the same order as mMounds, so item index == mound index.
+    PickingGrid mMoundGrid;
+    uint32_t mHoveredMound = PickingGrid::kNoItem;
+
+    // Unbounded board, used instead of mpBoard when enabled.
+    // The mounds are then a window of the board centered on the focus cell, which moves with the player.
+    std::unique_ptr<ChunkedMinefield> mpInfiniteField;
+    std::vector<CellCoord> mChangedCells;
+    unsigned int mInfiniteSeed = 0;
+    int64_t mFocusX = 0;
+    int64_t mFocusY = 0;
 
     Viewport mViewport;
     LookAtCamera mCamera;
@@ -75,23 +96,43 @@ class WorldScene : public Scene
     glm::mat4 mWorldViewMatrix;
     glm::mat4 mProjectionMatrix;
 
+    // camera facing plane of the billboards, worked out once per frame with the matrices above.
+    BillboardBasis mBillboardBasis;
+
     bool mCameraRotating = false;
 
+    // set by anything that changes what's on screen, cleared by Render.
+    bool mIsRedrawNeeded = true;
+
     void ResetMounds();
 
-    void ClickMound(size_t moundIndex);
-    std::set<size_t> ZeroClosure(size_t moundIndex);
-    std::set<size_t> SurroundingMounds(size_t moundIndex);
+    uint32_t PickMound(SDL_Window* window, int mouseX, int mouseY);
+    void SetHoveredMound(uint32_t moundIndex);
+
+    CellCoord GetMoundCell(size_t moundIndex) const;
+    int GetMoundSprite(MoundState state, int numNeighborMines) const;
+    void RefreshMoundWindow();
+    void MoveFocus(int dx, int dy);
 
     void UpdateWorldView();
     void UpdateProjection();
 
 public:
-    WorldScene();
+    // moundsPerRow of 0 picks the usual size for the board type.
+    WorldScene(bool infiniteBoard, int moundsPerRow = 0);
 
     bool HandleEvent(const SDL_Event& event) override;
     void Update(unsigned int deltaTimeMS) override;
     void Render(RenderContext& renderContext, float partialUpdatePercentage) override;
+    bool IsRedrawNeeded() const override { return mIsRedrawNeeded; }
+
+    void ClickMound(size_t moundIndex);
+    size_t GetMoundCount() const { return mMounds.size(); }
+
+    void OrbitCamera(float radians);
+
+    // What the billboard pass of the last Render asked of GL.
+    BillboardBatchStats GetBillboardStats() const;
 };
 
 #endif // WORLDSCENE_HPP
@@ -3,6 +3,8 @@
 # tinyobjloader_INCLUDE_DIR - Include directory of tinyobjloader
 # tinyobjloader_LIBRARY - the library for tinyobjloader
 
+find_package(Profiler REQUIRED)
+
 set(tinyobjloader_FOUND TRUE)
 set(tinyobjloader_INCLUDE_DIR ${CMAKE_CURRENT_LIST_DIR}/../include)
 set(tinyobjloader_LIBRARY tinyobjloader)
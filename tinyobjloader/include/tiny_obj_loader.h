@@ -42,25 +42,75 @@ struct mesh_t
 struct shape_t
 {
     std::string  name;
-    material_t   material;
+    int          material_id;   // index into the materials loaded with it, -1 for none
     mesh_t       mesh;
+
+    shape_t() : material_id(-1) {}
+};
+
+/// Receives an .obj file's shapes one at a time, as they're built, instead of all
+/// of them at the end, so they needn't all be in memory at once.
+/// Its functions are called on the thread that called LoadObj.
+class shape_visitor
+{
+public:
+    virtual ~shape_visitor() {}
+
+    /// Called once, before any shape, with every material the file's mtllib lines loaded.
+    /// shape_t::material_id indexes it. The visitor may keep it, by swapping it out.
+    virtual void visit_materials(std::vector<material_t>& materials) = 0;
+
+    /// Called for each shape, in file order. The visitor may keep it, by swapping or moving
+    /// it out. Whatever is left in it is freed once it returns.
+    virtual void visit_shape(shape_t& shape) = 0;
 };
 
 /// Loads .obj from a file.
 /// 'shapes' will be filled with parsed shape data
+/// 'materials' will be filled with the materials they refer to
 /// The function returns error string.
 /// Returns empty string when loading .obj success.
 /// 'mtl_basepath' is optional, and used for base path for .mtl file.
+/// 'num_threads' threads parse the file, each a run of its lines. 0 means one per core.
+/// Files too small to be worth it get fewer. The shapes are the same however many there are.
 std::string TryLoadObj(
     std::vector<shape_t>& shapes,   // [output]
+    std::vector<material_t>& materials,   // [output]
     const char* filename,
-    const char* mtl_basepath = NULL);
+    const char* mtl_basepath = NULL,
+    unsigned int num_threads = 1);
 
 /// same as TryLoadObj, but throws on error instead of returning a message.
 void LoadObj(
     std::vector<shape_t>& shapes,   // [output]
+    std::vector<material_t>& materials,   // [output]
     const char* filename,
-    const char* mtl_basepath = NULL);
+    const char* mtl_basepath = NULL,
+    unsigned int num_threads = 1);
+
+/// same as TryLoadObj, but hands the materials and shapes to 'visitor' instead.
+/// Only a few shapes are built ahead of the one being visited.
+/// If a mtllib can't be loaded, the shapes before it are visited before the error is returned.
+std::string TryLoadObj(
+    shape_visitor& visitor,
+    const char* filename,
+    const char* mtl_basepath = NULL,
+    unsigned int num_threads = 1);
+
+/// same as TryLoadObj with a visitor, but throws on error instead of returning a message.
+void LoadObj(
+    shape_visitor& visitor,
+    const char* filename,
+    const char* mtl_basepath = NULL,
+    unsigned int num_threads = 1);
+
+/// Parses the number at 'begin' the way strtof does, bit for bit, without reading
+/// past 'end' or needing a '\0' there. Fast for the plain decimals .obj files hold.
+/// Returns where the number ends, which is 'begin' if there is none.
+const char* ParseFloat(
+    const char* begin,
+    const char* end,
+    float& value);  // [output]
 
 }
 
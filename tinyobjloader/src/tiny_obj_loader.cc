@@ -5,6 +5,10 @@
 //
 
 //
+// (local)        Parse the whole file from memory: mapped where possible, split into lines in place,
+//                with a float parser that needs no terminating '\0' and a hashed vertex cache.
+// (local)        Parse on several threads, each its own run of lines, then put the runs together.
+// (local)        Hand shapes to a visitor as they're built, and share materials between shapes by index.
 // version 0.9.6: Support Ni(index of refraction) mtl parameter.
 //                Parse transmittance material parameter correctly.
 // version 0.9.5: Parse multiple group name.
@@ -20,8 +24,17 @@
 #include <cstdlib>
 #include <cstring>
 #include <cassert>
-
+#include <cfloat>
+#include <cstdio>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <map>
 #include <fstream>
@@ -31,6 +44,16 @@
 
 #include "tiny_obj_loader.h"
 
+#include <Profiler.hpp>
+
+#ifdef _WIN32
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace tinyobj {
 
 struct vertex_index {
@@ -50,6 +73,141 @@ static inline bool operator<(const vertex_index& a, const vertex_index& b)
   return false;
 }
 
+static inline bool operator==(const vertex_index& a, const vertex_index& b)
+{
+  return a.v_idx == b.v_idx && a.vt_idx == b.vt_idx && a.vn_idx == b.vn_idx;
+}
+
+// vertex_index -> flattened vertex, by open addressing with linear probing.
+class vertex_index_map {
+ public:
+  explicit vertex_index_map(size_t expected_count) : count_(0) {
+    size_t capacity = 64;
+    while (capacity < expected_count * 2) {
+      capacity *= 2;
+    }
+    slots_.resize(capacity);
+  }
+
+  // Returns the vertex i maps to, first mapping it to new_value if it maps to none.
+  unsigned int find_or_insert(const vertex_index& i, unsigned int new_value, bool& inserted) {
+    size_t mask = slots_.size() - 1;
+    for (size_t s = hash(i) & mask; ; s = (s + 1) & mask) {
+      slot& candidate = slots_[s];
+      if (candidate.value == kEmpty) {
+        candidate.key = i;
+        candidate.value = new_value;
+        inserted = true;
+        // at most half full, so probes stay short
+        if (++count_ * 2 > slots_.size()) {
+          grow();
+        }
+        return new_value;
+      }
+      if (candidate.key == i) {
+        inserted = false;
+        return candidate.value;
+      }
+    }
+  }
+
+ private:
+  static const unsigned int kEmpty = 0xFFFFFFFFu;
+
+  struct slot {
+    vertex_index key;
+    unsigned int value;
+    slot() : key(-1), value(kEmpty) {}
+  };
+
+  static size_t hash(const vertex_index& i) {
+    uint64_t h = (uint64_t)(uint32_t)i.v_idx * 0x9E3779B97F4A7C15ull;
+    h ^= (uint64_t)(uint32_t)i.vt_idx * 0xC2B2AE3D27D4EB4Full;
+    h ^= (uint64_t)(uint32_t)i.vn_idx * 0x165667B19E3779F9ull;
+    return (size_t)(h ^ (h >> 29));
+  }
+
+  void grow() {
+    std::vector<slot> old_slots(slots_.size() * 2);
+    old_slots.swap(slots_);
+    size_t mask = slots_.size() - 1;
+    for (size_t o = 0; o < old_slots.size(); o++) {
+      if (old_slots[o].value == kEmpty) {
+        continue;
+      }
+      size_t s = hash(old_slots[o].key) & mask;
+      while (slots_[s].value != kEmpty) {
+        s = (s + 1) & mask;
+      }
+      slots_[s] = old_slots[o];
+    }
+  }
+
+  std::vector<slot> slots_;
+  size_t count_;
+};
+
+// which of a face vertex's indices were relative (negative) in the file
+enum {
+  RELATIVE_V = 1,
+  RELATIVE_VT = 2,
+  RELATIVE_VN = 4
+};
+
+// Faces, with their vertices one after the other instead of a vector per face.
+struct face_list {
+  std::vector<vertex_index> vertices;
+  std::vector<unsigned char> relative; // per vertex, RELATIVE_ flags
+  std::vector<unsigned int> sizes;
+};
+
+// A line that changes which group the faces after it go into, or their material.
+struct obj_command {
+  enum command_type { GROUP, OBJECT, USEMTL, MTLLIB };
+
+  command_type type;
+  size_t face;        // faces before it in its chunk
+  size_t face_vertex; // and their vertices
+  std::string name;
+};
+
+// What one thread parsed: the lines from begin to end.
+// Relative indices are resolved against the chunk's own v, vn and vt,
+// so they're off by the bases until the chunks are put together.
+struct obj_chunk {
+  const char* begin;
+  const char* end;
+
+  std::vector<float> v;
+  std::vector<float> vn;
+  std::vector<float> vt;
+  face_list faces;
+  std::vector<obj_command> commands;
+
+  // v, vn and vt in the chunks before this one
+  int v_base, vn_base, vt_base;
+
+  obj_chunk() : begin(NULL), end(NULL), v_base(0), vn_base(0), vt_base(0) {}
+};
+
+// Faces [first_face, end_face) of a chunk, whose vertices start at first_vertex
+struct face_run {
+  size_t chunk;
+  size_t first_face;
+  size_t end_face;
+  size_t first_vertex;
+};
+
+// The faces between two g or o lines, which become a shape.
+struct face_group {
+  std::vector<face_run> runs;
+  size_t face_count;
+  int material_id;
+  std::string name;
+
+  face_group() : face_count(0), material_id(-1) {}
+};
+
 struct obj_shape {
   std::vector<float> v;
   std::vector<float> vn;
@@ -79,84 +237,237 @@ static inline int fixIndex(int idx, int n)
   return i;
 }
 
-static inline std::string parseString(const char*& token)
+static inline const char* skipSpace(const char* token, const char* end)
+{
+  while (token < end && isSpace(*token)) token++;
+  return token;
+}
+
+// Same as token + strcspn(token, " \t\r"), but stopping at end.
+static inline const char* skipToken(const char* token, const char* end)
+{
+  while (token < end && !isSpace(*token) && *token != '\r' && *token != '\0') token++;
+  return token;
+}
+
+static inline bool isDigit(const char c) {
+  return (c >= '0') && (c <= '9');
+}
+
+static inline bool isCSpace(const char c) {
+  return isSpace(c) || (c == '\n') || (c == '\v') || (c == '\f') || (c == '\r');
+}
+
+// The first whitespace separated word, as sscanf's "%s" reads it.
+static inline std::string parseWord(const char* token, const char* end)
 {
-  std::string s;
-  int b = strspn(token, " \t");
-  int e = strcspn(token, " \t\r");
-  s = std::string(&token[b], &token[e]);
+  while (token < end && isCSpace(*token)) token++;
+  const char* e = token;
+  while (e < end && !isCSpace(*e) && *e != '\0') e++;
+  return std::string(token, e);
+}
 
-  token += (e - b);
-  return s;
+// Same as atoi, but stopping at end.
+static inline int parseInt(const char* token, const char* end)
+{
+  while (token < end && isCSpace(*token)) token++;
+  bool negative = false;
+  if (token < end && (*token == '+' || *token == '-')) {
+    negative = (*token == '-');
+    token++;
+  }
+  unsigned int value = 0;
+  for (; token < end && isDigit(*token); token++) {
+    value = value * 10 + (unsigned int)(*token - '0');
+  }
+  return (int)(negative ? 0u - value : value);
 }
 
-static inline float parseFloat(const char*& token)
+static const double kPowersOf10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+const char* ParseFloat(const char* begin, const char* end, float& value)
 {
-  token += strspn(token, " \t");
-  float f = (float)atof(token);
-  token += strcspn(token, " \t\r");
+  // Plain decimals with up to 19 significant digits and a small exponent are read into
+  // an integer and scaled by an exact power of ten, which rounds once, correctly, to double.
+  // Rounding that on to float is then correct too, unless the double landed exactly halfway
+  // between two floats. That, and everything else strtof reads, goes to strtof.
+  const char* p = begin;
+  bool negative = false;
+  if (p < end && (*p == '+' || *p == '-')) {
+    negative = (*p == '-');
+    p++;
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any_digits = false;
+  bool fast = true;
+
+  for (; p < end && isDigit(*p); p++) {
+    any_digits = true;
+    if (mantissa == 0 && *p == '0') continue;
+    if (++digits > 19) fast = false;
+    mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+  }
+  if (p < end && *p == '.') {
+    p++;
+    for (; p < end && isDigit(*p); p++) {
+      any_digits = true;
+      exponent--;
+      if (mantissa == 0 && *p == '0') continue;
+      if (++digits > 19) fast = false;
+      mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+    }
+  }
+  if (any_digits && p < end && (*p == 'e' || *p == 'E')) {
+    const char* q = p + 1;
+    bool negative_exponent = false;
+    if (q < end && (*q == '+' || *q == '-')) {
+      negative_exponent = (*q == '-');
+      q++;
+    }
+    if (q < end && isDigit(*q)) {
+      int explicit_exponent = 0;
+      for (; q < end && isDigit(*q); q++) {
+        if (explicit_exponent < 100000) explicit_exponent = explicit_exponent * 10 + (*q - '0');
+      }
+      exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+      p = q;
+    }
+  }
+  // hexadecimal floats start out looking like a 0
+  if (p < end && (*p == 'x' || *p == 'X')) fast = false;
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+  fast = false; // double arithmetic isn't done in double precision
+#endif
+
+  if (fast && any_digits) {
+    if (mantissa == 0) {
+      value = negative ? -0.0f : 0.0f;
+      return p;
+    }
+    if (mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+      double d = exponent < 0 ? (double)mantissa / kPowersOf10[-exponent]
+                              : (double)mantissa * kPowersOf10[exponent];
+      uint64_t bits;
+      memcpy(&bits, &d, sizeof(bits));
+      // a normal float, and not halfway between two: the 29 bits float drops aren't 1000...0
+      if (d >= FLT_MIN && d <= FLT_MAX && (bits & 0x1FFFFFFFull) != 0x10000000ull) {
+        value = (float)(negative ? -d : d);
+        return p;
+      }
+    }
+  }
+
+  // strtof wants a terminated string
+  char buffer[64];
+  size_t length = (size_t)(end - begin);
+  std::string long_copy;
+  const char* copy;
+  if (length < sizeof(buffer)) {
+    memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+    copy = buffer;
+  } else {
+    long_copy.assign(begin, end);
+    copy = long_copy.c_str();
+  }
+  char* copy_end;
+  value = strtof(copy, &copy_end);
+  return begin + (copy_end - copy);
+}
+
+static inline float parseFloat(const char*& token, const char* end)
+{
+  token = skipSpace(token, end);
+  float f;
+  ParseFloat(token, end, f);
+  token = skipToken(token, end);
   return f;
 }
 
 static inline void parseFloat2(
   float& x, float& y,
-  const char*& token)
+  const char*& token, const char* end)
 {
-  x = parseFloat(token);
-  y = parseFloat(token);
+  x = parseFloat(token, end);
+  y = parseFloat(token, end);
 }
 
 static inline void parseFloat3(
   float& x, float& y, float& z,
-  const char*& token)
+  const char*& token, const char* end)
 {
-  x = parseFloat(token);
-  y = parseFloat(token);
-  z = parseFloat(token);
+  x = parseFloat(token, end);
+  y = parseFloat(token, end);
+  z = parseFloat(token, end);
 }
 
+// Same as token + strcspn(token, "/ \t\r"), but stopping at end.
+static inline const char* skipIndex(const char* token, const char* end)
+{
+  while (token < end && *token != '/' && !isSpace(*token) && *token != '\r' && *token != '\0') token++;
+  return token;
+}
 
 // Parse triples: i, i/j/k, i//k, i/j
 static vertex_index parseTriple(
   const char* &token,
+  const char* end,
   int vsize,
   int vnsize,
-  int vtsize)
+  int vtsize,
+  unsigned char& relative)
 {
     vertex_index vi(-1);
-
-    vi.v_idx = fixIndex(atoi(token), vsize);
-    token += strcspn(token, "/ \t\r");
-    if (token[0] != '/') {
+    int idx;
+    relative = 0;
+
+    idx = parseInt(token, end);
+    relative |= (idx < 0) ? RELATIVE_V : 0;
+    vi.v_idx = fixIndex(idx, vsize);
+    token = skipIndex(token, end);
+    if (token == end || token[0] != '/') {
       return vi;
     }
     token++;
 
     // i//k
-    if (token[0] == '/') {
+    if (token < end && token[0] == '/') {
       token++;
-      vi.vn_idx = fixIndex(atoi(token), vnsize);
-      token += strcspn(token, "/ \t\r");
+      idx = parseInt(token, end);
+      relative |= (idx < 0) ? RELATIVE_VN : 0;
+      vi.vn_idx = fixIndex(idx, vnsize);
+      token = skipIndex(token, end);
       return vi;
     }
     
     // i/j/k or i/j
-    vi.vt_idx = fixIndex(atoi(token), vtsize);
-    token += strcspn(token, "/ \t\r");
-    if (token[0] != '/') {
+    idx = parseInt(token, end);
+    relative |= (idx < 0) ? RELATIVE_VT : 0;
+    vi.vt_idx = fixIndex(idx, vtsize);
+    token = skipIndex(token, end);
+    if (token == end || token[0] != '/') {
       return vi;
     }
 
     // i/j/k
     token++;  // skip '/'
-    vi.vn_idx = fixIndex(atoi(token), vnsize);
-    token += strcspn(token, "/ \t\r");
+    idx = parseInt(token, end);
+    relative |= (idx < 0) ? RELATIVE_VN : 0;
+    vi.vn_idx = fixIndex(idx, vnsize);
+    token = skipIndex(token, end);
     return vi; 
 }
 
 static unsigned int
 updateVertex(
-  std::map<vertex_index, unsigned int>& vertexCache,
+  vertex_index_map& vertexCache,
   std::vector<float>& positions,
   std::vector<float>& normals,
   std::vector<float>& texcoords,
@@ -165,11 +476,12 @@ updateVertex(
   const std::vector<float>& in_texcoords,
   const vertex_index& i)
 {
-  const std::map<vertex_index, unsigned int>::iterator it = vertexCache.find(i);
+  bool inserted;
+  unsigned int idx = vertexCache.find_or_insert(i, positions.size() / 3, inserted);
 
-  if (it != vertexCache.end()) {
+  if (!inserted) {
     // found cache
-    return it->second;
+    return idx;
   }
 
   assert(in_positions.size() > (3*i.v_idx+2));
@@ -189,75 +501,313 @@ updateVertex(
     texcoords.push_back(in_texcoords[2*i.vt_idx+1]);
   }
 
-  unsigned int idx = positions.size() / 3 - 1;
-  vertexCache[i] = idx;
-
   return idx;
 }
 
-static bool
+static void
 exportFaceGroupToShape(
   shape_t& shape,
   const std::vector<float> &in_positions,
   const std::vector<float> &in_normals,
   const std::vector<float> &in_texcoords,
-  const std::vector<std::vector<vertex_index> >& faceGroup,
-  const material_t &material,
-  const std::string &name)
+  const std::vector<obj_chunk> &chunks,
+  const face_group& faceGroup)
 {
-  if (faceGroup.empty()) {
-    return false;
+  size_t triangle_count = 0;
+  for (size_t r = 0; r < faceGroup.runs.size(); r++) {
+    const face_run& run = faceGroup.runs[r];
+    for (size_t i = run.first_face; i < run.end_face; i++) {
+      triangle_count += std::max(chunks[run.chunk].faces.sizes[i], 2u) - 2;
+    }
   }
 
   // Flattened version of vertex data
   std::vector<float> positions;
   std::vector<float> normals;
   std::vector<float> texcoords;
-  std::map<vertex_index, unsigned int> vertexCache;
+  // closed meshes have about half as many vertices as triangles
+  vertex_index_map vertexCache(std::min(in_positions.size() / 3, triangle_count / 2 + 1));
   std::vector<unsigned int> indices;
+  indices.reserve(triangle_count * 3);
 
   // Flatten vertices and indices
-  for (size_t i = 0; i < faceGroup.size(); i++) {
-    const std::vector<vertex_index>& face = faceGroup[i];
+  std::vector<vertex_index> face;
+  for (size_t r = 0; r < faceGroup.runs.size(); r++) {
+    const face_run& run = faceGroup.runs[r];
+    const obj_chunk& chunk = chunks[run.chunk];
+    size_t first_vertex = run.first_vertex;
+
+    for (size_t i = run.first_face; i < run.end_face; first_vertex += chunk.faces.sizes[i], i++) {
+      size_t npolys = chunk.faces.sizes[i];
+      if (npolys < 2) {
+        continue;
+      }
 
-    vertex_index i0 = face[0];
-    vertex_index i1(-1);
-    vertex_index i2 = face[1];
+      // relative indices were resolved within the chunk, so move them past the chunks before it
+      face.resize(npolys);
+      for (size_t k = 0; k < npolys; k++) {
+        face[k] = chunk.faces.vertices[first_vertex + k];
+        unsigned char relative = chunk.faces.relative[first_vertex + k];
+        if (relative) {
+          face[k].v_idx += (relative & RELATIVE_V) ? chunk.v_base : 0;
+          face[k].vt_idx += (relative & RELATIVE_VT) ? chunk.vt_base : 0;
+          face[k].vn_idx += (relative & RELATIVE_VN) ? chunk.vn_base : 0;
+        }
+      }
 
-    size_t npolys = face.size();
+      vertex_index i0 = face[0];
+      vertex_index i1(-1);
+      vertex_index i2 = face[1];
 
-    // Polygon -> triangle fan conversion
-    for (size_t k = 2; k < npolys; k++) {
-      i1 = i2;
-      i2 = face[k];
+      // Polygon -> triangle fan conversion
+      for (size_t k = 2; k < npolys; k++) {
+        i1 = i2;
+        i2 = face[k];
 
-      unsigned int v0 = updateVertex(vertexCache, positions, normals, texcoords, in_positions, in_normals, in_texcoords, i0);
-      unsigned int v1 = updateVertex(vertexCache, positions, normals, texcoords, in_positions, in_normals, in_texcoords, i1);
-      unsigned int v2 = updateVertex(vertexCache, positions, normals, texcoords, in_positions, in_normals, in_texcoords, i2);
+        unsigned int v0 = updateVertex(vertexCache, positions, normals, texcoords, in_positions, in_normals, in_texcoords, i0);
+        unsigned int v1 = updateVertex(vertexCache, positions, normals, texcoords, in_positions, in_normals, in_texcoords, i1);
+        unsigned int v2 = updateVertex(vertexCache, positions, normals, texcoords, in_positions, in_normals, in_texcoords, i2);
 
-      indices.push_back(v0);
-      indices.push_back(v1);
-      indices.push_back(v2);
+        indices.push_back(v0);
+        indices.push_back(v1);
+        indices.push_back(v2);
+      }
     }
-
   }
 
   //
   // Construct shape.
   //
-  shape.name = name;
+  shape.name = faceGroup.name;
   shape.mesh.positions.swap(positions);
   shape.mesh.normals.swap(normals);
   shape.mesh.texcoords.swap(texcoords);
   shape.mesh.indices.swap(indices);
 
-  shape.material = material;
+  shape.material_id = faceGroup.material_id;
+}
+
+// Calls work(i) for each i below count, spread over up to num_threads threads, this one included.
+// The first exception thrown is rethrown here once every thread is done.
+template <class work_function>
+static void parallelFor(size_t count, unsigned int num_threads, const work_function& work)
+{
+  std::atomic<size_t> next(0);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto worker = [&]() {
+    try {
+      for (size_t i = next++; i < count; i = next++) {
+        work(i);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      next = count;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  size_t thread_count = std::min<size_t>(num_threads, count);
+  for (size_t t = 1; t < thread_count; t++) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (size_t t = 0; t < threads.size(); t++) {
+    threads[t].join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+// Flattens the face groups into shapes on up to num_threads threads, this one included, and
+// hands them to the visitor on this thread, in order. The threads are started once, and build
+// at most a couple of shapes each ahead of the one being visited, so memory stays bounded.
+// The first exception thrown, by an export or by the visitor, is rethrown here once every thread is done.
+static void exportShapes(
+  shape_visitor& visitor,
+  const std::vector<face_group>& faceGroups,
+  const std::vector<float>& v,
+  const std::vector<float>& vn,
+  const std::vector<float>& vt,
+  const std::vector<obj_chunk>& chunks,
+  unsigned int num_threads)
+{
+  // Shape i is built into slot i % capacity, which is free again once shape i - capacity is visited.
+  const size_t capacity = 2 * (size_t)num_threads;
+  std::vector<shape_t> slots(capacity);
+  std::vector<bool> ready(capacity, false);
+
+  size_t next_export = 0;
+  size_t next_visit = 0;
+  std::exception_ptr error;
+  std::mutex mutex;
+  std::condition_variable changed;
+
+  // Everything below is called with the lock held.
+  auto fail = [&]() {
+    if (!error) {
+      error = std::current_exception();
+    }
+    changed.notify_all();
+  };
+
+  // Builds the next shape if its slot is free, and returns whether it did.
+  auto exportNext = [&](std::unique_lock<std::mutex>& lock) -> bool {
+    if (error || next_export == faceGroups.size() || next_export == next_visit + capacity) {
+      return false;
+    }
+
+    size_t index = next_export++;
+    lock.unlock();
+    try {
+      PROFILE_ZONE("tinyobj::ExportShape");
+      exportFaceGroupToShape(slots[index % capacity], v, vn, vt, chunks, faceGroups[index]);
+      lock.lock();
+      ready[index % capacity] = true;
+      changed.notify_all();
+    } catch (...) {
+      lock.lock();
+      fail();
+    }
+    return true;
+  };
+
+  auto worker = [&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!error && next_export < faceGroups.size()) {
+      if (!exportNext(lock)) {
+        changed.wait(lock);
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  size_t thread_count = std::min<size_t>(num_threads, faceGroups.size());
+  for (size_t t = 1; t < thread_count; t++) {
+    threads.push_back(std::thread(worker));
+  }
+
+  // this thread visits, and builds shapes too while the next one to visit isn't ready.
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!error && next_visit < faceGroups.size()) {
+      size_t slot = next_visit % capacity;
+      if (ready[slot]) {
+        lock.unlock();
+        try {
+          visitor.visit_shape(slots[slot]);
+          slots[slot] = shape_t();
+          lock.lock();
+          ready[slot] = false;
+          next_visit++;
+          changed.notify_all();
+        } catch (...) {
+          lock.lock();
+          fail();
+        }
+      } else if (!exportNext(lock)) {
+        changed.wait(lock);
+      }
+    }
+  }
 
-  return true;
+  for (size_t t = 0; t < threads.size(); t++) {
+    threads[t].join();
+  }
 
+  if (error) {
+    std::rethrow_exception(error);
+  }
 }
 
-  
+// The whole file in memory: mapped where that's possible, read in one go where it isn't.
+class file_contents {
+ public:
+  explicit file_contents(const char* filename) : data_(NULL), size_(0), ok_(false) {
+#ifdef _WIN32
+    FILE* f = fopen(filename, "rb");
+    if (!f) {
+      return;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size >= 0) {
+      buffer_.resize((size_t)size);
+      ok_ = (buffer_.empty() || fread(&buffer_[0], 1, buffer_.size(), f) == buffer_.size());
+      data_ = buffer_.empty() ? NULL : &buffer_[0];
+      size_ = buffer_.size();
+    }
+    fclose(f);
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+      size_ = (size_t)st.st_size;
+      if (size_ == 0) {
+        ok_ = true;
+      } else {
+        void* mapped = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+          madvise(mapped, size_, MADV_SEQUENTIAL);
+          data_ = (const char*)mapped;
+          ok_ = true;
+        }
+      }
+    }
+    close(fd);
+#endif
+  }
+
+  ~file_contents() {
+#ifndef _WIN32
+    if (data_) {
+      munmap((void*)data_, size_);
+    }
+#endif
+  }
+
+  bool ok() const { return ok_; }
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Lets go of the memory behind [begin, end), once it's been parsed. If it's
+  // read again after all, it's read from the file again.
+  void release(const char* begin, const char* end) const {
+#ifndef _WIN32
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t first = ((uintptr_t)begin + page - 1) & ~(page - 1);
+    uintptr_t last = (uintptr_t)end & ~(page - 1);
+    if (data_ && first < last) {
+      madvise((void*)first, last - first, MADV_DONTNEED);
+    }
+#else
+    (void)begin;
+    (void)end;
+#endif
+  }
+
+ private:
+  file_contents(const file_contents&);
+  file_contents& operator=(const file_contents&);
+
+  const char* data_;
+  size_t size_;
+  bool ok_;
+#ifdef _WIN32
+  std::vector<char> buffer_;
+#endif
+};
+
 void InitMaterial(material_t& material) {
   material.name = "";
   material.ambient_texname = "";
@@ -275,12 +825,26 @@ void InitMaterial(material_t& material) {
   material.unknown_parameter.clear();
 }
 
+// Adds a material to the table, unless one of the same name is already there.
+static void addMaterial(
+  std::map<std::string, int>& material_ids,
+  std::vector<material_t>& materials,
+  const material_t& material)
+{
+  if (material_ids.insert(std::pair<std::string, int>(material.name, (int)materials.size())).second) {
+    materials.push_back(material);
+  }
+}
+
+// Appends the materials of an .mtl file to 'materials', and maps their names
+// to their indices in 'material_ids', forgetting the names of any before.
 std::string LoadMtl (
-  std::map<std::string, material_t>& material_map,
+  std::map<std::string, int>& material_ids,
+  std::vector<material_t>& materials,
   const char* filename,
   const char* mtl_basepath)
 {
-  material_map.clear();
+  material_ids.clear();
   std::stringstream err;
 
   std::string filepath;
@@ -298,6 +862,7 @@ std::string LoadMtl (
   }
 
   material_t material;
+  bool has_material = false;
   
   int maxchars = 8192;  // Alloc enough size.
   std::vector<char> buf(maxchars);  // Alloc enough size.
@@ -321,6 +886,7 @@ std::string LoadMtl (
 
     // Skip leading space.
     const char* token = linebuf.c_str();
+    const char* line_end = token + linebuf.size();
     token += strspn(token, " \t");
 
     assert(token);
@@ -331,7 +897,10 @@ std::string LoadMtl (
     // new mtl
     if ((0 == strncmp(token, "newmtl", 6)) && isSpace((token[6]))) {
       // flush previous material.
-      material_map.insert(std::pair<std::string, material_t>(material.name, material));
+      if (has_material) {
+        addMaterial(material_ids, materials, material);
+      }
+      has_material = true;
 
       // initial temporary material
       InitMaterial(material);
@@ -348,7 +917,7 @@ std::string LoadMtl (
     if (token[0] == 'K' && token[1] == 'a' && isSpace((token[2]))) {
       token += 2;
       float r, g, b;
-      parseFloat3(r, g, b, token);
+      parseFloat3(r, g, b, token, line_end);
       material.ambient[0] = r;
       material.ambient[1] = g;
       material.ambient[2] = b;
@@ -359,7 +928,7 @@ std::string LoadMtl (
     if (token[0] == 'K' && token[1] == 'd' && isSpace((token[2]))) {
       token += 2;
       float r, g, b;
-      parseFloat3(r, g, b, token);
+      parseFloat3(r, g, b, token, line_end);
       material.diffuse[0] = r;
       material.diffuse[1] = g;
       material.diffuse[2] = b;
@@ -370,7 +939,7 @@ std::string LoadMtl (
     if (token[0] == 'K' && token[1] == 's' && isSpace((token[2]))) {
       token += 2;
       float r, g, b;
-      parseFloat3(r, g, b, token);
+      parseFloat3(r, g, b, token, line_end);
       material.specular[0] = r;
       material.specular[1] = g;
       material.specular[2] = b;
@@ -381,7 +950,7 @@ std::string LoadMtl (
     if (token[0] == 'K' && token[1] == 't' && isSpace((token[2]))) {
       token += 2;
       float r, g, b;
-      parseFloat3(r, g, b, token);
+      parseFloat3(r, g, b, token, line_end);
       material.transmittance[0] = r;
       material.transmittance[1] = g;
       material.transmittance[2] = b;
@@ -391,7 +960,7 @@ std::string LoadMtl (
     // ior(index of refraction)
     if (token[0] == 'N' && token[1] == 'i' && isSpace((token[2]))) {
       token += 2;
-      material.ior = parseFloat(token);
+      material.ior = parseFloat(token, line_end);
       continue;
     }
 
@@ -399,7 +968,7 @@ std::string LoadMtl (
     if(token[0] == 'K' && token[1] == 'e' && isSpace(token[2])) {
       token += 2;
       float r, g, b;
-      parseFloat3(r, g, b, token);
+      parseFloat3(r, g, b, token, line_end);
       material.emission[0] = r;
       material.emission[1] = g;
       material.emission[2] = b;
@@ -409,7 +978,7 @@ std::string LoadMtl (
     // shininess
     if(token[0] == 'N' && token[1] == 's' && isSpace(token[2])) {
       token += 2;
-      material.shininess = parseFloat(token);
+      material.shininess = parseFloat(token, line_end);
       continue;
     }
 
@@ -454,71 +1023,56 @@ std::string LoadMtl (
     }
   }
   // flush last material.
-  material_map.insert(std::pair<std::string, material_t>(material.name, material));
+  if (has_material) {
+    addMaterial(material_ids, materials, material);
+  }
 
   return err.str();
 }
 
-std::string
-TryLoadObj(
-  std::vector<shape_t>& shapes,
-  const char* filename,
-  const char* mtl_basepath)
+// Parses the lines of a chunk. Everything that depends on the lines
+// before it is left to be resolved once the chunks are put together.
+static void parseChunk(obj_chunk& chunk, const file_contents& file)
 {
-  shapes.clear();
-
-  std::stringstream err;
-
-  std::ifstream ifs(filename);
-  if (!ifs) {
-    err << "Cannot open file [" << filename << "]" << std::endl;
-    return err.str();
-  }
-
-  std::vector<float> v;
-  std::vector<float> vn;
-  std::vector<float> vt;
-  std::vector<std::vector<vertex_index> > faceGroup;
-  std::string name;
-
-  // material
-  std::map<std::string, material_t> material_map;
-  material_t material;
-
-  int maxchars = 8192;  // Alloc enough size.
-  std::vector<char> buf(maxchars);  // Alloc enough size.
-  while (ifs.peek() != -1) {
-    ifs.getline(&buf[0], maxchars);
-
-    std::string linebuf(&buf[0]);
-
-    // Trim newline '\r\n' or '\r'
-    if (linebuf.size() > 0) {
-      if (linebuf[linebuf.size()-1] == '\n') linebuf.erase(linebuf.size()-1);
-    }
-    if (linebuf.size() > 0) {
-      if (linebuf[linebuf.size()-1] == '\n') linebuf.erase(linebuf.size()-1);
+  PROFILE_ZONE("tinyobj::ParseChunk");
+
+  // what's been parsed isn't needed again, so it's let go of as parsing goes
+  const size_t kReleaseBytes = 16 << 20;
+  const char* released = chunk.begin;
+
+  std::vector<float>& v = chunk.v;
+  std::vector<float>& vn = chunk.vn;
+  std::vector<float>& vt = chunk.vt;
+  face_list& faces = chunk.faces;
+
+  const char* next_line = chunk.begin;
+  while (next_line < chunk.end) {
+    // Lines are parsed where they are. Nothing past line_end is read, it needn't be '\0'.
+    const char* line_end = (const char*)memchr(next_line, '\n', chunk.end - next_line);
+    if (!line_end) {
+      line_end = chunk.end;
     }
+    const char* token = next_line;
+    next_line = (line_end < chunk.end) ? line_end + 1 : chunk.end;
 
-    // Skip if empty line.
-    if (linebuf.empty()) {
-      continue;
+    if ((size_t)(token - released) > kReleaseBytes) {
+      file.release(released, token);
+      released = token;
     }
 
     // Skip leading space.
-    const char* token = linebuf.c_str();
-    token += strspn(token, " \t");
+    token = skipSpace(token, line_end);
 
-    assert(token);
-    if (token[0] == '\0') continue; // empty line
+    size_t length = line_end - token;
+    if (length == 0 || token[0] == '\0') continue; // empty line
     
     if (token[0] == '#') continue;  // comment line
 
     // vertex
-    if (token[0] == 'v' && isSpace((token[1]))) {
+    if (length > 1 && token[0] == 'v' && isSpace((token[1]))) {
       token += 2;
       float x, y, z;
-      parseFloat3(x, y, z, token);
+      parseFloat3(x, y, z, token, line_end);
       v.push_back(x);
       v.push_back(y);
       v.push_back(z);
@@ -526,10 +1080,10 @@ TryLoadObj(
     }
 
     // normal
-    if (token[0] == 'v' && token[1] == 'n' && isSpace((token[2]))) {
+    if (length > 2 && token[0] == 'v' && token[1] == 'n' && isSpace((token[2]))) {
       token += 3;
       float x, y, z;
-      parseFloat3(x, y, z, token);
+      parseFloat3(x, y, z, token, line_end);
       vn.push_back(x);
       vn.push_back(y);
       vn.push_back(z);
@@ -537,137 +1091,307 @@ TryLoadObj(
     }
 
     // texcoord
-    if (token[0] == 'v' && token[1] == 't' && isSpace((token[2]))) {
+    if (length > 2 && token[0] == 'v' && token[1] == 't' && isSpace((token[2]))) {
       token += 3;
       float x, y;
-      parseFloat2(x, y, token);
+      parseFloat2(x, y, token, line_end);
       vt.push_back(x);
       vt.push_back(y);
       continue;
     }
 
     // face
-    if (token[0] == 'f' && isSpace((token[1]))) {
+    if (length > 1 && token[0] == 'f' && isSpace((token[1]))) {
       token += 2;
-      token += strspn(token, " \t");
-
-      std::vector<vertex_index> face;
-      while (!isNewLine(token[0])) {
-        vertex_index vi = parseTriple(token, v.size() / 3, vn.size() / 3, vt.size() / 2);
-        face.push_back(vi);
-        int n = strspn(token, " \t\r");
-        token += n;
+      token = skipSpace(token, line_end);
+
+      unsigned int face_size = 0;
+      while (token < line_end && !isNewLine(token[0])) {
+        unsigned char relative;
+        vertex_index vi = parseTriple(token, line_end, v.size() / 3, vn.size() / 3, vt.size() / 2, relative);
+        faces.vertices.push_back(vi);
+        faces.relative.push_back(relative);
+        face_size++;
+        while (token < line_end && (isSpace(token[0]) || token[0] == '\r')) token++;
       }
 
-      faceGroup.push_back(face);
+      faces.sizes.push_back(face_size);
       
       continue;
     }
 
-    // use mtl
-    if ((0 == strncmp(token, "usemtl", 6)) && isSpace((token[6]))) {
+    obj_command command;
+    command.face = faces.sizes.size();
+    command.face_vertex = faces.vertices.size();
 
-      char namebuf[4096];
+    // use mtl
+    if (length > 6 && (0 == strncmp(token, "usemtl", 6)) && isSpace((token[6]))) {
       token += 7;
-      sscanf(token, "%s", namebuf);
-
-      if (material_map.find(namebuf) != material_map.end()) {
-        material = material_map[namebuf];
-      } else {
-        // { error!! material not found }
-        InitMaterial(material);
-      }
+      command.type = obj_command::USEMTL;
+      command.name = parseWord(token, line_end);
+      chunk.commands.push_back(command);
       continue;
-
     }
 
     // load mtl
-    if ((0 == strncmp(token, "mtllib", 6)) && isSpace((token[6]))) {
-      char namebuf[4096];
+    if (length > 6 && (0 == strncmp(token, "mtllib", 6)) && isSpace((token[6]))) {
       token += 7;
-      sscanf(token, "%s", namebuf);
+      command.type = obj_command::MTLLIB;
+      command.name = parseWord(token, line_end);
+      chunk.commands.push_back(command);
+      continue;
+    }
 
-      std::string err_mtl = LoadMtl(material_map, namebuf, mtl_basepath);
-      if (!err_mtl.empty()) {
-        faceGroup.clear();  // for safety
-        return err_mtl;
+    // group name
+    if (length > 1 && token[0] == 'g' && isSpace((token[1]))) {
+      command.type = obj_command::GROUP;
+
+      // names[0] must be 'g', so skip it and keep names[1].
+      size_t name_count = 0;
+      while (token < line_end && !isNewLine(token[0])) {
+        const char* name_end = skipToken(token, line_end);
+        if (name_count == 1) {
+          command.name.assign(token, name_end);
+        }
+        name_count++;
+        token = name_end;
+        while (token < line_end && (isSpace(token[0]) || token[0] == '\r')) token++; // skip tag
       }
+
+      chunk.commands.push_back(command);
       continue;
     }
 
-    // group name
-    if (token[0] == 'g' && isSpace((token[1]))) {
+    // object name
+    if (length > 1 && token[0] == 'o' && isSpace((token[1]))) {
+      // @todo { multiple object name? }
+      token += 2;
+      command.type = obj_command::OBJECT;
+      command.name = parseWord(token, line_end);
+      chunk.commands.push_back(command);
+      continue;
+    }
 
-      // flush previous face group.
-      shape_t shape;
-      bool ret = exportFaceGroupToShape(shape, v, vn, vt, faceGroup, material, name);
-      if (ret) {
-        shapes.push_back(shape);
-      }
+    // Ignore unknown command.
+  }
 
-      faceGroup.clear();
+  file.release(released, chunk.end);
+}
 
-      std::vector<std::string> names;
-      while (!isNewLine(token[0])) {
-        std::string str = parseString(token);
-        names.push_back(str);
-        token += strspn(token, " \t\r"); // skip tag
-      }
+// Appends faces [first_face, end_face) of a chunk to a face group.
+static void appendFaces(
+  face_group& faceGroup,
+  size_t chunk,
+  size_t first_face,
+  size_t end_face,
+  size_t first_vertex)
+{
+  if (first_face == end_face) {
+    return;
+  }
+  face_run run = { chunk, first_face, end_face, first_vertex };
+  faceGroup.runs.push_back(run);
+  faceGroup.face_count += end_face - first_face;
+}
 
-      assert(names.size() > 0);
+std::string
+TryLoadObj(
+  shape_visitor& visitor,
+  const char* filename,
+  const char* mtl_basepath,
+  unsigned int num_threads)
+{
+  PROFILE_ZONE("tinyobj::LoadObj");
 
-      // names[0] must be 'g', so skipt 0th element.
-      if (names.size() > 1) {
-        name = names[1];
-      } else {
-        name = "";
-      }
+  std::stringstream err;
 
-      continue;
-    }
+  if (num_threads == 0) {
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
 
-    // object name
-    if (token[0] == 'o' && isSpace((token[1]))) {
+  std::vector<obj_chunk> chunks;
+  {
+    file_contents file(filename);
+    if (!file.ok()) {
+      err << "Cannot open file [" << filename << "]" << std::endl;
+      return err.str();
+    }
 
-      // flush previous face group.
-      shape_t shape;
-      bool ret = exportFaceGroupToShape(shape, v, vn, vt, faceGroup, material, name);
-      if (ret) {
-        shapes.push_back(shape);
+    // Split the file into a chunk per thread, at line ends. Threads cost more than
+    // they save on small files, so every chunk but a lone one is at least a megabyte.
+    const size_t kMinChunkBytes = 1 << 20;
+    size_t chunk_count = std::max<size_t>(std::min<size_t>(num_threads, file.size() / kMinChunkBytes), 1);
+
+    chunks.resize(chunk_count);
+    const char* file_end = file.data() + file.size();
+    const char* chunk_begin = file.data();
+    for (size_t c = 0; c < chunk_count; c++) {
+      const char* chunk_end = file_end;
+      if (c + 1 < chunk_count) {
+        chunk_end = file.data() + file.size() / chunk_count * (c + 1);
+        chunk_end = std::max(chunk_end, chunk_begin);
+        const char* line_end = (const char*)memchr(chunk_end, '\n', file_end - chunk_end);
+        chunk_end = line_end ? line_end + 1 : file_end;
       }
+      chunks[c].begin = chunk_begin;
+      chunks[c].end = chunk_end;
+      chunk_begin = chunk_end;
+    }
 
-      faceGroup.clear();
+    parallelFor(chunks.size(), num_threads, [&](size_t c) { parseChunk(chunks[c], file); });
+  } // the chunks hold everything needed from the file now
 
-      // @todo { multiple object name? }
-      char namebuf[4096];
-      token += 2;
-      sscanf(token, "%s", namebuf);
-      name = std::string(namebuf);
+  // Put the chunks' vertex data together, and remember where each chunk's starts.
+  std::vector<float> v;
+  std::vector<float> vn;
+  std::vector<float> vt;
+  if (chunks.size() == 1) {
+    v.swap(chunks[0].v);
+    vn.swap(chunks[0].vn);
+    vt.swap(chunks[0].vt);
+  } else {
+    size_t v_size = 0, vn_size = 0, vt_size = 0;
+    for (size_t c = 0; c < chunks.size(); c++) {
+      chunks[c].v_base = v_size / 3;
+      chunks[c].vn_base = vn_size / 3;
+      chunks[c].vt_base = vt_size / 2;
+      v_size += chunks[c].v.size();
+      vn_size += chunks[c].vn.size();
+      vt_size += chunks[c].vt.size();
+    }
+    v.reserve(v_size);
+    vn.reserve(vn_size);
+    vt.reserve(vt_size);
+    for (size_t c = 0; c < chunks.size(); c++) {
+      v.insert(v.end(), chunks[c].v.begin(), chunks[c].v.end());
+      vn.insert(vn.end(), chunks[c].vn.begin(), chunks[c].vn.end());
+      vt.insert(vt.end(), chunks[c].vt.begin(), chunks[c].vt.end());
+      std::vector<float>().swap(chunks[c].v);
+      std::vector<float>().swap(chunks[c].vn);
+      std::vector<float>().swap(chunks[c].vt);
+    }
+  }
 
+  // Go through the commands in file order, sorting the faces between them into face groups.
+  std::vector<face_group> faceGroups;
+  face_group faceGroup;
+  std::string name;
 
-      continue;
+  // material
+  std::vector<material_t> materials;
+  std::map<std::string, int> material_ids;
+  int material_id = -1;
+
+  for (size_t c = 0; c < chunks.size() && err.str().empty(); c++) {
+    const obj_chunk& chunk = chunks[c];
+    size_t face = 0;
+    size_t face_vertex = 0;
+
+    for (size_t i = 0; i < chunk.commands.size(); i++) {
+      const obj_command& command = chunk.commands[i];
+      appendFaces(faceGroup, c, face, command.face, face_vertex);
+      face = command.face;
+      face_vertex = command.face_vertex;
+
+      if (command.type == obj_command::USEMTL) {
+        std::map<std::string, int>::const_iterator found = material_ids.find(command.name);
+        // { error!! material not found } leaves the faces without one
+        material_id = (found != material_ids.end()) ? found->second : -1;
+      } else if (command.type == obj_command::MTLLIB) {
+        std::string err_mtl = LoadMtl(material_ids, materials, command.name.c_str(), mtl_basepath);
+        if (!err_mtl.empty()) {
+          // the face groups before it are still loaded
+          err << err_mtl;
+          faceGroup = face_group();  // for safety
+          break;
+        }
+      } else {
+        // flush previous face group.
+        if (faceGroup.face_count > 0) {
+          faceGroup.material_id = material_id;
+          faceGroup.name = name;
+          faceGroups.push_back(std::move(faceGroup));
+        }
+        faceGroup = face_group();
+        name = command.name;
+      }
     }
 
-    // Ignore unknown command.
+    if (err.str().empty()) {
+      appendFaces(faceGroup, c, face, chunk.faces.sizes.size(), face_vertex);
+    }
   }
 
-  shape_t shape;
-  bool ret = exportFaceGroupToShape(shape, v, vn, vt, faceGroup, material, name);
-  if (ret) {
-    shapes.push_back(shape);
+  if (faceGroup.face_count > 0) {
+    faceGroup.material_id = material_id;
+    faceGroup.name = name;
+    faceGroups.push_back(std::move(faceGroup));
   }
-  faceGroup.clear();  // for safety
+
+  visitor.visit_materials(materials);
+
+  // The groups are independent, so they're flattened into shapes in parallel.
+  exportShapes(visitor, faceGroups, v, vn, vt, chunks, num_threads);
 
   return err.str();
 }
 
+// Collects the shapes and materials of TryLoadObj into vectors.
+class shape_collector : public shape_visitor {
+ public:
+  shape_collector(std::vector<shape_t>& shapes, std::vector<material_t>& materials)
+    : shapes_(shapes), materials_(materials) {}
+
+  void visit_materials(std::vector<material_t>& materials) {
+    materials_.swap(materials);
+  }
+
+  void visit_shape(shape_t& shape) {
+    shapes_.push_back(std::move(shape));
+  }
+
+ private:
+  std::vector<shape_t>& shapes_;
+  std::vector<material_t>& materials_;
+};
+
+std::string
+TryLoadObj(
+  std::vector<shape_t>& shapes,
+  std::vector<material_t>& materials,
+  const char* filename,
+  const char* mtl_basepath,
+  unsigned int num_threads)
+{
+  shapes.clear();
+  materials.clear();
+
+  shape_collector collector(shapes, materials);
+  return TryLoadObj(collector, filename, mtl_basepath, num_threads);
+}
+
 void
 LoadObj(
     std::vector<shape_t>& shapes,
+    std::vector<material_t>& materials,
+    const char* filename,
+    const char* mtl_basepath,
+    unsigned int num_threads)
+{
+  std::string result = TryLoadObj(shapes, materials, filename, mtl_basepath, num_threads);
+  if (!result.empty()) {
+    throw std::runtime_error(result);
+  }
+}
+
+void
+LoadObj(
+    shape_visitor& visitor,
     const char* filename,
-    const char* mtl_basepath)
+    const char* mtl_basepath,
+    unsigned int num_threads)
 {
-  std::string result = TryLoadObj(shapes, filename, mtl_basepath);
+  std::string result = TryLoadObj(visitor, filename, mtl_basepath, num_threads);
   if (!result.empty()) {
     throw std::runtime_error(result);
   }